@@ -12,6 +12,11 @@ layout(push_constant) uniform block {
     //sampler2D iChannel[4];
 };
 
+// Specialization constants: set per pipeline variant without recompiling.
+// See shadertoy_constants in src/shadertoy.h.
+layout(constant_id = 0) const int iQuality = 1;
+layout(constant_id = 1) const int iAATaps = 1;
+
 layout(location = 0) in vec2 fragCoord;
 layout(location = 0) out vec4 fragColor;
 
@@ -5,6 +5,8 @@
 # VULKAN_FOUND
 # GLSLANGVALIDATOR_EXECUTABLE
 # SHADERC_LIBRARY
+# SPIRV_TOOLS_OPT_LIBRARY (optional)
+# SPIRV_TOOLS_LIBRARY (optional)
 
 if (WIN32)
     find_path(VULKAN_INCLUDE_DIR NAMES vulkan/vulkan.h HINTS
@@ -20,6 +22,12 @@ if (WIN32)
         find_library(SHADERC_LIBRARY NAMES shaderc_combined HINTS
             "$ENV{VULKAN_SDK}/Lib"
             "$ENV{VK_SDK_PATH}/Lib")
+        find_library(SPIRV_TOOLS_OPT_LIBRARY NAMES SPIRV-Tools-opt HINTS
+            "$ENV{VULKAN_SDK}/Lib"
+            "$ENV{VK_SDK_PATH}/Lib")
+        find_library(SPIRV_TOOLS_LIBRARY NAMES SPIRV-Tools HINTS
+            "$ENV{VULKAN_SDK}/Lib"
+            "$ENV{VK_SDK_PATH}/Lib")
     else()
         find_library(VULKAN_LIBRARY NAMES vulkan-1 HINTS
             "$ENV{VULKAN_SDK}/Lib32"
@@ -40,6 +48,10 @@ else()
         "$ENV{VULKAN_SDK}/bin")
     find_library(SHADERC_LIBRARY NAMES shaderc HINTS
         "$ENV{VULKAN_SDK}/lib")
+    find_library(SPIRV_TOOLS_OPT_LIBRARY NAMES SPIRV-Tools-opt HINTS
+        "$ENV{VULKAN_SDK}/lib")
+    find_library(SPIRV_TOOLS_LIBRARY NAMES SPIRV-Tools HINTS
+        "$ENV{VULKAN_SDK}/lib")
 endif()
 
 include(FindPackageHandleStandardArgs)
@@ -47,4 +59,5 @@ find_package_handle_standard_args(Vulkan DEFAULT_MSG VULKAN_LIBRARY
     VULKAN_INCLUDE_DIR GLSLANGVALIDATOR_EXECUTABLE SHADERC_LIBRARY)
 
 mark_as_advanced(VULKAN_INCLUDE_DIR VULKAN_LIBRARY
-    GLSLANGVALIDATOR_EXECUTABLE SHADERC_LIBRARY)
+    GLSLANGVALIDATOR_EXECUTABLE SHADERC_LIBRARY
+    SPIRV_TOOLS_OPT_LIBRARY SPIRV_TOOLS_LIBRARY)
@@ -0,0 +1,56 @@
+#include "cache_blob.h"
+#include <plat/file_io.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+uint64_t cache_blob::hash(gsl::span<char const> bytes) noexcept {
+  uint64_t h = UINT64_C(14695981039346656037);
+  for (auto&& c : bytes) {
+    h ^= static_cast<unsigned char>(c);
+    h *= UINT64_C(1099511628211);
+  }
+  return h;
+} // cache_blob::hash
+
+void cache_blob::write(plat::filesystem::path const& path, uuid const& device,
+                       gsl::span<char const> bytes,
+                       std::error_code& ec) noexcept {
+  header h;
+  h.device = device;
+  h.size = static_cast<uint64_t>(bytes.size());
+  h.hash = hash(bytes);
+
+  std::vector<char> file(sizeof(h) + bytes.size());
+  std::memcpy(file.data(), &h, sizeof(h));
+  if (!bytes.empty()) {
+    std::memcpy(file.data() + sizeof(h), bytes.data(), bytes.size());
+  }
+
+  plat::write_file_atomic(path, file, ec);
+} // cache_blob::write
+
+gsl::span<char const> cache_blob::contents(gsl::span<char const> file,
+                                           uuid const& device,
+                                           std::error_code& ec) noexcept {
+  header h;
+  if (static_cast<std::size_t>(file.size()) < sizeof(h)) {
+    ec.assign(EIO, std::generic_category());
+    return {};
+  }
+
+  std::memcpy(&h, file.data(), sizeof(h));
+  if (h.magic != MAGIC || h.version != VERSION || h.device != device) {
+    ec.assign(EINVAL, std::generic_category());
+    return {};
+  }
+
+  auto const bytes = file.subspan(sizeof(h));
+  if (h.size != static_cast<uint64_t>(bytes.size()) || h.hash != hash(bytes)) {
+    ec.assign(EIO, std::generic_category());
+    return {};
+  }
+
+  ec.clear();
+  return bytes;
+} // cache_blob::contents
@@ -0,0 +1,49 @@
+#ifndef VKST_CACHE_BLOB_H
+#define VKST_CACHE_BLOB_H
+
+#include <plat/filesystem.h>
+#include <gsl.h>
+#include <array>
+#include <cstdint>
+#include <system_error>
+
+// Cache files start with a header recording the format version, the device
+// the contents were made for and the size and a hash of the contents, so a
+// truncated, corrupted or stale file is rejected before shaderc or the driver
+// sees it. Rejecting one only costs rebuilding what it held.
+namespace cache_blob {
+
+constexpr uint32_t MAGIC = 0x43545356; // "VSTC"
+constexpr uint32_t VERSION = 1;
+
+// VkPhysicalDeviceProperties::pipelineCacheUUID, or all zeros for contents
+// that do not depend on the device.
+using uuid = std::array<uint8_t, 16>;
+
+struct header {
+  uint32_t magic{MAGIC};
+  uint32_t version{VERSION};
+  uuid device{};
+  uint64_t size{0};
+  uint64_t hash{0};
+}; // struct header
+
+static_assert(sizeof(header) == 40, "header must not have padding");
+
+// 64-bit FNV-1a of bytes.
+uint64_t hash(gsl::span<char const> bytes) noexcept;
+
+// Atomically replace the file at path with a header for device followed by
+// bytes. If ec is true, then an error occurred and the file is unchanged.
+void write(plat::filesystem::path const& path, uuid const& device,
+           gsl::span<char const> bytes, std::error_code& ec) noexcept;
+
+// Validate the header at the start of file and return the contents following
+// it. If ec is true, then the file is from another version or device
+// (EINVAL) or is truncated or corrupt (EIO) and an empty span is returned.
+gsl::span<char const> contents(gsl::span<char const> file, uuid const& device,
+                               std::error_code& ec) noexcept;
+
+} // namespace cache_blob
+
+#endif // VKST_CACHE_BLOB_H
@@ -0,0 +1,356 @@
+#include "async_io.h"
+#include <algorithm>
+#include <cerrno>
+
+#if TURF_KERNEL_LINUX && __has_include(<linux/io_uring.h>)
+#  define PLAT_HAVE_IO_URING 1
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#else
+#  define PLAT_HAVE_IO_URING 0
+#endif
+
+#if PLAT_HAVE_IO_URING
+
+// The submission and completion rings shared with the kernel. There is no
+// liburing dependency; the rings are set up and driven with the raw system
+// calls. Only this thread touches the submission tail and completion head,
+// while the kernel reads and writes the other ends, so those are accessed
+// with acquire and release atomics.
+struct plat::async_io::ring {
+  int fd{-1};
+  void* sq_ptr{MAP_FAILED};
+  std::size_t sq_size{0};
+  void* cq_ptr{MAP_FAILED};
+  std::size_t cq_size{0};
+  io_uring_sqe* sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+  std::size_t sqes_size{0};
+
+  unsigned* sq_tail{nullptr};
+  unsigned sq_mask{0};
+  unsigned* sq_array{nullptr};
+  unsigned* cq_head{nullptr};
+  unsigned* cq_tail{nullptr};
+  unsigned cq_mask{0};
+  io_uring_cqe* cqes{nullptr};
+
+  std::vector<iovec> iovecs{}; // one per request, read by the kernel
+
+  // Set up a ring with room for entries submissions. Returns false if the
+  // kernel does not support io_uring or it is disabled.
+  bool create(uint32_t entries) noexcept;
+
+  ~ring() noexcept {
+    if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED) ::munmap(sq_ptr, sq_size);
+    if (fd >= 0) ::close(fd);
+  }
+}; // struct plat::async_io::ring
+
+template <class T>
+static T* ring_offset(void* base, uint32_t offset) noexcept {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+} // ring_offset
+
+bool plat::async_io::ring::create(uint32_t entries) noexcept {
+  io_uring_params params = {};
+  fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+  if (fd < 0) return false;
+
+  sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_size = cq_size = std::max(sq_size, cq_size);
+  }
+
+  sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sq_ptr == MAP_FAILED) return false;
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ptr = sq_ptr;
+  } else {
+    cq_ptr = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ptr == MAP_FAILED) return false;
+  }
+
+  sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = static_cast<io_uring_sqe*>(
+    ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+  if (sqes == MAP_FAILED) return false;
+
+  sq_tail = ring_offset<unsigned>(sq_ptr, params.sq_off.tail);
+  sq_mask = *ring_offset<unsigned>(sq_ptr, params.sq_off.ring_mask);
+  sq_array = ring_offset<unsigned>(sq_ptr, params.sq_off.array);
+  cq_head = ring_offset<unsigned>(cq_ptr, params.cq_off.head);
+  cq_tail = ring_offset<unsigned>(cq_ptr, params.cq_off.tail);
+  cq_mask = *ring_offset<unsigned>(cq_ptr, params.cq_off.ring_mask);
+  cqes = ring_offset<io_uring_cqe>(cq_ptr, params.cq_off.cqes);
+
+  iovecs.resize(entries);
+  return true;
+} // plat::async_io::ring::create
+
+#else // PLAT_HAVE_IO_URING
+
+struct plat::async_io::ring {};
+
+#endif // PLAT_HAVE_IO_URING
+
+plat::async_io::async_io(uint32_t queue_depth, backends preferred) noexcept
+: _requests(std::max(1u, queue_depth)) {
+  _free.reserve(_requests.size());
+  for (std::size_t i = _requests.size(); i > 0; --i) {
+    _free.push_back(gsl::narrow_cast<uint32_t>(i - 1));
+  }
+  _queued.reserve(_requests.size());
+  _completed.reserve(_requests.size());
+
+#if PLAT_HAVE_IO_URING
+  if (preferred == backends::io_uring) {
+    _ring = gsl::make_unique<ring>();
+    if (_ring->create(gsl::narrow_cast<uint32_t>(_requests.size()))) {
+      _backend = backends::io_uring;
+      return;
+    }
+    _ring.reset();
+  }
+#else
+  static_cast<void>(preferred);
+#endif
+
+  // The requests are I/O bound, so a few workers keep a queue of them busy
+  _backend = backends::thread_pool;
+  _pool = gsl::make_unique<thread_pool>(
+    std::min<std::size_t>(_requests.size(), 4));
+} // plat::async_io::async_io
+
+void plat::async_io::read(file_handle& fh, uint64_t offset, void* data,
+                          std::size_t size, completion done) noexcept {
+  enqueue(fh, offset, static_cast<char*>(data), size, false, std::move(done));
+} // plat::async_io::read
+
+void plat::async_io::write(file_handle& fh, uint64_t offset, void const* data,
+                           std::size_t size, completion done) noexcept {
+  // The data is only read; the request just has one pointer type for both
+  enqueue(fh, offset, const_cast<char*>(static_cast<char const*>(data)), size,
+          true, std::move(done));
+} // plat::async_io::write
+
+void plat::async_io::enqueue(file_handle& fh, uint64_t offset, char* data,
+                             std::size_t size, bool write,
+                             completion done) noexcept {
+  while (_free.empty()) complete(true);
+
+  uint32_t const index = _free.back();
+  _free.pop_back();
+
+  auto& req = _requests[index];
+  req.done = std::move(done);
+  req.fh = &fh;
+  req.offset = offset;
+  req.data = data;
+  req.size = size;
+  req.transferred = 0;
+  req.write = write;
+  req.ec.clear();
+
+  // The ring goes straight to the descriptor, so anything stdio buffered
+  // must reach the file first. If it cannot, complete with that error
+  // rather than read or write around the buffered data.
+  if (_backend == backends::io_uring) fh.flush(req.ec);
+
+  if (req.ec) _completed.push_back(index);
+  else _queued.push_back(index);
+} // plat::async_io::enqueue
+
+void plat::async_io::submit() noexcept {
+  if (_queued.empty()) return;
+
+#if PLAT_HAVE_IO_URING
+  if (_backend == backends::io_uring) {
+    unsigned tail = *_ring->sq_tail;
+
+    for (auto&& index : _queued) {
+      auto& req = _requests[index];
+      auto& iov = _ring->iovecs[index];
+      iov.iov_base = req.data + req.transferred;
+      iov.iov_len = req.size - req.transferred;
+
+      unsigned const slot = tail & _ring->sq_mask;
+      io_uring_sqe& sqe = _ring->sqes[slot];
+      sqe = {};
+      sqe.opcode = req.write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe.fd = req.fh->descriptor();
+      sqe.off = req.offset + req.transferred;
+      sqe.addr = reinterpret_cast<uint64_t>(&iov);
+      sqe.len = 1;
+      sqe.user_data = index;
+
+      _ring->sq_array[slot] = slot;
+      tail += 1;
+    }
+
+    __atomic_store_n(_ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    auto const count = static_cast<unsigned>(_queued.size());
+    unsigned submitted = 0;
+    int error = 0;
+    while (submitted < count) {
+      auto const n = ::syscall(__NR_io_uring_enter, _ring->fd,
+                               count - submitted, 0u, 0u, nullptr, 0);
+      if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN) continue;
+        error = errno;
+        break;
+      }
+      submitted += static_cast<unsigned>(n);
+    }
+
+    if (submitted < count) {
+      // The kernel did not take the rest, so take them back out of the ring
+      // and complete them with the error.
+      __atomic_store_n(_ring->sq_tail, tail - (count - submitted),
+                       __ATOMIC_RELEASE);
+      for (unsigned i = submitted; i < count; ++i) {
+        _requests[_queued[i]].ec.assign(error, std::generic_category());
+        _completed.push_back(_queued[i]);
+      }
+    }
+
+    _queued.clear();
+    return;
+  }
+#endif
+
+  for (auto&& index : _queued) {
+    _pool->submit([this, index](std::size_t) { run(index); });
+  }
+  _queued.clear();
+} // plat::async_io::submit
+
+std::size_t plat::async_io::poll() noexcept {
+  submit();
+  return complete(false);
+} // plat::async_io::poll
+
+void plat::async_io::wait() noexcept {
+  submit();
+  while (in_flight() > 0) complete(true);
+} // plat::async_io::wait
+
+std::size_t plat::async_io::complete(bool block) noexcept {
+  // submit leaves any requests the kernel refused in _completed
+  submit();
+
+  if (_backend == backends::io_uring) reap_ring(block, _completed);
+  else reap_pool(block, _completed);
+
+  // A callback may queue new requests, so release each request before its
+  // callback runs, and iterate over a copy the callbacks cannot touch.
+  auto completed = std::move(_completed);
+  for (auto&& index : completed) {
+    auto& req = _requests[index];
+    auto done = std::move(req.done);
+    auto const transferred = req.transferred;
+    auto const ec = req.ec;
+    req.done = nullptr;
+    req.fh = nullptr;
+    _free.push_back(index);
+
+    if (done) done(transferred, ec);
+  }
+
+  auto const count = completed.size();
+  if (_completed.empty()) {
+    completed.clear();
+    _completed = std::move(completed); // keep the capacity
+  }
+  return count;
+} // plat::async_io::complete
+
+void plat::async_io::reap_ring(bool block,
+                               std::vector<uint32_t>& completed) noexcept {
+#if PLAT_HAVE_IO_URING
+  while (true) {
+    unsigned head = *_ring->cq_head;
+    unsigned const tail = __atomic_load_n(_ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+      io_uring_cqe const& cqe = _ring->cqes[head & _ring->cq_mask];
+      auto const index = static_cast<uint32_t>(cqe.user_data);
+      auto& req = _requests[index];
+
+      if (cqe.res < 0) {
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+          _queued.push_back(index);
+          continue;
+        }
+        req.ec.assign(-cqe.res, std::generic_category());
+      } else {
+        req.transferred += static_cast<std::size_t>(cqe.res);
+        // Finish a short transfer unless a read hit the end of the file
+        if (cqe.res > 0 && req.transferred < req.size) {
+          _queued.push_back(index);
+          continue;
+        }
+      }
+
+      completed.push_back(index);
+    }
+
+    __atomic_store_n(_ring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (!_queued.empty()) submit();
+    if (!completed.empty() || !block) return;
+
+    auto const n = ::syscall(__NR_io_uring_enter, _ring->fd, 0u, 1u,
+                             IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (n < 0 && errno != EINTR) return;
+  }
+#else
+  static_cast<void>(block);
+  static_cast<void>(completed);
+#endif
+} // plat::async_io::reap_ring
+
+void plat::async_io::reap_pool(bool block,
+                               std::vector<uint32_t>& completed) noexcept {
+  std::unique_lock<std::mutex> lock{_mutex};
+  if (block) {
+    _done.wait(lock, [this]() { return !_pool_completed.empty(); });
+  }
+  completed.insert(completed.end(), _pool_completed.begin(),
+                   _pool_completed.end());
+  _pool_completed.clear();
+} // plat::async_io::reap_pool
+
+void plat::async_io::run(uint32_t index) noexcept {
+  auto& req = _requests[index];
+
+  if (!req.ec) {
+    req.transferred =
+      req.write ? req.fh->write_at(req.offset, req.data, req.size, req.ec)
+                : req.fh->read_at(req.offset, req.data, req.size, req.ec);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _pool_completed.push_back(index);
+  }
+  _done.notify_one();
+} // plat::async_io::run
+
+plat::async_io::~async_io() noexcept {
+  wait();
+
+  // A worker may still be between releasing _mutex and notifying _done, so
+  // join the workers before the members they use are destroyed.
+  _pool.reset();
+} // plat::async_io::~async_io
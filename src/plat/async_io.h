@@ -0,0 +1,112 @@
+#ifndef VKST_PLAT_ASYNC_IO_H
+#define VKST_PLAT_ASYNC_IO_H
+
+#include <plat/file_handle.h>
+#include <plat/thread_pool.h>
+#include <turf/c/core.h>
+#include <gsl.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+namespace plat {
+
+// Reads and writes whole buffers at file offsets without blocking the caller.
+// Requests are queued, handed to the OS in batches by submit, and their
+// completion callbacks run on the calling thread from poll or wait, so the
+// callbacks need no locking. On Linux the queues are an io_uring when the
+// kernel provides one; otherwise, and on Win32, a small thread pool runs the
+// requests with file_handle positional I/O.
+class async_io {
+public:
+  enum class backends : uint8_t { io_uring, thread_pool };
+
+  // Called with the number of bytes transferred and any error.
+  using completion =
+    std::function<void(std::size_t size, std::error_code const& ec)>;
+
+  // Allow up to queue_depth requests in flight. With backends::thread_pool
+  // io_uring is not tried.
+  explicit async_io(uint32_t queue_depth = 64,
+                    backends preferred = backends::io_uring) noexcept;
+
+  backends backend() const noexcept { return _backend; }
+  std::size_t in_flight() const noexcept {
+    return _requests.size() - _free.size();
+  }
+
+  // Queue a read into, or a write from, the size bytes at data, at offset in
+  // fh. data and fh must stay valid until done has run. If queue_depth
+  // requests are already in flight, this first waits for one to complete.
+  void read(file_handle& fh, uint64_t offset, void* data, std::size_t size,
+            completion done) noexcept;
+  void write(file_handle& fh, uint64_t offset, void const* data,
+             std::size_t size, completion done) noexcept;
+
+  // Hand the queued requests to the OS.
+  void submit() noexcept;
+
+  // Submit, then run the callbacks of every request that has completed
+  // without blocking. Returns the number of callbacks run.
+  std::size_t poll() noexcept;
+
+  // Submit, then block until every request has completed, running their
+  // callbacks.
+  void wait() noexcept;
+
+  async_io(async_io const&) = delete;
+  async_io& operator=(async_io const&) = delete;
+  ~async_io() noexcept;
+
+private:
+  struct request {
+    completion done{};
+    file_handle* fh{nullptr};
+    uint64_t offset{0};
+    char* data{nullptr};
+    std::size_t size{0};
+    std::size_t transferred{0};
+    bool write{false};
+    std::error_code ec{};
+  }; // struct request
+
+  struct ring; // the io_uring, defined in async_io.cc
+
+  void enqueue(file_handle& fh, uint64_t offset, char* data, std::size_t size,
+               bool write, completion done) noexcept;
+
+  // Collect the indices of completed requests, blocking for at least one if
+  // block is true, and run their callbacks.
+  std::size_t complete(bool block) noexcept;
+
+  void reap_ring(bool block, std::vector<uint32_t>& completed) noexcept;
+  void reap_pool(bool block, std::vector<uint32_t>& completed) noexcept;
+  void run(uint32_t index) noexcept; // on a thread_pool worker
+
+  backends _backend{backends::thread_pool};
+  std::vector<request> _requests{};
+  std::vector<uint32_t> _free{};
+  std::vector<uint32_t> _queued{};
+  std::vector<uint32_t> _completed{};
+
+  gsl::unique_ptr<ring> _ring{};
+
+  gsl::unique_ptr<thread_pool> _pool{};
+  std::mutex _mutex{};
+  std::condition_variable _done{};
+  std::vector<uint32_t> _pool_completed{}; // guarded by _mutex
+}; // class async_io
+
+inline gsl::czstring to_string(async_io::backends backend) noexcept {
+  switch (backend) {
+  case async_io::backends::io_uring: return "io_uring";
+  case async_io::backends::thread_pool: return "thread_pool";
+  }
+  return "unknown";
+}
+
+} // namespace plat
+
+#endif // VKST_PLAT_ASYNC_IO_H
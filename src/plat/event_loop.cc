@@ -0,0 +1,285 @@
+#include "event_loop.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+#if TURF_TARGET_WIN32
+#  include <windows.h>
+#else
+#  include <sys/epoll.h>
+#  include <sys/timerfd.h>
+#  include <unistd.h>
+#endif
+
+// Round up so a wait never ends before timeout has passed.
+static std::chrono::milliseconds
+to_milliseconds(std::chrono::nanoseconds timeout) noexcept {
+  return std::chrono::ceil<std::chrono::milliseconds>(
+    std::max(timeout, std::chrono::nanoseconds{0}));
+} // to_milliseconds
+
+plat::event_loop::source_id
+plat::event_loop::insert(source s) noexcept {
+  auto const free = std::find_if(_sources.begin(), _sources.end(),
+                                 [](auto&& x) { return !x.active; });
+  if (free != _sources.end()) {
+    *free = std::move(s);
+    return gsl::narrow_cast<source_id>(free - _sources.begin());
+  }
+
+  _sources.push_back(std::move(s));
+  return gsl::narrow_cast<source_id>(_sources.size() - 1);
+} // plat::event_loop::insert
+
+void plat::event_loop::run(source_id id) noexcept {
+  if (id >= _sources.size() || !_sources[id].active) return;
+
+#if !TURF_TARGET_WIN32
+  if (_sources[id].timer) {
+    // Reading the expiration count rearms the descriptor
+    uint64_t expirations;
+    if (::read(_sources[id].handle, &expirations, sizeof(expirations)) < 0) {
+      return;
+    }
+  }
+#endif
+
+  // Copied, as the callback may add or remove sources and move _sources
+  auto const cb = _sources[id].cb;
+  if (cb) cb();
+} // plat::event_loop::run
+
+#if TURF_TARGET_WIN32
+
+plat::event_loop::source_id
+plat::event_loop::add(native_handle handle, callback cb,
+                      std::error_code& ec) noexcept {
+  ec.clear();
+  if (std::count_if(_sources.begin(), _sources.end(),
+                    [](auto&& s) { return s.active; }) >=
+      MAXIMUM_WAIT_OBJECTS - 1) {
+    ec.assign(ERROR_TOO_MANY_POSTS, std::system_category());
+    return UINT32_MAX;
+  }
+
+  return insert({handle, std::move(cb), false, true});
+} // plat::event_loop::add
+
+plat::event_loop::source_id
+plat::event_loop::add_timer(std::chrono::nanoseconds period, callback cb,
+                            std::error_code& ec) noexcept {
+  ec.clear();
+
+  // A synchronization timer resets itself when a wait sees it signaled
+  HANDLE const timer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+  if (!timer) {
+    ec.assign(GetLastError(), std::system_category());
+    return UINT32_MAX;
+  }
+
+  LARGE_INTEGER due;
+  due.QuadPart = -std::max<LONGLONG>(period.count() / 100, 1); // relative
+  LONG const period_ms = static_cast<LONG>(
+    std::max<LONGLONG>(to_milliseconds(period).count(), 1));
+  if (!SetWaitableTimer(timer, &due, period_ms, nullptr, nullptr, FALSE)) {
+    ec.assign(GetLastError(), std::system_category());
+    CloseHandle(timer);
+    return UINT32_MAX;
+  }
+
+  auto const id = add(timer, std::move(cb), ec);
+  if (ec) {
+    CloseHandle(timer);
+    return UINT32_MAX;
+  }
+
+  _sources[id].timer = true;
+  return id;
+} // plat::event_loop::add_timer
+
+void plat::event_loop::remove(source_id id) noexcept {
+  if (id >= _sources.size() || !_sources[id].active) return;
+  if (_sources[id].timer) CloseHandle(_sources[id].handle);
+  _sources[id] = source{};
+} // plat::event_loop::remove
+
+std::size_t plat::event_loop::wait(std::chrono::nanoseconds timeout) noexcept {
+  std::array<HANDLE, MAXIMUM_WAIT_OBJECTS> handles;
+  std::array<source_id, MAXIMUM_WAIT_OBJECTS> ids;
+  DWORD count = 0;
+  for (std::size_t i = 0; i < _sources.size(); ++i) {
+    if (!_sources[i].active) continue;
+    handles[count] = _sources[i].handle;
+    ids[count] = gsl::narrow_cast<source_id>(i);
+    count += 1;
+  }
+
+  DWORD const ms = timeout == forever
+                     ? INFINITE
+                     : static_cast<DWORD>(to_milliseconds(timeout).count());
+
+  // Every signaled handle is run: after the first, poll for the rest
+  std::size_t ready = 0;
+  for (DWORD wait_ms = ms;; wait_ms = 0) {
+    DWORD const rslt = MsgWaitForMultipleObjectsEx(
+      count, handles.data(), wait_ms, QS_ALLINPUT,
+      MWMO_ALERTABLE | MWMO_INPUTAVAILABLE);
+    if (rslt >= WAIT_OBJECT_0 + count) break; // timeout, message or APC
+
+    auto const index = rslt - WAIT_OBJECT_0;
+    run(ids[index]);
+    ready += 1;
+
+    // Skip it when polling for the others
+    handles[index] = handles[count - 1];
+    ids[index] = ids[count - 1];
+    count -= 1;
+    if (count == 0) break;
+  }
+
+  return ready;
+} // plat::event_loop::wait
+
+plat::event_loop::event_loop(event_loop&& other) noexcept
+: _sources{std::move(other._sources)} {
+  other._sources.clear();
+} // plat::event_loop::event_loop
+
+plat::event_loop& plat::event_loop::operator=(event_loop&& rhs) noexcept {
+  if (this == &rhs) return *this;
+  close();
+  _sources = std::move(rhs._sources);
+  rhs._sources.clear();
+  return *this;
+} // plat::event_loop::operator=
+
+void plat::event_loop::close() noexcept {
+  for (source_id id = 0; id < _sources.size(); ++id) remove(id);
+  _sources.clear();
+} // plat::event_loop::close
+
+#else // TURF_TARGET_WIN32
+
+plat::event_loop::source_id
+plat::event_loop::add(native_handle handle, callback cb,
+                      std::error_code& ec) noexcept {
+  ec.clear();
+
+  if (_fd < 0) {
+    _fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (_fd < 0) {
+      ec.assign(errno, std::generic_category());
+      return UINT32_MAX;
+    }
+  }
+
+  auto const id = insert({handle, std::move(cb), false, true});
+
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u32 = id;
+  if (::epoll_ctl(_fd, EPOLL_CTL_ADD, handle, &event) != 0) {
+    ec.assign(errno, std::generic_category());
+    _sources[id] = source{};
+    return UINT32_MAX;
+  }
+
+  return id;
+} // plat::event_loop::add
+
+plat::event_loop::source_id
+plat::event_loop::add_timer(std::chrono::nanoseconds period, callback cb,
+                            std::error_code& ec) noexcept {
+  ec.clear();
+
+  int const timer =
+    ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer < 0) {
+    ec.assign(errno, std::generic_category());
+    return UINT32_MAX;
+  }
+
+  auto const ns = std::max<int64_t>(period.count(), 1);
+  itimerspec spec = {};
+  spec.it_interval.tv_sec = static_cast<time_t>(ns / 1000000000);
+  spec.it_interval.tv_nsec = static_cast<long>(ns % 1000000000);
+  spec.it_value = spec.it_interval;
+  if (::timerfd_settime(timer, 0, &spec, nullptr) != 0) {
+    ec.assign(errno, std::generic_category());
+    ::close(timer);
+    return UINT32_MAX;
+  }
+
+  auto const id = add(timer, std::move(cb), ec);
+  if (ec) {
+    ::close(timer);
+    return UINT32_MAX;
+  }
+
+  _sources[id].timer = true;
+  return id;
+} // plat::event_loop::add_timer
+
+void plat::event_loop::remove(source_id id) noexcept {
+  if (id >= _sources.size() || !_sources[id].active) return;
+  ::epoll_ctl(_fd, EPOLL_CTL_DEL, _sources[id].handle, nullptr);
+  if (_sources[id].timer) ::close(_sources[id].handle);
+  _sources[id] = source{};
+} // plat::event_loop::remove
+
+std::size_t plat::event_loop::wait(std::chrono::nanoseconds timeout) noexcept {
+  if (_fd < 0) {
+    // Nothing to wait for but the timeout
+    if (timeout > std::chrono::nanoseconds{0} && timeout != forever) {
+      ::usleep(static_cast<useconds_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(timeout)
+          .count()));
+    }
+    return 0;
+  }
+
+  int const ms = timeout == forever
+                   ? -1
+                   : static_cast<int>(std::min<int64_t>(
+                       to_milliseconds(timeout).count(), INT32_MAX));
+
+  std::array<epoll_event, 16> events;
+  int const count = ::epoll_wait(_fd, events.data(),
+                                 static_cast<int>(events.size()), ms);
+  if (count <= 0) return 0; // timeout, or EINTR
+
+  for (int i = 0; i < count; ++i) run(events[i].data.u32);
+  return static_cast<std::size_t>(count);
+} // plat::event_loop::wait
+
+plat::event_loop::event_loop(event_loop&& other) noexcept
+: _fd{other._fd}
+, _sources{std::move(other._sources)} {
+  other._fd = -1;
+  other._sources.clear();
+} // plat::event_loop::event_loop
+
+plat::event_loop& plat::event_loop::operator=(event_loop&& rhs) noexcept {
+  if (this == &rhs) return *this;
+  close();
+  _fd = rhs._fd;
+  _sources = std::move(rhs._sources);
+  rhs._fd = -1;
+  rhs._sources.clear();
+  return *this;
+} // plat::event_loop::operator=
+
+void plat::event_loop::close() noexcept {
+  for (auto&& s : _sources) {
+    if (s.active && s.timer) ::close(s.handle);
+  }
+  _sources.clear();
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+} // plat::event_loop::close
+
+#endif // TURF_TARGET_WIN32
+
+plat::event_loop::~event_loop() noexcept {
+  close();
+} // plat::event_loop::~event_loop
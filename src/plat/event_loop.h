@@ -0,0 +1,79 @@
+#ifndef VKST_PLAT_EVENT_LOOP_H
+#define VKST_PLAT_EVENT_LOOP_H
+
+#include <turf/c/core.h>
+#include <gsl.h>
+#include <chrono>
+#include <functional>
+#include <system_error>
+#include <vector>
+
+namespace plat {
+
+// Sleeps until one of a set of event sources is ready, or a timeout passes,
+// and runs the callbacks of the ready sources. A source is a descriptor that
+// becomes readable, such as an X connection or inotify, or a repeating timer.
+// On Linux this is epoll; on Win32 sources are waitable handles and the wait
+// also ends for window messages and runs completion routines.
+class event_loop {
+public:
+#if TURF_TARGET_WIN32
+  using native_handle = void*; // HANDLE
+#else
+  using native_handle = int;
+#endif
+
+  using source_id = uint32_t;
+  using callback = std::function<void()>;
+
+  static constexpr std::chrono::nanoseconds forever =
+    std::chrono::nanoseconds::max();
+
+  // Wake when handle is ready and run cb, which must clear the condition,
+  // e.g. by reading the descriptor. cb may be empty for a source that only
+  // ends the wait. The caller keeps ownership of handle. If ec is true, then
+  // an error occurred.
+  source_id add(native_handle handle, callback cb,
+                std::error_code& ec) noexcept;
+
+  // Run cb every period, starting one period from now. Expirations missed
+  // while not waiting are coalesced into one call. If ec is true, then an
+  // error occurred.
+  source_id add_timer(std::chrono::nanoseconds period, callback cb,
+                      std::error_code& ec) noexcept;
+
+  void remove(source_id id) noexcept;
+
+  // Wait up to timeout for a source to be ready, then run the callbacks of
+  // every ready source. A timeout of zero only checks. Returns the number of
+  // sources that were ready.
+  std::size_t wait(std::chrono::nanoseconds timeout) noexcept;
+
+  event_loop() noexcept = default;
+  event_loop(event_loop const&) = delete;
+  event_loop(event_loop&& other) noexcept;
+  event_loop& operator=(event_loop const&) = delete;
+  event_loop& operator=(event_loop&& rhs) noexcept;
+  ~event_loop() noexcept;
+
+private:
+  struct source {
+    native_handle handle{};
+    callback cb{};
+    bool timer{false}; // handle is owned by the loop
+    bool active{false};
+  }; // struct source
+
+  source_id insert(source s) noexcept;
+  void run(source_id id) noexcept;
+  void close() noexcept; // remove every source
+
+#if !TURF_TARGET_WIN32
+  int _fd{-1}; // the epoll instance, created by the first add
+#endif
+  std::vector<source> _sources{}; // by source_id
+}; // class event_loop
+
+} // namespace plat
+
+#endif // VKST_PLAT_EVENT_LOOP_H
@@ -1,5 +1,15 @@
 #include "file_handle.h"
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
+
+#if TURF_TARGET_WIN32
+#  include <io.h>
+#else
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
 
 plat::file_handle plat::file_handle::open(plat::filesystem::path const& path,
                                           open_modes mode,
@@ -14,5 +24,282 @@ plat::file_handle plat::file_handle::open(plat::filesystem::path const& path,
 
   if (!fh) ec.assign(EIO, std::generic_category());
   else ec.clear();
+
+  if (fh && (mode & open_modes::direct) == open_modes::direct) {
+    std::setvbuf(fh, nullptr, _IONBF, 0);
+  }
+
   return fh;
 } // plat::file_handle::open
+
+std::size_t plat::file_handle::read(void* data, std::size_t size,
+                                    std::error_code& ec) noexcept {
+  ec.clear();
+  auto const nread = std::fread(data, 1, size, get());
+  if (std::ferror(get())) ec.assign(EIO, std::generic_category());
+  return nread;
+} // plat::file_handle::read
+
+std::size_t plat::file_handle::write(void const* data, std::size_t size,
+                                     std::error_code& ec) noexcept {
+  ec.clear();
+  auto const nwritten = std::fwrite(data, 1, size, get());
+  if (nwritten != size) ec.assign(EIO, std::generic_category());
+  return nwritten;
+} // plat::file_handle::write
+
+#if TURF_TARGET_WIN32
+
+std::size_t plat::file_handle::read_at(uint64_t offset, void* data,
+                                       std::size_t size,
+                                       std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(get())));
+  auto bytes = static_cast<char*>(data);
+  std::size_t total = 0;
+
+  while (total < size) {
+    OVERLAPPED o = {};
+    o.Offset = static_cast<DWORD>(offset + total);
+    o.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+    DWORD nread = 0;
+    DWORD const count =
+      static_cast<DWORD>(std::min<std::size_t>(size - total, 1u << 30));
+    if (!ReadFile(h, bytes + total, count, &nread, &o)) {
+      if (GetLastError() == ERROR_HANDLE_EOF) break;
+      ec.assign(GetLastError(), std::system_category());
+      break;
+    }
+    if (nread == 0) break;
+    total += nread;
+  }
+
+  return total;
+} // plat::file_handle::read_at
+
+std::size_t plat::file_handle::write_at(uint64_t offset, void const* data,
+                                        std::size_t size,
+                                        std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(get())));
+  auto bytes = static_cast<char const*>(data);
+  std::size_t total = 0;
+
+  while (total < size) {
+    OVERLAPPED o = {};
+    o.Offset = static_cast<DWORD>(offset + total);
+    o.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+    DWORD nwritten = 0;
+    DWORD const count =
+      static_cast<DWORD>(std::min<std::size_t>(size - total, 1u << 30));
+    if (!WriteFile(h, bytes + total, count, &nwritten, &o)) {
+      ec.assign(GetLastError(), std::system_category());
+      break;
+    }
+    total += nwritten;
+  }
+
+  return total;
+} // plat::file_handle::write_at
+
+void plat::file_handle::seek(uint64_t offset, std::error_code& ec) noexcept {
+  if (_fseeki64(get(), static_cast<__int64>(offset), SEEK_SET) != 0) {
+    ec.assign(errno, std::generic_category());
+  } else {
+    ec.clear();
+  }
+} // plat::file_handle::seek
+
+uint64_t plat::file_handle::tell(std::error_code& ec) noexcept {
+  auto const pos = _ftelli64(get());
+  if (pos < 0) {
+    ec.assign(errno, std::generic_category());
+    return 0;
+  }
+  ec.clear();
+  return static_cast<uint64_t>(pos);
+} // plat::file_handle::tell
+
+uint64_t plat::file_handle::size(std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  LARGE_INTEGER size;
+  auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(get())));
+  if (!GetFileSizeEx(h, &size)) {
+    ec.assign(GetLastError(), std::system_category());
+    return 0;
+  }
+  return static_cast<uint64_t>(size.QuadPart);
+} // plat::file_handle::size
+
+void plat::file_handle::sync(std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return;
+
+  auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(get())));
+  if (!FlushFileBuffers(h)) ec.assign(GetLastError(), std::system_category());
+} // plat::file_handle::sync
+
+#else // TURF_TARGET_WIN32
+
+std::size_t plat::file_handle::read_at(uint64_t offset, void* data,
+                                       std::size_t size,
+                                       std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  int const fd = fileno(get());
+  auto bytes = static_cast<char*>(data);
+  std::size_t total = 0;
+
+  while (total < size) {
+    auto const nread = ::pread(fd, bytes + total, size - total,
+                               static_cast<off_t>(offset + total));
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      ec.assign(errno, std::generic_category());
+      break;
+    }
+    if (nread == 0) break;
+    total += static_cast<std::size_t>(nread);
+  }
+
+  return total;
+} // plat::file_handle::read_at
+
+std::size_t plat::file_handle::write_at(uint64_t offset, void const* data,
+                                        std::size_t size,
+                                        std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  int const fd = fileno(get());
+  auto bytes = static_cast<char const*>(data);
+  std::size_t total = 0;
+
+  while (total < size) {
+    auto const nwritten = ::pwrite(fd, bytes + total, size - total,
+                                   static_cast<off_t>(offset + total));
+    if (nwritten < 0) {
+      if (errno == EINTR) continue;
+      ec.assign(errno, std::generic_category());
+      break;
+    }
+    total += static_cast<std::size_t>(nwritten);
+  }
+
+  return total;
+} // plat::file_handle::write_at
+
+void plat::file_handle::seek(uint64_t offset, std::error_code& ec) noexcept {
+  if (::fseeko(get(), static_cast<off_t>(offset), SEEK_SET) != 0) {
+    ec.assign(errno, std::generic_category());
+  } else {
+    ec.clear();
+  }
+} // plat::file_handle::seek
+
+uint64_t plat::file_handle::tell(std::error_code& ec) noexcept {
+  auto const pos = ::ftello(get());
+  if (pos < 0) {
+    ec.assign(errno, std::generic_category());
+    return 0;
+  }
+  ec.clear();
+  return static_cast<uint64_t>(pos);
+} // plat::file_handle::tell
+
+uint64_t plat::file_handle::size(std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return 0;
+
+  struct stat st;
+  if (::fstat(fileno(get()), &st) != 0) {
+    ec.assign(errno, std::generic_category());
+    return 0;
+  }
+  return static_cast<uint64_t>(st.st_size);
+} // plat::file_handle::size
+
+void plat::file_handle::sync(std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return;
+
+  while (::fsync(fileno(get())) != 0) {
+    if (errno == EINTR) continue;
+    ec.assign(errno, std::generic_category());
+    break;
+  }
+} // plat::file_handle::sync
+
+#endif // TURF_TARGET_WIN32
+
+void plat::file_handle::flush(std::error_code& ec) noexcept {
+  if (std::fflush(get()) != 0) ec.assign(EIO, std::generic_category());
+  else ec.clear();
+} // plat::file_handle::flush
+
+void plat::buffered_writer::write(void const* data, std::size_t size,
+                                  std::error_code& ec) noexcept {
+  ec.clear();
+  auto const capacity = _buffer.size();
+
+  if (_used + size > capacity) {
+    flush(ec);
+    if (ec) return;
+  }
+
+  if (size >= capacity) {
+    _fh.write(data, size, ec);
+    return;
+  }
+
+  std::memcpy(_buffer.data() + _used, data, size);
+  _used += size;
+} // plat::buffered_writer::write
+
+void plat::buffered_writer::flush(std::error_code& ec) noexcept {
+  ec.clear();
+  if (_used > 0) {
+    _fh.write(_buffer.data(), _used, ec);
+    _used = 0;
+    if (ec) return;
+  }
+
+  if (_fh) _fh.flush(ec);
+} // plat::buffered_writer::flush
+
+plat::buffered_writer::buffered_writer(buffered_writer&& other) noexcept
+: _fh{std::move(other._fh)}
+, _buffer{std::move(other._buffer)}
+, _used{other._used} {
+  other._used = 0;
+} // plat::buffered_writer::buffered_writer
+
+plat::buffered_writer& plat::buffered_writer::
+operator=(buffered_writer&& rhs) noexcept {
+  if (this == &rhs) return *this;
+
+  std::error_code ec;
+  flush(ec);
+
+  _fh = std::move(rhs._fh);
+  _buffer = std::move(rhs._buffer);
+  _used = rhs._used;
+
+  rhs._used = 0;
+  return *this;
+} // plat::buffered_writer::operator=
+
+plat::buffered_writer::~buffered_writer() noexcept {
+  if (!_fh) return;
+  std::error_code ec;
+  flush(ec);
+} // plat::buffered_writer::~buffered_writer
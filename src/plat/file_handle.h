@@ -4,6 +4,10 @@
 #include <plat/filesystem.h>
 #include <turf/c/core.h>
 #include <gsl.h>
+#include <cstdio>
+#include <system_error>
+#include <type_traits>
+#include <vector>
 
 namespace plat {
 
@@ -14,6 +18,7 @@ public:
     read = 0x1,
     write = 0x2,
     append = 0x4,
+    direct = 0x8, // no stdio buffer, every write goes straight to the OS
   }; // enum class open_modes
 
   static file_handle open(plat::filesystem::path const& path, open_modes mode,
@@ -24,10 +29,75 @@ public:
   std::FILE* get() noexcept { return _handle.get(); }
   operator std::FILE*() noexcept { return get(); }
 
+#if !TURF_TARGET_WIN32
+  // The OS file descriptor, for I/O that bypasses stdio.
+  int descriptor() noexcept { return fileno(get()); }
+#endif
+
   explicit operator bool() noexcept { return static_cast<bool>(_handle); }
 
   void reset() noexcept { _handle.reset(); }
 
+  // Read or write size bytes at the current position, which advances past
+  // them. Returns the number of bytes transferred; a short read at the end
+  // of the file is not an error. If ec is true, then an error occurred.
+  std::size_t read(void* data, std::size_t size, std::error_code& ec) noexcept;
+  std::size_t write(void const* data, std::size_t size,
+                    std::error_code& ec) noexcept;
+
+  // Read or write size bytes at offset without using or moving the current
+  // position (on Win32 the position does move), so several readers can share
+  // one handle. Buffered writes are flushed first. A handle opened to append
+  // always writes at the end.
+  std::size_t read_at(uint64_t offset, void* data, std::size_t size,
+                      std::error_code& ec) noexcept;
+  std::size_t write_at(uint64_t offset, void const* data, std::size_t size,
+                       std::error_code& ec) noexcept;
+
+  // Typed versions of the above; counts are in values rather than bytes.
+  template <class T>
+  std::size_t read(gsl::span<T> values, std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    return read(values.data(), values.size() * sizeof(T), ec) / sizeof(T);
+  }
+
+  template <class T>
+  std::size_t write(gsl::span<T> values, std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    return write(values.data(), values.size() * sizeof(T), ec) / sizeof(T);
+  }
+
+  template <class T>
+  std::size_t read_at(uint64_t offset, gsl::span<T> values,
+                      std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    return read_at(offset, values.data(), values.size() * sizeof(T), ec) /
+           sizeof(T);
+  }
+
+  template <class T>
+  std::size_t write_at(uint64_t offset, gsl::span<T> values,
+                       std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    return write_at(offset, values.data(), values.size() * sizeof(T), ec) /
+           sizeof(T);
+  }
+
+  void seek(uint64_t offset, std::error_code& ec) noexcept;
+  uint64_t tell(std::error_code& ec) noexcept;
+
+  // The size of the file, including any buffered writes.
+  uint64_t size(std::error_code& ec) noexcept;
+
+  void flush(std::error_code& ec) noexcept;
+
+  // Flush, then wait until the OS has written the file to the storage device.
+  void sync(std::error_code& ec) noexcept;
+
 private:
   file_handle(FILE* handle) noexcept : _handle{handle, &std::fclose} {}
 
@@ -49,6 +119,48 @@ inline constexpr auto operator&(file_handle::open_modes a,
                                               static_cast<U>(b));
 }
 
+// Writes to a file through a buffer of a size the caller picks, so the OS
+// sees writes of that size however small the individual writes are. Writes
+// that do not fit in the buffer are written directly after flushing it.
+// Open the file with open_modes::direct so stdio does not buffer the data a
+// second time. The destructor flushes but cannot report errors, so call
+// flush to see them.
+class buffered_writer {
+public:
+  buffered_writer(file_handle fh, std::size_t buffer_size) noexcept
+  : _fh{std::move(fh)}
+  , _buffer(buffer_size) {}
+
+  void write(void const* data, std::size_t size, std::error_code& ec) noexcept;
+
+  template <class T>
+  void write(gsl::span<T> values, std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "values must be trivially copyable");
+    write(values.data(), values.size() * sizeof(T), ec);
+  }
+
+  // Write the buffered bytes to the file.
+  void flush(std::error_code& ec) noexcept;
+
+  std::size_t buffered() const noexcept { return _used; }
+  file_handle& handle() noexcept { return _fh; }
+
+  explicit operator bool() noexcept { return static_cast<bool>(_fh); }
+
+  buffered_writer() noexcept = default;
+  buffered_writer(buffered_writer const&) = delete;
+  buffered_writer(buffered_writer&& other) noexcept;
+  buffered_writer& operator=(buffered_writer const&) = delete;
+  buffered_writer& operator=(buffered_writer&& rhs) noexcept;
+  ~buffered_writer() noexcept;
+
+private:
+  file_handle _fh{};
+  std::vector<char> _buffer{};
+  std::size_t _used{0};
+}; // class buffered_writer
+
 } // namespace plat
 
-#endif // VKST_PLAT_FILE_HANDLE_H
\ No newline at end of file
+#endif // VKST_PLAT_FILE_HANDLE_H
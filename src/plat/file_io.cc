@@ -1,20 +1,90 @@
 #include "file_io.h"
 #include "file_handle.h"
+#include <atomic>
+#include <cstdio>
+
+#if TURF_TARGET_WIN32
+#  include <process.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
 
 std::vector<char> plat::read_file(plat::filesystem::path const& path,
                                   std::error_code& ec) noexcept {
   auto fh = plat::file_handle::open(path, plat::file_handle::open_modes::read, ec);
   if (ec) return {};
 
-  std::fseek(fh, 0, SEEK_END);
-  std::vector<char> bytes(std::ftell(fh));
-  std::rewind(fh);
+  auto const size = fh.size(ec);
+  if (ec) return {};
 
-  auto const nread = std::fread(bytes.data(), sizeof(char), bytes.size(), fh);
-  if (ferror(fh) || nread != bytes.size()) {
-    ec.assign(EIO, std::generic_category());
-  }
+  std::vector<char> bytes(gsl::narrow_cast<std::size_t>(size));
+  auto const nread = fh.read(bytes.data(), bytes.size(), ec);
+  if (!ec && nread != bytes.size()) ec.assign(EIO, std::generic_category());
 
   return bytes;
 } // read_file
 
+void plat::write_file(plat::filesystem::path const& path,
+                      gsl::span<char const> bytes,
+                      std::error_code& ec) noexcept {
+  auto fh =
+    plat::file_handle::open(path, plat::file_handle::open_modes::write, ec);
+  if (ec) return;
+
+  fh.write(bytes, ec);
+} // write_file
+
+// A name in the directory of path that no other thread or process writing
+// path at the same time will pick.
+static plat::filesystem::path
+temp_path(plat::filesystem::path const& path) noexcept {
+  static std::atomic<uint32_t> s_count{0};
+#if TURF_TARGET_WIN32
+  auto const pid = static_cast<unsigned>(_getpid());
+#else
+  auto const pid = static_cast<unsigned>(::getpid());
+#endif
+
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), ".%u.%u.tmp", pid, s_count++);
+
+  auto temp = path;
+  temp += suffix;
+  return temp;
+} // temp_path
+
+void plat::write_file_atomic(plat::filesystem::path const& path,
+                             gsl::span<char const> bytes,
+                             std::error_code& ec) noexcept {
+  auto const temp = temp_path(path);
+
+  {
+    auto fh =
+      plat::file_handle::open(temp, plat::file_handle::open_modes::write, ec);
+    if (ec) return;
+
+    fh.write(bytes, ec);
+    if (!ec) fh.sync(ec);
+  }
+
+  if (!ec) plat::filesystem::rename(temp, path, ec);
+  if (ec) {
+    std::error_code remove_ec;
+    plat::filesystem::remove(temp, remove_ec);
+    return;
+  }
+
+#if !TURF_TARGET_WIN32
+  // Sync the directory too so the rename itself survives a crash. Not every
+  // file system allows this, and the data is already safe, so errors here
+  // are ignored.
+  auto const directory = path.has_parent_path() ? path.parent_path().string()
+                                                 : std::string(".");
+  int const fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#endif
+} // write_file_atomic
@@ -2,6 +2,7 @@
 #define VKST_PLAT_FILE_IO_H
 
 #include <plat/filesystem.h>
+#include <gsl.h>
 #include <system_error>
 #include <vector>
 
@@ -11,6 +12,18 @@ namespace plat {
 std::vector<char> read_file(plat::filesystem::path const& path,
                             std::error_code& ec) noexcept;
 
+// Write bytes to a file, replacing any existing contents.
+void write_file(plat::filesystem::path const& path,
+                gsl::span<char const> bytes, std::error_code& ec) noexcept;
+
+// Write bytes to a file so that it either keeps its old contents or has all
+// of the new ones, even if the process or machine dies part way through. The
+// bytes go to a temporary file next to path, which is synced and then renamed
+// over path.
+void write_file_atomic(plat::filesystem::path const& path,
+                       gsl::span<char const> bytes,
+                       std::error_code& ec) noexcept;
+
 } // namespace plat
 
-#endif // VKST_PLAT_FILE_IO_H
\ No newline at end of file
+#endif // VKST_PLAT_FILE_IO_H
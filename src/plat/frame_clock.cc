@@ -0,0 +1,47 @@
+#include "frame_clock.h"
+
+plat::frame_clock plat::frame_clock::realtime() noexcept {
+  frame_clock c;
+  c._mode = modes::realtime;
+  return c;
+} // plat::frame_clock::realtime
+
+plat::frame_clock plat::frame_clock::fixed_step(duration step) noexcept {
+  frame_clock c;
+  c._mode = modes::fixed_step;
+  c._step = step;
+  return c;
+} // plat::frame_clock::fixed_step
+
+plat::frame_clock
+plat::frame_clock::recorded(std::vector<duration> times) noexcept {
+  frame_clock c;
+  c._mode = modes::recorded;
+  c._times = std::move(times);
+  return c;
+} // plat::frame_clock::recorded
+
+bool plat::frame_clock::tick() noexcept {
+  duration next{};
+
+  switch (_mode) {
+  case modes::realtime:
+    if (_ticks == 0) _start = clock::now();
+    next = std::chrono::duration_cast<duration>(clock::now() - _start);
+    break;
+
+  case modes::fixed_step:
+    next = _step * static_cast<int64_t>(_ticks);
+    break;
+
+  case modes::recorded:
+    if (_ticks >= _times.size()) return false;
+    next = _times[_ticks];
+    break;
+  }
+
+  _delta = (_ticks == 0) ? duration{} : next - _elapsed;
+  _elapsed = next;
+  _ticks += 1;
+  return true;
+} // plat::frame_clock::tick
@@ -0,0 +1,63 @@
+#ifndef VKST_PLAT_FRAME_CLOCK_H
+#define VKST_PLAT_FRAME_CLOCK_H
+
+#include <turf/c/core.h>
+#include <chrono>
+#include <vector>
+
+namespace plat {
+
+// A source of per-frame time. A realtime clock follows the steady clock, a
+// fixed_step clock advances by a constant step each tick regardless of how
+// long the frame took, and a recorded clock replays a previously captured
+// sequence of elapsed times. The latter two make runs reproducible.
+class frame_clock {
+public:
+  using duration = std::chrono::nanoseconds;
+
+  enum class modes : uint8_t {
+    realtime,
+    fixed_step,
+    recorded,
+  }; // enum class modes
+
+  static frame_clock realtime() noexcept;
+  static frame_clock fixed_step(duration step) noexcept;
+  static frame_clock recorded(std::vector<duration> times) noexcept;
+
+  modes mode() const noexcept { return _mode; }
+
+  // Advance to the next frame. Returns false once a recorded clock has run
+  // out of times; the realtime and fixed_step clocks never run out.
+  bool tick() noexcept;
+
+  // Time since the first tick and time since the previous tick.
+  duration elapsed() const noexcept { return _elapsed; }
+  duration delta() const noexcept { return _delta; }
+
+  // Number of completed ticks.
+  uint64_t ticks() const noexcept { return _ticks; }
+
+  frame_clock() noexcept = default;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  modes _mode{modes::realtime};
+  clock::time_point _start{};
+  duration _step{};
+  std::vector<duration> _times{};
+
+  duration _elapsed{};
+  duration _delta{};
+  uint64_t _ticks{0};
+}; // class frame_clock
+
+// Convert a frame_clock duration to floating point seconds.
+inline float to_seconds(frame_clock::duration d) noexcept {
+  return std::chrono::duration<float>{d}.count();
+}
+
+} // namespace plat
+
+#endif // VKST_PLAT_FRAME_CLOCK_H
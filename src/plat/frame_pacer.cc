@@ -0,0 +1,137 @@
+#include "frame_pacer.h"
+#include <cerrno>
+#include <thread>
+
+#if TURF_TARGET_WIN32
+#  include <Windows.h>
+#else
+#  include <time.h>
+#endif
+
+// How far ahead of the start time the OS sleep should end. A Linux
+// clock_nanosleep wakes within tens of microseconds of the requested time on
+// an idle machine. A high resolution waitable timer on Win32 is about as
+// accurate, but older versions of Windows fall back to a normal timer that
+// fires on the next scheduler tick, so leave it more room.
+#if TURF_TARGET_WIN32
+static constexpr std::chrono::microseconds SPIN_MARGIN{2000};
+#else
+static constexpr std::chrono::microseconds SPIN_MARGIN{250};
+#endif
+
+plat::frame_pacer::frame_pacer(duration period) noexcept
+: _period{period} {
+#if TURF_TARGET_WIN32
+  // Created once rather than every frame. Fall back to a normal timer where
+  // high resolution timers are not supported.
+  _timer = CreateWaitableTimerExW(nullptr, nullptr,
+                                  CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                  TIMER_ALL_ACCESS);
+  if (!_timer) {
+    _timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  }
+#endif
+  reset();
+} // plat::frame_pacer::frame_pacer
+
+plat::frame_pacer::frame_pacer(frame_pacer&& other) noexcept
+: _timer{other._timer}
+, _period{other._period}
+, _work{other._work}
+, _due{other._due}
+, _start{other._start} {
+  other._timer = nullptr;
+} // plat::frame_pacer::frame_pacer
+
+plat::frame_pacer& plat::frame_pacer::operator=(frame_pacer&& rhs) noexcept {
+  if (this == &rhs) return *this;
+#if TURF_TARGET_WIN32
+  if (_timer) CloseHandle(_timer);
+#endif
+  _timer = rhs._timer;
+  _period = rhs._period;
+  _work = rhs._work;
+  _due = rhs._due;
+  _start = rhs._start;
+  rhs._timer = nullptr;
+  return *this;
+} // plat::frame_pacer::operator=
+
+plat::frame_pacer::~frame_pacer() noexcept {
+#if TURF_TARGET_WIN32
+  if (_timer) CloseHandle(_timer);
+#endif
+} // plat::frame_pacer::~frame_pacer
+
+plat::frame_pacer::duration plat::frame_pacer::wait() noexcept {
+  auto const start = _due - _work;
+  if (clock::now() < start) sleep_until(start);
+
+  _start = clock::now();
+  return _start - start;
+} // plat::frame_pacer::wait
+
+void plat::frame_pacer::presented() noexcept {
+  auto const now = clock::now();
+  auto const work = now - _start;
+
+  // Grow immediately so the next frame starts early enough, but shrink
+  // slowly so one quick frame does not make the next one late.
+  if (work > _work) _work = work;
+  else _work -= (_work - work) / 16;
+
+  // Stay on the schedule unless a frame took so long a whole period was
+  // missed, then start a new one from now.
+  _due += _period;
+  if (_due < now) _due = now + _period;
+} // plat::frame_pacer::presented
+
+void plat::frame_pacer::reset() noexcept {
+  _due = clock::now() + _work;
+} // plat::frame_pacer::reset
+
+#if TURF_TARGET_WIN32
+
+void plat::frame_pacer::sleep_until(clock::time_point time) noexcept {
+  using namespace std::chrono;
+
+  auto const wake = time - SPIN_MARGIN;
+  auto const now = clock::now();
+  if (now < wake) {
+    // A negative due time is relative, in 100ns units
+    LARGE_INTEGER due;
+    due.QuadPart = -duration_cast<nanoseconds>(wake - now).count() / 100;
+    if (_timer && SetWaitableTimer(_timer, &due, 0, nullptr, nullptr, FALSE)) {
+      WaitForSingleObject(_timer, INFINITE);
+    } else {
+      Sleep(
+        static_cast<DWORD>(duration_cast<milliseconds>(wake - now).count()));
+    }
+  }
+
+  while (clock::now() < time) std::this_thread::yield();
+} // plat::frame_pacer::sleep_until
+
+#else // TURF_TARGET_WIN32
+
+void plat::frame_pacer::sleep_until(clock::time_point time) noexcept {
+  using namespace std::chrono;
+
+  // steady_clock is CLOCK_MONOTONIC, so its time points can be used directly
+  // as an absolute clock_nanosleep time, which does not drift when the sleep
+  // is interrupted and restarted.
+  auto const wake = time - SPIN_MARGIN;
+  if (clock::now() < wake) {
+    auto const ns = duration_cast<nanoseconds>(wake.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+           EINTR) {
+    }
+  }
+
+  while (clock::now() < time) std::this_thread::yield();
+} // plat::frame_pacer::sleep_until
+
+#endif // TURF_TARGET_WIN32
@@ -0,0 +1,64 @@
+#ifndef VKST_PLAT_FRAME_PACER_H
+#define VKST_PLAT_FRAME_PACER_H
+
+#include <turf/c/core.h>
+#include <chrono>
+
+namespace plat {
+
+// Holds a render loop to a target frame rate. Each frame is due to be
+// presented one period after the last; wait() sleeps until the frame should
+// start so that it is presented just as it falls due, which keeps the input
+// it reads as fresh as possible. How long a frame takes from wait() returning
+// to presented() is tracked so the start can be scheduled that far ahead.
+//
+// The OS sleep alone wakes up anywhere from tens of microseconds to a
+// scheduler tick late, so wait() sleeps until a spin margin before the start
+// time and spins the rest of the way.
+class frame_pacer {
+public:
+  using clock = std::chrono::steady_clock;
+  using duration = std::chrono::nanoseconds;
+
+  explicit frame_pacer(duration period) noexcept;
+
+  duration period() const noexcept { return _period; }
+
+  // The expected time from wait() returning to presented().
+  duration work() const noexcept { return _work; }
+
+  // Sleep until the next frame should start. Returns how far from the
+  // scheduled start it woke: the pacing error. A frame that was already late
+  // does not wait and returns how late it is.
+  duration wait() noexcept;
+
+  // Call once the frame has been presented, to update the work estimate and
+  // schedule the next frame.
+  void presented() noexcept;
+
+  // Restart the schedule with the next frame due now, after the loop has
+  // been paused, so the pause is not reported as pacing error.
+  void reset() noexcept;
+
+  frame_pacer() noexcept = default;
+  frame_pacer(frame_pacer const&) = delete;
+  frame_pacer(frame_pacer&& other) noexcept;
+  frame_pacer& operator=(frame_pacer const&) = delete;
+  frame_pacer& operator=(frame_pacer&& rhs) noexcept;
+  ~frame_pacer() noexcept;
+
+private:
+  // Sleep in the OS until time, returning early by no more than the spin
+  // margin, then spin until time.
+  void sleep_until(clock::time_point time) noexcept;
+
+  void* _timer{nullptr}; // Win32 waitable timer reused by every sleep
+  duration _period{};
+  duration _work{};
+  clock::time_point _due{};   // when the next frame should be presented
+  clock::time_point _start{}; // when wait() last returned
+}; // class frame_pacer
+
+} // namespace plat
+
+#endif // VKST_PLAT_FRAME_PACER_H
@@ -0,0 +1,111 @@
+#include "frame_stats.h"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+
+#if TURF_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+static uint32_t most_significant_bit(uint64_t value) noexcept {
+#if TURF_COMPILER_MSVC
+  unsigned long index;
+  _BitScanReverse64(&index, value | 1);
+  return static_cast<uint32_t>(index);
+#else
+  return 63 - static_cast<uint32_t>(__builtin_clzll(value | 1));
+#endif
+} // most_significant_bit
+
+uint32_t plat::histogram::index_of(uint64_t value) noexcept {
+  uint32_t const msb = most_significant_bit(value);
+  if (msb < SUB_BITS) return static_cast<uint32_t>(value);
+
+  // value >> shift is in [HALF_SUB_COUNT, 2 * HALF_SUB_COUNT)
+  uint32_t const shift = msb - SUB_BITS + 1;
+  return shift * HALF_SUB_COUNT + static_cast<uint32_t>(value >> shift);
+} // plat::histogram::index_of
+
+uint64_t plat::histogram::highest_value_of(uint32_t index) noexcept {
+  if (index < 2 * HALF_SUB_COUNT) return index;
+
+  uint32_t const shift = index / HALF_SUB_COUNT - 1;
+  uint64_t const lowest = uint64_t{index - shift * HALF_SUB_COUNT} << shift;
+  return lowest + (uint64_t{1} << shift) - 1;
+} // plat::histogram::highest_value_of
+
+void plat::histogram::record(uint64_t value) noexcept {
+  value = std::min(value, (uint64_t{1} << MAX_BITS) - 1);
+
+  _buckets[index_of(value)] += 1;
+  _count += 1;
+  _sum += value;
+  _min = std::min(_min, value);
+  _max = std::max(_max, value);
+} // plat::histogram::record
+
+uint64_t plat::histogram::percentile(double percent) const noexcept {
+  if (_count == 0) return 0;
+
+  auto const target = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(percent / 100.0 * _count)));
+
+  uint64_t seen{0};
+  for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += _buckets[i];
+    if (seen >= target) return std::min(highest_value_of(i), _max);
+  }
+
+  return _max;
+} // plat::histogram::percentile
+
+void plat::histogram::reset() noexcept {
+  _buckets.fill(0);
+  _count = 0;
+  _sum = 0;
+  _min = UINT64_MAX;
+  _max = 0;
+} // plat::histogram::reset
+
+void plat::frame_stats::write_header(std::FILE* fh) noexcept {
+  std::fputs("window,series,unit,count,mean,p50,p95,p99,max\n", fh);
+} // plat::frame_stats::write_header
+
+void plat::frame_stats::report(std::FILE* fh) noexcept {
+  // Durations are reported in milliseconds, counts as they are
+  auto const write = [this, fh](char const* name, histogram const& h,
+                                char const* unit, double scale) {
+    if (h.count() == 0) return;
+
+    double const p50 = h.percentile(50.0) / scale;
+    double const p95 = h.percentile(95.0) / scale;
+    double const p99 = h.percentile(99.0) / scale;
+    double const max = h.max() / scale;
+
+    LOG_INFO("frame stats %llu: %s n %llu p50 %.3f%s p95 %.3f%s p99 %.3f%s "
+             "max %.3f%s",
+             static_cast<unsigned long long>(_window), name,
+             static_cast<unsigned long long>(h.count()), p50, unit, p95, unit,
+             p99, unit, max, unit);
+
+    if (fh) {
+      std::fprintf(fh, "%llu,%s,%s,%llu,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                   static_cast<unsigned long long>(_window), name,
+                   (*unit ? unit : "count"),
+                   static_cast<unsigned long long>(h.count()),
+                   h.mean() / scale, p50, p95, p99, max);
+    }
+  };
+
+  for (std::size_t i = 0; i < _series.size(); ++i) {
+    write(to_string(static_cast<series>(i)), _series[i], "ms", 1e6);
+  }
+  for (std::size_t i = 0; i < _counters.size(); ++i) {
+    write(to_string(static_cast<counter>(i)), _counters[i], "", 1.0);
+  }
+
+  if (fh) std::fflush(fh);
+  for (auto&& h : _series) h.reset();
+  for (auto&& h : _counters) h.reset();
+  _window += 1;
+} // plat::frame_stats::report
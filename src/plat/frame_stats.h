@@ -0,0 +1,130 @@
+#ifndef VKST_PLAT_FRAME_STATS_H
+#define VKST_PLAT_FRAME_STATS_H
+
+#include <turf/c/core.h>
+#include <array>
+#include <chrono>
+#include <cstdio>
+
+namespace plat {
+
+// A fixed-size log-linear histogram in the style of HdrHistogram. Values
+// below 2^SUB_BITS are counted exactly; above that each power of two range
+// is split into 2^(SUB_BITS-1) buckets, so a reported value is within
+// 1 / 2^(SUB_BITS-1) of the recorded value. Recording is O(1) and never
+// allocates, so it is safe to call from the render loop.
+class histogram {
+public:
+  static constexpr uint32_t SUB_BITS = 7;
+  static constexpr uint32_t MAX_BITS = 40; // values are clamped to 2^40 - 1
+
+  void record(uint64_t value) noexcept;
+
+  // The value at or below which percentile percent of the recorded values
+  // fall. Returns 0 if no values have been recorded.
+  uint64_t percentile(double percent) const noexcept;
+
+  uint64_t count() const noexcept { return _count; }
+  uint64_t min() const noexcept { return _count ? _min : 0; }
+  uint64_t max() const noexcept { return _max; }
+  double mean() const noexcept {
+    return _count ? static_cast<double>(_sum) / _count : 0.0;
+  }
+
+  void reset() noexcept;
+
+private:
+  static constexpr uint32_t HALF_SUB_COUNT = 1u << (SUB_BITS - 1);
+  static constexpr uint32_t BUCKET_COUNT =
+    (MAX_BITS - SUB_BITS + 1) * HALF_SUB_COUNT + HALF_SUB_COUNT;
+
+  static uint32_t index_of(uint64_t value) noexcept;
+  static uint64_t highest_value_of(uint32_t index) noexcept;
+
+  std::array<uint32_t, BUCKET_COUNT> _buckets{};
+  uint64_t _count{0};
+  uint64_t _sum{0};
+  uint64_t _min{UINT64_MAX};
+  uint64_t _max{0};
+}; // class histogram
+
+// Per-frame timing statistics collected over a reporting window. Each series
+// is a histogram of nanosecond durations and each counter a histogram of
+// per-frame counts; report() writes the p50, p95, p99 and max of every one
+// to the log and optionally a file, then starts a new window.
+class frame_stats {
+public:
+  using duration = std::chrono::nanoseconds;
+
+  enum class series : uint8_t {
+    cpu_frame,     // start of one frame to the start of the next
+    acquire,       // waiting for the next swapchain image
+    submit,        // queue submission
+    present,       // queue present
+    pacing_error,  // frame pacer wake-up minus the scheduled frame start
+    input_latency, // oldest input event read in a frame to its present
+    count
+  }; // enum class series
+
+  enum class counter : uint8_t {
+    submits, // vkQueueSubmit calls
+    count
+  }; // enum class counter
+
+  void record(series s, duration d) noexcept {
+    _series[static_cast<std::size_t>(s)].record(
+      d.count() < 0 ? 0 : static_cast<uint64_t>(d.count()));
+  }
+
+  void record(counter c, uint64_t n) noexcept {
+    _counters[static_cast<std::size_t>(c)].record(n);
+  }
+
+  histogram const& operator[](series s) const noexcept {
+    return _series[static_cast<std::size_t>(s)];
+  }
+
+  histogram const& operator[](counter c) const noexcept {
+    return _counters[static_cast<std::size_t>(c)];
+  }
+
+  // Number of completed reporting windows.
+  uint64_t window() const noexcept { return _window; }
+
+  // Write the header line of the format written by report to fh.
+  static void write_header(std::FILE* fh) noexcept;
+
+  // Log the current window and, if fh is not null, append it to fh as
+  // comma-separated lines. Then reset all series for the next window.
+  void report(std::FILE* fh) noexcept;
+
+private:
+  std::array<histogram, static_cast<std::size_t>(series::count)> _series{};
+  std::array<histogram, static_cast<std::size_t>(counter::count)> _counters{};
+  uint64_t _window{0};
+}; // class frame_stats
+
+inline constexpr char const* to_string(frame_stats::series s) noexcept {
+  switch (s) {
+  case frame_stats::series::cpu_frame: return "cpu_frame";
+  case frame_stats::series::acquire: return "acquire";
+  case frame_stats::series::submit: return "submit";
+  case frame_stats::series::present: return "present";
+  case frame_stats::series::pacing_error: return "pacing_error";
+  case frame_stats::series::input_latency: return "input_latency";
+  case frame_stats::series::count: return "count";
+  }
+  return "unknown";
+}
+
+inline constexpr char const* to_string(frame_stats::counter c) noexcept {
+  switch (c) {
+  case frame_stats::counter::submits: return "submits";
+  case frame_stats::counter::count: return "count";
+  }
+  return "unknown";
+}
+
+} // namespace plat
+
+#endif // VKST_PLAT_FRAME_STATS_H
@@ -0,0 +1,50 @@
+#include "frame_trace.h"
+#include "file_io.h"
+#include <cstdio>
+
+plat::frame_trace::writer
+plat::frame_trace::writer::open(plat::filesystem::path const& path,
+                                uint32_t record_size,
+                                std::error_code& ec) noexcept {
+  writer w;
+  auto fh = file_handle::open(
+    path, file_handle::open_modes::write | file_handle::open_modes::direct, ec);
+  if (ec) return w;
+  w._out = buffered_writer{std::move(fh), BUFFER_SIZE};
+  w._record_size = record_size;
+
+  header const h{MAGIC, record_size};
+  w._out.write(&h, sizeof(h), ec);
+
+  return w;
+} // plat::frame_trace::writer::open
+
+void plat::frame_trace::writer::write(void const* record, std::size_t size,
+                                      std::error_code& ec) noexcept {
+  _out.write(record, size, ec);
+} // plat::frame_trace::writer::write
+
+plat::frame_trace::reader
+plat::frame_trace::reader::open(plat::filesystem::path const& path,
+                                uint32_t record_size,
+                                std::error_code& ec) noexcept {
+  reader r;
+  r._bytes = read_file(path, ec);
+  if (ec) return r;
+
+  header h;
+  if (r._bytes.size() < sizeof(h)) {
+    ec.assign(EINVAL, std::generic_category());
+    return r;
+  }
+
+  std::memcpy(&h, r._bytes.data(), sizeof(h));
+  if (h.magic != MAGIC || h.record_size != record_size) {
+    ec.assign(EINVAL, std::generic_category());
+    return r;
+  }
+
+  r._record_size = record_size;
+  r._count = (r._bytes.size() - sizeof(h)) / record_size;
+  return r;
+} // plat::frame_trace::reader::open
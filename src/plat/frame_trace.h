@@ -0,0 +1,86 @@
+#ifndef VKST_PLAT_FRAME_TRACE_H
+#define VKST_PLAT_FRAME_TRACE_H
+
+#include <plat/file_handle.h>
+#include <plat/filesystem.h>
+#include <gsl.h>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace plat {
+
+// A frame trace is a file holding a short header followed by one fixed-size
+// record per frame. Recording the per-frame inputs of a run and playing them
+// back makes the work done by each frame identical between runs.
+namespace frame_trace {
+
+constexpr uint32_t MAGIC = 0x31525456; // "VTR1"
+
+struct header {
+  uint32_t magic{MAGIC};
+  uint32_t record_size{0};
+}; // struct header
+
+// Appends records to a trace file.
+class writer {
+public:
+  static writer open(plat::filesystem::path const& path, uint32_t record_size,
+                     std::error_code& ec) noexcept;
+
+  template <class T>
+  void write(T const& record, std::error_code& ec) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "trace records must be trivially copyable");
+    Expects(sizeof(T) == _record_size);
+    write(&record, sizeof(T), ec);
+  }
+
+  explicit operator bool() noexcept { return static_cast<bool>(_out); }
+
+  writer() noexcept = default;
+
+private:
+  void write(void const* record, std::size_t size,
+             std::error_code& ec) noexcept;
+
+  // Records are small and written every frame, so they are batched into
+  // writes of this size.
+  static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+  buffered_writer _out{};
+  uint32_t _record_size{0};
+}; // class writer
+
+// Reads all of the records of a trace file into memory.
+class reader {
+public:
+  static reader open(plat::filesystem::path const& path, uint32_t record_size,
+                     std::error_code& ec) noexcept;
+
+  std::size_t size() const noexcept { return _count; }
+
+  template <class T>
+  T record(std::size_t index) const noexcept {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "trace records must be trivially copyable");
+    Expects(sizeof(T) == _record_size && index < _count);
+    T r;
+    std::memcpy(&r, _bytes.data() + sizeof(header) + index * _record_size,
+                sizeof(T));
+    return r;
+  }
+
+  reader() noexcept = default;
+
+private:
+  std::vector<char> _bytes{};
+  uint32_t _record_size{0};
+  std::size_t _count{0};
+}; // class reader
+
+} // namespace frame_trace
+} // namespace plat
+
+#endif // VKST_PLAT_FRAME_TRACE_H
@@ -3,18 +3,144 @@
 
 #if TURF_KERNEL_LINUX
 
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                       IN_MOVED_TO | IN_CLOSE_WRITE |
+                                       IN_DELETE_SELF | IN_ONLYDIR;
+
+plat::fs_notify::fs_notify() noexcept
+: _fd{::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)} {}
+
+plat::fs_notify::~fs_notify() noexcept {
+  if (_fd >= 0) ::close(_fd);
+} // plat::fs_notify::~fs_notify
+
+bool plat::fs_notify::add_directory(watch& w, plat::filesystem::path directory,
+                                    std::error_code& ec) noexcept {
+  int const wd = ::inotify_add_watch(_fd, directory.string().c_str(),
+                                     WATCH_MASK);
+  if (wd < 0) {
+    ec.assign(errno, std::generic_category());
+    return false;
+  }
+
+  w.directories.emplace_back(wd, std::move(directory));
+  return true;
+} // plat::fs_notify::add_directory
+
 plat::fs_notify::watch_id
 plat::fs_notify::do_add(plat::filesystem::path path,
                         impl::fs_notify<fs_notify>::notify_delegate delegate,
                         bool recursive, std::error_code& ec) noexcept {
-  return 0;
+  ec.clear();
+  if (_fd < 0) {
+    ec.assign(ENOSYS, std::generic_category());
+    return UINT32_MAX;
+  }
+
+  watch w;
+  w.directory = plat::filesystem::is_directory(path, ec);
+  if (ec) return UINT32_MAX;
+
+  w.path = std::move(path);
+  w.delegate = std::move(delegate);
+  w.recursive = recursive && w.directory;
+
+  if (!add_directory(w, w.directory ? w.path : w.path.parent_path(), ec)) {
+    return UINT32_MAX;
+  }
+
+  if (w.recursive) {
+    plat::filesystem::recursive_directory_iterator it{w.path, ec}, end;
+    for (; !ec && it != end; it.increment(ec)) {
+      if (plat::filesystem::is_directory(it->path(), ec) &&
+          !add_directory(w, it->path(), ec)) {
+        break;
+      }
+    }
+    if (ec) {
+      for (auto&& d : w.directories) ::inotify_rm_watch(_fd, d.first);
+      return UINT32_MAX;
+    }
+  }
+
+  _watches.push_back(std::move(w));
+  return gsl::narrow_cast<watch_id>(_watches.size() - 1);
 } // plat::fs_notify::do_add
 
 void plat::fs_notify::do_remove(watch_id id) noexcept {
+  if (id >= _watches.size()) return;
+
+  // inotify returns the same descriptor for every watch of one directory,
+  // so only remove those no other watch is using.
+  auto const in_use = [this](int wd) {
+    for (auto&& w : _watches) {
+      for (auto&& d : w.directories) {
+        if (d.first == wd) return true;
+      }
+    }
+    return false;
+  };
+
+  auto directories = std::move(_watches[id].directories);
+  _watches[id] = watch{};
+  for (auto&& d : directories) {
+    if (!in_use(d.first)) ::inotify_rm_watch(_fd, d.first);
+  }
 } // plat::fs_notify::do_remove
 
 void plat::fs_notify::do_tick() noexcept {
+  if (_fd < 0) return;
+
+  alignas(inotify_event) char buffer[16 * 1024];
+  while (true) {
+    auto const size = ::read(_fd, buffer, sizeof(buffer));
+    if (size < 0 && errno == EINTR) continue;
+    if (size <= 0) break; // EAGAIN when every event has been read
+
+    for (char* p = buffer; p < buffer + size;) {
+      auto const event = reinterpret_cast<inotify_event const*>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->len == 0) continue; // the directory itself
+
+      actions action = actions::modified;
+      if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        action = actions::added;
+      } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        action = actions::removed;
+      }
+
+      plat::filesystem::path const name{event->name};
+
+      // Indexed, as a delegate or a new subdirectory may add watches
+      for (std::size_t i = 0; i < _watches.size(); ++i) {
+        auto const& directories = _watches[i].directories;
+        auto const d = std::find_if(
+          directories.begin(), directories.end(),
+          [event](auto&& dir) { return dir.first == event->wd; });
+        if (d == directories.end()) continue;
+
+        auto const changed = d->second / name;
+        if (!_watches[i].directory && name != _watches[i].path.filename()) {
+          continue;
+        }
+
+        if (_watches[i].recursive && (event->mask & IN_ISDIR) &&
+            action == actions::added) {
+          std::error_code ec;
+          add_directory(_watches[i], changed, ec);
+        }
+
+        // Copied, as the delegate may add a watch and move _watches
+        auto const delegate = _watches[i].delegate;
+        delegate(gsl::narrow_cast<watch_id>(i), changed, action);
+      }
+    }
+  }
 } // plat::fs_notify::do_tick
 
 #endif // TURF_KERNEL_LINUX
-
@@ -7,15 +7,39 @@
 
 #include "fs_notify.h"
 #include <gsl.h>
+#include <utility>
 #include <vector>
 
 namespace plat {
 
+// Watches with inotify. A file is watched through its directory, so editors
+// that save by writing a new file and renaming it over the old one are seen.
 class fs_notify final : public impl::fs_notify<fs_notify> {
 public:
+  fs_notify() noexcept;
+  fs_notify(fs_notify const&) = delete;
+  fs_notify& operator=(fs_notify const&) = delete;
+  ~fs_notify() noexcept;
+
+  // The inotify descriptor. It is readable when tick has changes to report,
+  // so it can be waited on with poll or epoll.
+  int descriptor() const noexcept { return _fd; }
 
 private:
-  //std::vector<gsl::unique_ptr<watch>> _watches;
+  struct watch {
+    plat::filesystem::path path{};
+    notify_delegate delegate{};
+    bool recursive{false};
+    bool directory{false};
+    // inotify watch descriptors and the directories they watch
+    std::vector<std::pair<int, plat::filesystem::path>> directories{};
+  }; // struct watch
+
+  int _fd{-1};
+  std::vector<watch> _watches{}; // by watch_id; removed watches are empty
+
+  bool add_directory(watch& w, plat::filesystem::path directory,
+                     std::error_code& ec) noexcept;
 
   watch_id do_add(plat::filesystem::path path,
                   impl::fs_notify<fs_notify>::notify_delegate delegate,
@@ -31,4 +55,3 @@ private:
 } // namespace plat
 
 #endif // VKST_PLAT_FS_NOTIFY_LINUX_H
-
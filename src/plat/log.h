@@ -3,6 +3,7 @@
 
 #include <plat/core.h>
 #include <plat/filesystem.h>
+#include <plat/profile.h>
 #include <gsl.h>
 #include <string>
 
@@ -44,12 +45,11 @@ void log(log_severities severity, gsl::czstring fmt, ...) noexcept;
 #define LOG_ERROR(...) ::plat::log(::plat::log_severities::error, __VA_ARGS__)
 #define LOG_FATAL(...) ::plat::log(::plat::log_severities::fatal, __VA_ARGS__)
 
-#define LOG_ENTER                                                              \
-  ::plat::log(::plat::log_severities::trace, "enter: %s (%s:%d)", __func__,    \
-              __FILE__, __LINE__)
-#define LOG_LEAVE                                                              \
-  ::plat::log(::plat::log_severities::trace, "leave: %s (%s:%d)", __func__,    \
-              __FILE__, __LINE__)
+// LOG_ENTER opens a profiling zone named after the enclosing function that
+// closes when the function returns, see plat/profile.h. LOG_LEAVE is kept so
+// existing call sites still compile; the zone already ends on every return.
+#define LOG_ENTER PLAT_PROFILE_ZONE(__func__)
+#define LOG_LEAVE static_cast<void>(0)
 
 } // namespace plat
 
@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+#include "core.h"
+
+#if TURF_TARGET_WIN32
+
+plat::mapped_file plat::mapped_file::open(plat::filesystem::path const& path,
+                                          std::error_code& ec) noexcept {
+  mapped_file mf;
+
+  HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE |
+                              FILE_SHARE_DELETE,
+                            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    ec.assign(GetLastError(), std::system_category());
+    return mf;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    ec.assign(GetLastError(), std::system_category());
+    CloseHandle(file);
+    return mf;
+  }
+
+  ec.clear();
+  if (size.QuadPart == 0) {
+    // CreateFileMapping fails on an empty file
+    CloseHandle(file);
+    return mf;
+  }
+
+  // The view keeps the mapping and file open, so both handles can be closed
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    ec.assign(GetLastError(), std::system_category());
+    return mf;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == NULL) {
+    ec.assign(GetLastError(), std::system_category());
+    return mf;
+  }
+
+  mf._data = static_cast<char const*>(view);
+  mf._size = static_cast<std::size_t>(size.QuadPart);
+  return mf;
+} // plat::mapped_file::open
+
+void plat::mapped_file::reset() noexcept {
+  if (_data) UnmapViewOfFile(_data);
+  _data = nullptr;
+  _size = 0;
+} // plat::mapped_file::reset
+
+#else // TURF_TARGET_WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+plat::mapped_file plat::mapped_file::open(plat::filesystem::path const& path,
+                                          std::error_code& ec) noexcept {
+  mapped_file mf;
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ec.assign(errno, std::generic_category());
+    return mf;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ec.assign(errno, std::generic_category());
+    ::close(fd);
+    return mf;
+  }
+
+  ec.clear();
+  if (st.st_size == 0) {
+    // mmap fails on a zero length
+    ::close(fd);
+    return mf;
+  }
+
+  // The mapping holds its own reference to the file, so fd can be closed
+  auto const size = static_cast<std::size_t>(st.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int const map_errno = errno;
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    ec.assign(map_errno, std::generic_category());
+    return mf;
+  }
+
+  // Sources and caches are read in full right after mapping
+  ::madvise(addr, size, MADV_WILLNEED);
+
+  mf._data = static_cast<char const*>(addr);
+  mf._size = size;
+  return mf;
+} // plat::mapped_file::open
+
+void plat::mapped_file::reset() noexcept {
+  if (_data) ::munmap(const_cast<char*>(_data), _size);
+  _data = nullptr;
+  _size = 0;
+} // plat::mapped_file::reset
+
+#endif // TURF_TARGET_WIN32
+
+plat::mapped_file::mapped_file(mapped_file&& other) noexcept
+: _data{other._data}
+, _size{other._size} {
+  other._data = nullptr;
+  other._size = 0;
+} // plat::mapped_file::mapped_file
+
+plat::mapped_file& plat::mapped_file::operator=(mapped_file&& rhs) noexcept {
+  if (this == &rhs) return *this;
+  reset();
+  _data = rhs._data;
+  _size = rhs._size;
+  rhs._data = nullptr;
+  rhs._size = 0;
+  return *this;
+} // plat::mapped_file::operator=
@@ -0,0 +1,43 @@
+#ifndef VKST_PLAT_MAPPED_FILE_H
+#define VKST_PLAT_MAPPED_FILE_H
+
+#include <plat/filesystem.h>
+#include <gsl.h>
+#include <system_error>
+
+namespace plat {
+
+// A read-only memory mapping of a whole file. The bytes are read straight
+// from the page cache with no copy and stay valid until the mapped_file is
+// reset or destroyed, even if the file is replaced. Truncating the file while
+// it is mapped makes the removed pages unreadable, so files that may be
+// rewritten in place should only be mapped for as long as they are read.
+class mapped_file {
+public:
+  // Map path. An empty file maps to an empty span. If ec is true, then an
+  // error occurred and the mapping is empty.
+  static mapped_file open(plat::filesystem::path const& path,
+                          std::error_code& ec) noexcept;
+
+  gsl::span<char const> bytes() const noexcept { return {_data, _size}; }
+  char const* data() const noexcept { return _data; }
+  std::size_t size() const noexcept { return _size; }
+  bool empty() const noexcept { return _size == 0; }
+
+  void reset() noexcept;
+
+  mapped_file() noexcept = default;
+  mapped_file(mapped_file const&) = delete;
+  mapped_file(mapped_file&& other) noexcept;
+  mapped_file& operator=(mapped_file const&) = delete;
+  mapped_file& operator=(mapped_file&& rhs) noexcept;
+  ~mapped_file() noexcept { reset(); }
+
+private:
+  char const* _data{nullptr};
+  std::size_t _size{0};
+}; // class mapped_file
+
+} // namespace plat
+
+#endif // VKST_PLAT_MAPPED_FILE_H
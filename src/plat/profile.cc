@@ -0,0 +1,136 @@
+#include "profile.h"
+#include "file_handle.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> plat::profile::detail::enabled{false};
+
+struct event {
+  char const* name;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+}; // struct event
+
+// The events of one thread. The owning thread is the only writer; the lock
+// is only contended while write_chrome_trace copies the events out.
+struct thread_buffer {
+  uint32_t tid;
+  std::mutex mutex{};
+  std::vector<event> events{};
+}; // struct thread_buffer
+
+static constexpr uint32_t GPU_TID = 0;
+
+// Buffers are never freed so that zones recorded by threads that have since
+// exited still appear in the trace.
+static std::mutex s_buffers_mutex;
+static std::vector<std::unique_ptr<thread_buffer>> s_buffers;
+static uint32_t s_next_tid{GPU_TID + 1};
+
+static thread_buffer s_gpu_buffer{GPU_TID};
+
+static auto const s_epoch = std::chrono::steady_clock::now();
+
+static thread_buffer* register_thread() noexcept {
+  std::lock_guard<std::mutex> lock{s_buffers_mutex};
+  s_buffers.push_back(std::make_unique<thread_buffer>());
+  s_buffers.back()->tid = s_next_tid++;
+  s_buffers.back()->events.reserve(4096);
+  return s_buffers.back().get();
+} // register_thread
+
+static void append(thread_buffer& buffer, char const* name,
+                   uint64_t begin_ns, uint64_t end_ns) noexcept {
+  std::lock_guard<std::mutex> lock{buffer.mutex};
+  buffer.events.push_back({name, begin_ns, end_ns});
+} // append
+
+// Chrome trace timestamps are in microseconds; keep nanosecond precision.
+static void write_event(std::FILE* fh, bool& first, uint32_t tid,
+                        event const& e) noexcept {
+  auto const dur_ns = e.end_ns - e.begin_ns;
+  std::fprintf(fh,
+               "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+               "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu}",
+               first ? "" : ",", e.name, tid,
+               static_cast<unsigned long long>(e.begin_ns / 1000),
+               static_cast<unsigned long long>(e.begin_ns % 1000),
+               static_cast<unsigned long long>(dur_ns / 1000),
+               static_cast<unsigned long long>(dur_ns % 1000));
+  first = false;
+} // write_event
+
+static void write_thread_name(std::FILE* fh, bool& first,
+                              uint32_t tid) noexcept {
+  if (tid == GPU_TID) {
+    std::fprintf(fh,
+                 "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%u,\"args\":{\"name\":\"GPU\"}}",
+                 first ? "" : ",", tid);
+  } else {
+    std::fprintf(fh,
+                 "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                 first ? "" : ",", tid, tid);
+  }
+  first = false;
+} // write_thread_name
+
+static void write_buffer(std::FILE* fh, bool& first,
+                         thread_buffer& buffer) noexcept {
+  std::vector<event> events;
+  {
+    std::lock_guard<std::mutex> lock{buffer.mutex};
+    events.swap(buffer.events);
+  }
+  if (events.empty()) return;
+
+  write_thread_name(fh, first, buffer.tid);
+  for (auto&& e : events) write_event(fh, first, buffer.tid, e);
+} // write_buffer
+
+uint64_t plat::profile::now() noexcept {
+  using namespace std::chrono;
+  return static_cast<uint64_t>(
+    duration_cast<nanoseconds>(steady_clock::now() - s_epoch).count());
+} // plat::profile::now
+
+void plat::profile::start() noexcept {
+  detail::enabled.store(true, std::memory_order_relaxed);
+} // plat::profile::start
+
+void plat::profile::stop() noexcept {
+  detail::enabled.store(false, std::memory_order_relaxed);
+} // plat::profile::stop
+
+void plat::profile::record(char const* name, uint64_t begin_ns,
+                           uint64_t end_ns) noexcept {
+  thread_local thread_buffer* buffer = register_thread();
+  append(*buffer, name, begin_ns, end_ns);
+} // plat::profile::record
+
+void plat::profile::record_gpu(char const* name, uint64_t begin_ns,
+                               uint64_t end_ns) noexcept {
+  if (!enabled()) return;
+  append(s_gpu_buffer, name, begin_ns, end_ns);
+} // plat::profile::record_gpu
+
+void plat::profile::write_chrome_trace(plat::filesystem::path const& path,
+                                       std::error_code& ec) noexcept {
+  auto fh = file_handle::open(path, file_handle::open_modes::write, ec);
+  if (ec) return;
+
+  bool first = true;
+  std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", fh);
+
+  write_buffer(fh, first, s_gpu_buffer);
+  {
+    std::lock_guard<std::mutex> lock{s_buffers_mutex};
+    for (auto&& buffer : s_buffers) write_buffer(fh, first, *buffer);
+  }
+
+  std::fputs("\n]}\n", fh);
+  if (std::ferror(fh)) ec.assign(EIO, std::generic_category());
+} // plat::profile::write_chrome_trace
@@ -0,0 +1,79 @@
+#ifndef VKST_PLAT_PROFILE_H
+#define VKST_PLAT_PROFILE_H
+
+#include <plat/filesystem.h>
+#include <turf/c/core.h>
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+
+namespace plat {
+
+// A scoped-zone profiler. Each zone records its begin time and duration in
+// nanoseconds into a buffer owned by the recording thread, so recording only
+// takes that thread's uncontended lock. The buffers of all threads are written
+// out as Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev
+// both load.
+//
+// Zones are only recorded between start() and stop(); otherwise a zone costs
+// one relaxed atomic load.
+namespace profile {
+
+// Nanoseconds since the profiler epoch, which is program start-up.
+uint64_t now() noexcept;
+
+void start() noexcept;
+void stop() noexcept;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+} // namespace detail
+
+inline bool enabled() noexcept {
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Record a completed zone on the calling thread. name must have static
+// storage duration, e.g. a string literal or __func__.
+void record(char const* name, uint64_t begin_ns, uint64_t end_ns) noexcept;
+
+// Record a completed zone on the GPU track. begin_ns and end_ns must already
+// be converted to the profiler timeline, see now().
+void record_gpu(char const* name, uint64_t begin_ns, uint64_t end_ns) noexcept;
+
+// Write all recorded zones of all threads to path as Chrome trace JSON and
+// then clear them.
+void write_chrome_trace(plat::filesystem::path const& path,
+                        std::error_code& ec) noexcept;
+
+class zone {
+public:
+  explicit zone(char const* name) noexcept
+    : _name{enabled() ? name : nullptr}
+    , _begin{_name ? now() : 0} {}
+
+  ~zone() noexcept {
+    if (_name) record(_name, _begin, now());
+  }
+
+  zone(zone const&) = delete;
+  zone& operator=(zone const&) = delete;
+
+private:
+  char const* _name;
+  uint64_t _begin;
+}; // class zone
+
+} // namespace profile
+} // namespace plat
+
+#define PLAT_PROFILE_CONCAT2(a, b) a##b
+#define PLAT_PROFILE_CONCAT(a, b) PLAT_PROFILE_CONCAT2(a, b)
+
+// Open a zone named name that closes at the end of the enclosing scope.
+#define PLAT_PROFILE_ZONE(name)                                                \
+  ::plat::profile::zone PLAT_PROFILE_CONCAT(plat_profile_zone_, __LINE__) {   \
+    name                                                                       \
+  }
+
+#endif // VKST_PLAT_PROFILE_H
@@ -0,0 +1,77 @@
+#ifndef VKST_PLAT_SPSC_QUEUE_H
+#define VKST_PLAT_SPSC_QUEUE_H
+
+#include <turf/c/core.h>
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+namespace plat {
+
+// A bounded lock-free queue for one producer thread and one consumer thread.
+// push and pop never block or allocate, so the queue can sit between an
+// event handler and the render loop. Each side caches the other side's
+// index and only reloads it when the queue looks full or empty, and the two
+// sides are kept on separate cache lines, so in the common case neither
+// touches a line the other writes.
+template <class T, std::size_t N>
+class spsc_queue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "elements must be trivially copyable");
+
+public:
+  static constexpr std::size_t capacity() noexcept { return N; }
+
+  // Producer: append value. Returns false, dropping value, if the queue is
+  // full.
+  bool push(T const& value) noexcept {
+    auto const tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head_cache == N) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      if (tail - _head_cache == N) return false;
+    }
+
+    _items[tail & (N - 1)] = value;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: remove the oldest value into value. Returns false if the queue
+  // is empty.
+  bool pop(T& value) noexcept {
+    auto const head = _head.load(std::memory_order_relaxed);
+    if (head == _tail_cache) {
+      _tail_cache = _tail.load(std::memory_order_acquire);
+      if (head == _tail_cache) return false;
+    }
+
+    value = _items[head & (N - 1)];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side: the number of values queued. Only a snapshot when the
+  // other side is running.
+  std::size_t size() const noexcept {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+private:
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> _head{0}; // written by pop
+  std::size_t _tail_cache{0};                             // consumer only
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> _tail{0}; // written by push
+  std::size_t _head_cache{0};                             // producer only
+
+  alignas(CACHE_LINE) std::array<T, N> _items{};
+}; // class spsc_queue
+
+} // namespace plat
+
+#endif // VKST_PLAT_SPSC_QUEUE_H
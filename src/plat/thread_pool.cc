@@ -0,0 +1,55 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+plat::thread_pool::thread_pool(std::size_t num_threads) noexcept {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  _workers.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    _workers.emplace_back([this, i]() { run(i); });
+  }
+} // plat::thread_pool::thread_pool
+
+void plat::thread_pool::submit(job j) noexcept {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _jobs.push_back(std::move(j));
+  }
+  _job_ready.notify_one();
+} // plat::thread_pool::submit
+
+void plat::thread_pool::wait() noexcept {
+  std::unique_lock<std::mutex> lock{_mutex};
+  _idle.wait(lock, [this]() { return _jobs.empty() && _running == 0; });
+} // plat::thread_pool::wait
+
+void plat::thread_pool::run(std::size_t worker) noexcept {
+  std::unique_lock<std::mutex> lock{_mutex};
+
+  while (true) {
+    _job_ready.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+    if (_jobs.empty()) return; // _stop and drained
+
+    job j = std::move(_jobs.front());
+    _jobs.pop_front();
+    _running += 1;
+
+    lock.unlock();
+    j(worker);
+    lock.lock();
+
+    _running -= 1;
+    if (_jobs.empty() && _running == 0) _idle.notify_all();
+  }
+} // plat::thread_pool::run
+
+plat::thread_pool::~thread_pool() noexcept {
+  {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _stop = true;
+  }
+  _job_ready.notify_all();
+  for (auto&& worker : _workers) worker.join();
+} // plat::thread_pool::~thread_pool
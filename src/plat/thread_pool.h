@@ -0,0 +1,49 @@
+#ifndef VKST_PLAT_THREAD_POOL_H
+#define VKST_PLAT_THREAD_POOL_H
+
+#include <turf/c/core.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace plat {
+
+// A fixed set of worker threads that run jobs from a shared FIFO queue. Each
+// job is passed the index of the worker running it, in [0, size()), so
+// callers can keep per-worker state such as a compiler without locking.
+class thread_pool {
+public:
+  using job = std::function<void(std::size_t worker)>;
+
+  // Start num_threads workers, or one per hardware thread if 0.
+  explicit thread_pool(std::size_t num_threads = 0) noexcept;
+
+  std::size_t size() const noexcept { return _workers.size(); }
+
+  void submit(job j) noexcept;
+
+  // Block until the queue is empty and no worker is running a job.
+  void wait() noexcept;
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+  ~thread_pool() noexcept;
+
+private:
+  void run(std::size_t worker) noexcept;
+
+  std::vector<std::thread> _workers{};
+  std::deque<job> _jobs{};
+  std::mutex _mutex{};
+  std::condition_variable _job_ready{};
+  std::condition_variable _idle{};
+  std::size_t _running{0};
+  bool _stop{false};
+}; // class thread_pool
+
+} // namespace plat
+
+#endif // VKST_PLAT_THREAD_POOL_H
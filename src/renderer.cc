@@ -2,7 +2,11 @@
 #include <plat/core.h>
 #include <plat/file_io.h>
 #include <plat/log.h>
-#include <shaderc/shaderc.hpp>
+#include <plat/mapped_file.h>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
 
 surface::surface(surface&& other) noexcept
 : _surface{other._surface}
@@ -19,6 +23,7 @@ surface::surface(surface&& other) noexcept
 , _capabilities{other._capabilities}
 , _swapchain{other._swapchain}
 , _color_images{std::move(other._color_images)}
+, _color_image_memory{std::move(other._color_image_memory)}
 , _color_image_views{std::move(other._color_image_views)}
 , _depth_image{other._depth_image}
 , _depth_image_memory{other._depth_image_memory}
@@ -61,6 +66,7 @@ surface& surface::operator=(surface&& rhs) noexcept {
   _capabilities = rhs._capabilities;
   _swapchain = rhs._swapchain;
   _color_images = std::move(rhs._color_images);
+  _color_image_memory = std::move(rhs._color_image_memory);
   _color_image_views = std::move(rhs._color_image_views);
   _depth_image = rhs._depth_image;
   _depth_image_memory = rhs._depth_image_memory;
@@ -87,17 +93,196 @@ surface& surface::operator=(surface&& rhs) noexcept {
   return *this;
 } // surface::operator=
 
-shader::shader(shader&& other) noexcept : _module{other._module} {
+shader::shader(shader&& other) noexcept
+: _module{other._module}
+, _push_constants_read{other._push_constants_read} {
   other._module = VK_NULL_HANDLE;
 }
 
 shader& shader::operator=(shader&& rhs) noexcept {
   if (this == &rhs) return *this;
   _module = rhs._module;
+  _push_constants_read = rhs._push_constants_read;
   rhs._module = VK_NULL_HANDLE;
   return *this;
 }
 
+void specialization_constants::set(uint32_t constant_id,
+                                   int32_t value) noexcept {
+  set_bits(constant_id, static_cast<uint32_t>(value));
+} // specialization_constants::set
+
+void specialization_constants::set(uint32_t constant_id,
+                                   uint32_t value) noexcept {
+  set_bits(constant_id, value);
+} // specialization_constants::set
+
+void specialization_constants::set(uint32_t constant_id,
+                                   float value) noexcept {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  set_bits(constant_id, bits);
+} // specialization_constants::set
+
+void specialization_constants::set(uint32_t constant_id, bool value) noexcept {
+  set_bits(constant_id, value ? VK_TRUE : VK_FALSE);
+} // specialization_constants::set
+
+int32_t specialization_constants::get(uint32_t constant_id,
+                                      int32_t fallback) const noexcept {
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    if (_entries[i].constantID == constant_id) {
+      return static_cast<int32_t>(_data[i]);
+    }
+  }
+  return fallback;
+} // specialization_constants::get
+
+VkSpecializationInfo specialization_constants::info() const noexcept {
+  VkSpecializationInfo info = {};
+  info.mapEntryCount = gsl::narrow_cast<uint32_t>(_entries.size());
+  info.pMapEntries = _entries.data();
+  info.dataSize = _data.size() * sizeof(uint32_t);
+  info.pData = _data.data();
+  return info;
+} // specialization_constants::info
+
+// 64-bit FNV-1a over the constant ids and values
+std::size_t specialization_constants::hash() const noexcept {
+  uint64_t hash = UINT64_C(14695981039346656037);
+  auto const mix = [&hash](uint32_t word) {
+    hash ^= word;
+    hash *= UINT64_C(1099511628211);
+  };
+
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    mix(_entries[i].constantID);
+    mix(_data[i]);
+  }
+
+  return static_cast<std::size_t>(hash);
+} // specialization_constants::hash
+
+bool specialization_constants::
+operator==(specialization_constants const& other) const noexcept {
+  if (_data != other._data) return false;
+  return std::equal(_entries.begin(), _entries.end(), other._entries.begin(),
+                    other._entries.end(), [](auto&& a, auto&& b) {
+                      return a.constantID == b.constantID;
+                    });
+} // specialization_constants::operator==
+
+void specialization_constants::set_bits(uint32_t constant_id,
+                                        uint32_t bits) noexcept {
+  auto iter = std::lower_bound(
+    _entries.begin(), _entries.end(), constant_id,
+    [](auto&& entry, uint32_t id) { return entry.constantID < id; });
+  auto const index = static_cast<std::size_t>(iter - _entries.begin());
+
+  if (iter != _entries.end() && iter->constantID == constant_id) {
+    _data[index] = bits;
+    return;
+  }
+
+  _entries.insert(iter, {constant_id, 0, sizeof(uint32_t)});
+  _data.insert(_data.begin() + index, bits);
+
+  // Each value is stored at the same index in _data as its entry
+  for (std::size_t i = index; i < _entries.size(); ++i) {
+    _entries[i].offset = gsl::narrow_cast<uint32_t>(i * sizeof(uint32_t));
+  }
+} // specialization_constants::set_bits
+
+void submit_batch::add(gsl::span<VkCommandBuffer const> buffers,
+                       gsl::span<VkSemaphore const> waits,
+                       gsl::span<VkPipelineStageFlags const> wait_stages,
+                       gsl::span<VkSemaphore const> signals,
+                       VkFence fence) noexcept {
+  Expects(waits.size() == wait_stages.size());
+
+  _entries.push_back({gsl::narrow_cast<uint32_t>(_waits.size()),
+                      gsl::narrow_cast<uint32_t>(waits.size()),
+                      gsl::narrow_cast<uint32_t>(_buffers.size()),
+                      gsl::narrow_cast<uint32_t>(buffers.size()),
+                      gsl::narrow_cast<uint32_t>(_signals.size()),
+                      gsl::narrow_cast<uint32_t>(signals.size()), fence,
+                      0});
+
+  _waits.insert(_waits.end(), waits.begin(), waits.end());
+  _wait_stages.insert(_wait_stages.end(), wait_stages.begin(),
+                      wait_stages.end());
+  _buffers.insert(_buffers.end(), buffers.begin(), buffers.end());
+  _signals.insert(_signals.end(), signals.begin(), signals.end());
+} // submit_batch::add
+
+void submit_batch::add_signal(VkSemaphore timeline, uint64_t value) noexcept {
+  Expects(value != 0);
+
+  _entries.push_back({gsl::narrow_cast<uint32_t>(_waits.size()), 0,
+                      gsl::narrow_cast<uint32_t>(_buffers.size()), 0,
+                      gsl::narrow_cast<uint32_t>(_signals.size()), 1,
+                      VK_NULL_HANDLE, value});
+  _signals.push_back(timeline);
+} // submit_batch::add_signal
+
+uint32_t submit_batch::flush(VkQueue queue, std::error_code& ec) noexcept {
+  ec.clear();
+
+  _infos.resize(_entries.size());
+  _timeline_infos.resize(_entries.size());
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    auto const& e = _entries[i];
+    VkSubmitInfo& sinfo = _infos[i];
+    sinfo = {};
+    sinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    sinfo.waitSemaphoreCount = e.wait_count;
+    sinfo.pWaitSemaphores = _waits.data() + e.first_wait;
+    sinfo.pWaitDstStageMask = _wait_stages.data() + e.first_wait;
+    sinfo.commandBufferCount = e.buffer_count;
+    sinfo.pCommandBuffers = _buffers.data() + e.first_buffer;
+    sinfo.signalSemaphoreCount = e.signal_count;
+    sinfo.pSignalSemaphores = _signals.data() + e.first_signal;
+
+    if (e.timeline_value != 0) {
+      VkTimelineSemaphoreSubmitInfoKHR& tinfo = _timeline_infos[i];
+      tinfo = {};
+      tinfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+      tinfo.signalSemaphoreValueCount = 1;
+      tinfo.pSignalSemaphoreValues = &e.timeline_value;
+      sinfo.pNext = &tinfo;
+    }
+  }
+
+  uint32_t calls = 0;
+  std::size_t first = 0;
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    if (_entries[i].fence == VK_NULL_HANDLE && i + 1 < _entries.size()) {
+      continue;
+    }
+
+    VkResult rslt =
+      vkQueueSubmit(queue, gsl::narrow_cast<uint32_t>(i + 1 - first),
+                    _infos.data() + first, _entries[i].fence);
+    calls += 1;
+    if (rslt != VK_SUCCESS) {
+      ec.assign(rslt, vk::result_category());
+      break;
+    }
+    first = i + 1;
+  }
+
+  clear();
+  return calls;
+} // submit_batch::flush
+
+void submit_batch::clear() noexcept {
+  _entries.clear();
+  _waits.clear();
+  _wait_stages.clear();
+  _buffers.clear();
+  _signals.clear();
+} // submit_batch::clear
+
 namespace std {
 
 template <>
@@ -112,6 +297,7 @@ std::string renderer_result_category_impl::message(int ev) const {
   case renderer_result::initialization_failed: return "Initialization failed";
   case renderer_result::surface_not_supported: return "Surface not supported";
   case renderer_result::no_memory_type: return "No memory type";
+  case renderer_result::samples_not_supported: return "Samples not supported";
   }
   PLAT_MARK_UNREACHABLE;
 } // renderer_result_category_impl::message
@@ -124,11 +310,12 @@ std::error_category const& renderer_result_category() {
 // Create a Vulkan Instance.
 // https://www.khronos.org/registry/vulkan/specs/1.0-extensions/html/vkspec.html#initialization-instances
 static VkInstance
-create_instance(gsl::czstring application_name,
+create_instance(gsl::czstring application_name, renderer_options opts,
                 PFN_vkDebugReportCallbackEXT debug_report_callback,
-                std::error_code& ec) noexcept {
+                bool& properties2, std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
+  properties2 = false;
 
   // Layers can be null, but for this example, we want to use the validation
   // layers. VK_LAYER_LUNARG_standard_validation is a "meta-layer" that
@@ -142,18 +329,77 @@ create_instance(gsl::czstring application_name,
   //  {"VK_LAYER_LUNARG_core_validation", "VK_LAYER_LUNARG_object_tracker",
   //   "VK_LAYER_LUNARG_parameter_validation", "VK_LAYER_GOOGLE_threading"}};
 
+  // The validation layers are not always installed, for example alongside
+  // lavapipe on CI hosts, so only request them when they are present.
+  uint32_t num_layers_present;
+  VkResult rslt =
+    vkEnumerateInstanceLayerProperties(&num_layers_present, nullptr);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  std::vector<VkLayerProperties> layers_present(num_layers_present);
+  rslt = vkEnumerateInstanceLayerProperties(&num_layers_present,
+                                            layers_present.data());
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  bool validation = false;
+  for (auto&& present : layers_present) {
+    if (strcmp(present.layerName, layers[0]) == 0) {
+      validation = true;
+      break;
+    }
+  }
+  if (!validation) LOG_WARN("%s not present; not validating", layers[0]);
 
   // Some extensions are required for graphics: VK_KHR_SURFACE and the
-  // appropriate platform-specific SURFACE_EXTENSION.
-  std::array<gsl::czstring, 3> extensions{{
-    VK_EXT_DEBUG_REPORT_EXTENSION_NAME,
-    VK_KHR_SURFACE_EXTENSION_NAME,
+  // appropriate platform-specific SURFACE_EXTENSION. A headless renderer
+  // only needs the debug report extension.
+  std::vector<gsl::czstring> extensions{VK_EXT_DEBUG_REPORT_EXTENSION_NAME};
+  if ((opts & renderer_options::headless) != renderer_options::headless) {
+    extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #if TURF_TARGET_WIN32
-    VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+    extensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#elif WSI_XCB
+    extensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #else
-    VK_KHR_XLIB_SURFACE_EXTENSION_NAME,
+    extensions.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
 #endif
-  }};
+  }
+
+  // VK_KHR_timeline_semaphore depends on
+  // VK_KHR_get_physical_device_properties2, which is also how its feature is
+  // queried, so enable that when it is present and tell create_device
+  // whether it was.
+  uint32_t num_extensions_present;
+  rslt = vkEnumerateInstanceExtensionProperties(
+    nullptr, &num_extensions_present, nullptr);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  std::vector<VkExtensionProperties> extensions_present(num_extensions_present);
+  rslt = vkEnumerateInstanceExtensionProperties(
+    nullptr, &num_extensions_present, extensions_present.data());
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  for (auto&& present : extensions_present) {
+    if (strcmp(present.extensionName,
+               VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+      extensions.push_back(
+        VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+      properties2 = true;
+      break;
+    }
+  }
 
   VkApplicationInfo ainfo = {}; // zero all fields
   ainfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -163,7 +409,8 @@ create_instance(gsl::czstring application_name,
   VkInstanceCreateInfo cinfo = {}; // zero all fields
   cinfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   cinfo.pApplicationInfo = &ainfo;
-  cinfo.enabledLayerCount = gsl::narrow_cast<uint32_t>(layers.size());
+  cinfo.enabledLayerCount =
+    validation ? gsl::narrow_cast<uint32_t>(layers.size()) : 0;
   cinfo.ppEnabledLayerNames = layers.data();
   cinfo.enabledExtensionCount = gsl::narrow_cast<uint32_t>(extensions.size());
   cinfo.ppEnabledExtensionNames = extensions.data();
@@ -178,7 +425,7 @@ create_instance(gsl::czstring application_name,
   cinfo.pNext = &drccinfo;
 
   VkInstance instance;
-  VkResult rslt = vkCreateInstance(&cinfo, nullptr, &instance);
+  rslt = vkCreateInstance(&cinfo, nullptr, &instance);
   if (rslt != VK_SUCCESS) {
     ec.assign(rslt, vk::result_category());
     return VK_NULL_HANDLE;
@@ -329,8 +576,18 @@ find_physical(VkInstance instance, renderer_options opts,
 
       // If this device does not support presentation of surfaces, skip it.
       // This is a general check, each created surface must also be checked.
+      // Headless renderers never present.
+      if ((opts & renderer_options::headless) == renderer_options::headless) {
+        LOG_INFO("using device %s", properties.deviceName);
+        LOG_LEAVE;
+        return {device, j};
+      }
+
 #if TURF_TARGET_WIN32
       if (!vkGetPhysicalDeviceWin32PresentationSupportKHR(device, j)) continue;
+#elif TURF_KERNEL_LINUX && WSI_XCB
+      // The XCB query needs a connection and visual, which do not exist
+      // until a window is created; check_surface_support checks each surface
 #elif TURF_KERNEL_LINUX
       if (!vkGetPhysicalDeviceXlibPresentationSupportKHR(device, j)) continue;
 #endif
@@ -347,10 +604,12 @@ find_physical(VkInstance instance, renderer_options opts,
 } // find_physical
 
 // Create a Vulkan Device.
-// Return both the device and queue.
+// Return the device and queue, and whether timeline semaphores are enabled,
+// which they are if timeline is true and the device supports them.
 // https://www.khronos.org/registry/vulkan/specs/1.0-extensions/html/vkspec.html#devsandqueues-devices
-static std::pair<VkDevice, VkQueue>
-create_device(VkPhysicalDevice physical, uint32_t queue_family_index,
+static std::tuple<VkDevice, VkQueue, bool>
+create_device(VkInstance instance, VkPhysicalDevice physical,
+              uint32_t queue_family_index, bool timeline,
               std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
@@ -365,8 +624,8 @@ create_device(VkPhysicalDevice physical, uint32_t queue_family_index,
   qcinfo.pQueuePriorities = &priority;
 
   // We must request the VK_KHR_SWAPCHAIN extension.
-  std::array<gsl::czstring, 1> extensions_requested{
-    {VK_KHR_SWAPCHAIN_EXTENSION_NAME}};
+  std::vector<gsl::czstring> extensions_requested{
+    VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
   // Query the extensions of this device.
   uint32_t num_extensions_present;
@@ -403,6 +662,44 @@ create_device(VkPhysicalDevice physical, uint32_t queue_family_index,
     }
   }
 
+  // Timeline semaphores are optional: without them the renderer tracks its
+  // timeline with fences. The extension must be present and its feature
+  // supported, which is queried through the instance's
+  // VK_KHR_get_physical_device_properties2 functions; timeline is only true
+  // if create_instance enabled those.
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {};
+  timeline_features.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+  if (timeline) {
+    timeline = false;
+    for (auto&& present : extensions_present) {
+      if (strcmp(present.extensionName,
+                 VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+        timeline = true;
+        break;
+      }
+    }
+  }
+
+  if (timeline) {
+    auto getPhysicalDeviceFeatures2KHR =
+      reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+
+    VkPhysicalDeviceFeatures2KHR features2 = {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features2.pNext = &timeline_features;
+    if (getPhysicalDeviceFeatures2KHR) {
+      getPhysicalDeviceFeatures2KHR(physical, &features2);
+    }
+
+    timeline = (timeline_features.timelineSemaphore == VK_TRUE);
+    if (timeline) {
+      extensions_requested.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+  }
+
   VkPhysicalDeviceFeatures features = {}; // set all to VK_FALSE (0)
   features.fullDrawIndexUint32 = VK_TRUE;
   features.fillModeNonSolid = VK_TRUE;
@@ -417,6 +714,15 @@ create_device(VkPhysicalDevice physical, uint32_t queue_family_index,
   cinfo.ppEnabledExtensionNames = extensions_requested.data();
   cinfo.pEnabledFeatures = &features;
 
+  // Enable only the timeline semaphore feature of the extension
+  if (timeline) {
+    timeline_features = {};
+    timeline_features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timeline_features.timelineSemaphore = VK_TRUE;
+    cinfo.pNext = &timeline_features;
+  }
+
   VkDevice device;
   rslt = vkCreateDevice(physical, &cinfo, nullptr, &device);
   if (rslt != VK_SUCCESS) {
@@ -429,7 +735,7 @@ create_device(VkPhysicalDevice physical, uint32_t queue_family_index,
   vkGetDeviceQueue(device, queue_family_index, 0, &queue);
 
   LOG_LEAVE;
-  return std::make_pair(device, queue);
+  return std::make_tuple(device, queue, timeline);
 } // create_device
 
 // Create a Vulkan Command Pool for a specific device and queue.
@@ -474,7 +780,34 @@ static VkFence create_fence(VkDevice device, std::error_code& ec) noexcept {
 
   LOG_LEAVE;
   return fence;
-} // create_device
+} // create_fence
+
+// Create a Vulkan Timeline Semaphore with an initial value of 0
+// https://www.khronos.org/registry/vulkan/specs/1.1-extensions/html/vkspec.html#synchronization-semaphores
+static VkSemaphore create_timeline_semaphore(VkDevice device,
+                                             std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  VkSemaphoreTypeCreateInfoKHR stcinfo = {};
+  stcinfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  stcinfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  stcinfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo scinfo = {};
+  scinfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  scinfo.pNext = &stcinfo;
+
+  VkSemaphore semaphore;
+  VkResult rslt = vkCreateSemaphore(device, &scinfo, nullptr, &semaphore);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  LOG_LEAVE;
+  return semaphore;
+} // create_timeline_semaphore
 
 renderer renderer::create(gsl::czstring application_name, renderer_options opts,
                           PFN_vkDebugReportCallbackEXT debug_report_callback,
@@ -490,7 +823,9 @@ renderer renderer::create(gsl::czstring application_name, renderer_options opts,
 
   renderer r;
 
-  r._instance = ::create_instance(application_name, debug_report_callback, ec);
+  bool properties2;
+  r._instance = ::create_instance(application_name, opts,
+                                  debug_report_callback, properties2, ec);
   if (ec) return r;
 
   r._callback =
@@ -501,16 +836,49 @@ renderer renderer::create(gsl::czstring application_name, renderer_options opts,
     ::find_physical(r._instance, opts, push_constant_size, ec);
   if (ec) return r;
 
-  std::tie(r._device, r._graphics_queue) =
-    ::create_device(r._physical, r._graphics_queue_family_index, ec);
+  vkGetPhysicalDeviceProperties(r._physical, &r._properties);
+
+  bool timeline =
+    properties2 && (opts & renderer_options::no_timeline_semaphore) !=
+                     renderer_options::no_timeline_semaphore;
+  std::tie(r._device, r._graphics_queue, timeline) =
+    ::create_device(r._instance, r._physical, r._graphics_queue_family_index,
+                    timeline, ec);
   if (ec) return r;
 
   r._graphics_command_pool =
     ::create_command_pool(r._device, r._graphics_queue_family_index, ec);
   if (ec) return r;
 
-  r._graphics_onetime_fence = ::create_fence(r._device, ec);
-  if (ec) return r;
+  if (timeline) {
+    r._get_semaphore_counter_value =
+      reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+        vkGetDeviceProcAddr(r._device, "vkGetSemaphoreCounterValueKHR"));
+    r._wait_semaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+      vkGetDeviceProcAddr(r._device, "vkWaitSemaphoresKHR"));
+    if (!r._get_semaphore_counter_value || !r._wait_semaphores) {
+      ec.assign(static_cast<int>(vk::result::error_extension_not_present),
+                vk::result_category());
+      return r;
+    }
+
+    r._timeline = ::create_timeline_semaphore(r._device, ec);
+    if (ec) return r;
+  }
+  LOG_INFO("timeline: %s", timeline ? "timeline semaphore" : "fences");
+
+  r._compiler = gsl::make_unique<shader_compiler>();
+
+  // Start with an empty pipeline cache; load_pipeline_cache can replace it
+  VkPipelineCacheCreateInfo pcinfo = {};
+  pcinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+  VkResult rslt =
+    vkCreatePipelineCache(r._device, &pcinfo, nullptr, &r._pipeline_cache);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return r;
+  }
 
   LOG_LEAVE;
   return r;
@@ -536,6 +904,17 @@ static VkSurfaceKHR create_surface(VkInstance instance,
     return VK_NULL_HANDLE;
   }
 
+#elif TURF_KERNEL_LINUX && WSI_XCB
+  VkXcbSurfaceCreateInfoKHR cinfo = {};
+  cinfo.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+  std::tie(cinfo.connection, std::ignore, cinfo.window) = native;
+
+  VkResult rslt = vkCreateXcbSurfaceKHR(instance, &cinfo, nullptr, &surface);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
 #elif TURF_KERNEL_LINUX
   VkXlibSurfaceCreateInfoKHR cinfo = {};
   cinfo.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
@@ -664,22 +1043,28 @@ static VkSemaphore create_semaphore(VkDevice device,
   return semaphore;
 } // create_semaphore
 
+// Create a render pass drawing into a multisampled color and depth target
+// and resolving into the final color image, which ends in final_layout.
+// A single-sampled render pass draws straight into the final color image.
 static VkRenderPass create_render_pass(VkFormat color_format,
-                                       VkFormat depth_format, VkDevice device,
+                                       VkFormat depth_format,
+                                       VkSampleCountFlagBits samples,
+                                       VkImageLayout final_layout,
+                                       VkDevice device,
                                        std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
 
   std::array<VkAttachmentDescription, 4> attachments{
-    {{0, color_format, VK_SAMPLE_COUNT_8_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR,
+    {{0, color_format, samples, VK_ATTACHMENT_LOAD_OP_CLEAR,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED,
       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
      {0, color_format, VK_SAMPLE_COUNT_1_BIT, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       VK_ATTACHMENT_STORE_OP_STORE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED,
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR},
-     {0, depth_format, VK_SAMPLE_COUNT_8_BIT, VK_ATTACHMENT_LOAD_OP_CLEAR,
+      final_layout},
+     {0, depth_format, samples, VK_ATTACHMENT_LOAD_OP_CLEAR,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED,
       VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
@@ -688,16 +1073,24 @@ static VkRenderPass create_render_pass(VkFormat color_format,
       VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED,
       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}}};
 
-  VkAttachmentReference color{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  bool const multisampled = (samples != VK_SAMPLE_COUNT_1_BIT);
+
+  VkAttachmentReference color{multisampled ? 0u : 1u,
+                              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
   VkAttachmentReference resolve{1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
   VkAttachmentReference depth_stencil{
     2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
 
-  VkSubpassDescription subpasses = {0,        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    0,        nullptr,
-                                    1,        &color,
-                                    &resolve, &depth_stencil,
-                                    0,        nullptr};
+  VkSubpassDescription subpasses = {0,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    0,
+                                    nullptr,
+                                    1,
+                                    &color,
+                                    multisampled ? &resolve : nullptr,
+                                    &depth_stencil,
+                                    0,
+                                    nullptr};
 
   std::array<VkSubpassDependency, 2> dependencies{
     {{VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
@@ -763,7 +1156,7 @@ surface renderer::create_surface(wsi::window const& window,
 
   // Hard-coded for convenience
   s._depth_format = VK_FORMAT_D32_SFLOAT;
-  s._samples = VK_SAMPLE_COUNT_8_BIT;
+  s._samples = WINDOW_SURFACE_SAMPLES;
 
   // The desired present mode passed in to choose_present_mode
   s._present_mode = VK_PRESENT_MODE_FIFO_KHR;
@@ -778,7 +1171,8 @@ surface renderer::create_surface(wsi::window const& window,
   if (ec) return s;
 
   s._render_pass =
-    ::create_render_pass(s._color_format.format, s._depth_format, _device, ec);
+    ::create_render_pass(s._color_format.format, s._depth_format, s._samples,
+                         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, _device, ec);
   if (ec) return s;
 
   resize(s, window.size(), ec);
@@ -788,6 +1182,39 @@ surface renderer::create_surface(wsi::window const& window,
   return s;
 } // renderer::create_surface
 
+surface renderer::create_surface(wsi::extent2d const& extent,
+                                 VkSampleCountFlagBits samples,
+                                 std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  surface s;
+
+  if ((_properties.limits.framebufferColorSampleCounts & samples) == 0 ||
+      (_properties.limits.framebufferDepthSampleCounts & samples) == 0) {
+    ec.assign(static_cast<int>(renderer_result::samples_not_supported),
+              renderer_result_category());
+    return s;
+  }
+
+  // Match the formats chosen for window surfaces
+  s._color_format = {VK_FORMAT_B8G8R8A8_UNORM,
+                     VK_COLORSPACE_SRGB_NONLINEAR_KHR};
+  s._depth_format = VK_FORMAT_D32_SFLOAT;
+  s._samples = samples;
+
+  s._render_pass =
+    ::create_render_pass(s._color_format.format, s._depth_format, s._samples,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _device, ec);
+  if (ec) return s;
+
+  resize(s, extent, ec);
+  if (ec) return s;
+
+  LOG_LEAVE;
+  return s;
+} // renderer::create_surface
+
 static VkSurfaceCapabilitiesKHR
 get_surface_capabilities(VkPhysicalDevice physical, VkSurfaceKHR surface,
                          std::error_code& ec) noexcept {
@@ -1042,8 +1469,9 @@ static void transition_depth_image(renderer* r, VkImage image,
   LOG_ENTER;
   ec.clear();
 
-  VkCommandBuffer command_buffer = r->allocate_command_buffers(1, ec)[0];
+  auto command_buffers = r->allocate_command_buffers(1, ec);
   if (ec) return;
+  VkCommandBuffer command_buffer = command_buffers[0];
 
   VkCommandBufferBeginInfo binfo = {};
   binfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1068,9 +1496,15 @@ static void transition_depth_image(renderer* r, VkImage image,
 
   vkEndCommandBuffer(command_buffer);
 
-  r->submit(command_buffer, true, ec);
+  // Later submits to the queue are ordered after the barrier, so there is no
+  // need to wait for it before using the image
+  r->submit(command_buffers, false, ec);
+  r->free(command_buffers);
 } // transition_depth_image
 
+// The number of color images created for an offscreen surface
+static constexpr uint32_t OFFSCREEN_IMAGES = 2;
+
 static std::vector<VkFramebuffer>
 create_framebuffers(VkDevice device, gsl::span<VkImageView> attachments,
                     gsl::span<VkImageView> image_views,
@@ -1113,21 +1547,27 @@ void renderer::resize(surface& s, wsi::extent2d const& extent,
   LOG_ENTER;
   ec.clear();
 
-  VkSurfaceCapabilitiesKHR new_capabilities =
-    ::get_surface_capabilities(_physical, s._surface, ec);
-  if (ec) return;
+  // Offscreen surfaces have no capabilities and take the extent as given
+  VkSurfaceCapabilitiesKHR new_capabilities{};
+  VkExtent2D new_extent = {static_cast<uint32_t>(extent.width),
+                           static_cast<uint32_t>(extent.height)};
 
-  VkExtent2D new_extent = {
-    new_capabilities.currentExtent.width == UINT32_MAX
-      ? std::max(std::min(static_cast<uint32_t>(extent.width),
-                          new_capabilities.maxImageExtent.width),
-                 new_capabilities.minImageExtent.width)
-      : new_capabilities.currentExtent.width,
-    new_capabilities.currentExtent.height == UINT32_MAX
-      ? std::max(std::min(static_cast<uint32_t>(extent.height),
-                          new_capabilities.maxImageExtent.height),
-                 new_capabilities.minImageExtent.height)
-      : new_capabilities.currentExtent.height};
+  if (s._surface != VK_NULL_HANDLE) {
+    new_capabilities = ::get_surface_capabilities(_physical, s._surface, ec);
+    if (ec) return;
+
+    new_extent = {
+      new_capabilities.currentExtent.width == UINT32_MAX
+        ? std::max(std::min(static_cast<uint32_t>(extent.width),
+                            new_capabilities.maxImageExtent.width),
+                   new_capabilities.minImageExtent.width)
+        : new_capabilities.currentExtent.width,
+      new_capabilities.currentExtent.height == UINT32_MAX
+        ? std::max(std::min(static_cast<uint32_t>(extent.height),
+                            new_capabilities.maxImageExtent.height),
+                   new_capabilities.minImageExtent.height)
+        : new_capabilities.currentExtent.height};
+  }
 
   VkExtent3D image_extent{new_extent.width, new_extent.height, 1};
 
@@ -1143,6 +1583,7 @@ void renderer::resize(surface& s, wsi::extent2d const& extent,
   // predeclare to handle failure cleanup
   VkSwapchainKHR new_swapchain{VK_NULL_HANDLE};
   std::vector<VkImage> new_color_images;
+  std::vector<VkDeviceMemory> new_color_image_memory;
   std::vector<VkImageView> new_color_image_views;
   VkImage new_depth_image{VK_NULL_HANDLE}, new_color_target{VK_NULL_HANDLE},
     new_depth_target{VK_NULL_HANDLE};
@@ -1156,14 +1597,35 @@ void renderer::resize(surface& s, wsi::extent2d const& extent,
   std::vector<VkFramebuffer> new_framebuffers;
   std::vector<VkCommandBuffer> command_buffers;
 
-  new_swapchain =
-    ::create_swapchain(_device, s._surface, new_capabilities, new_extent,
-                       s._color_format, s._present_mode, s._swapchain, ec);
-  if (ec) goto fail;
-
-  std::tie(new_color_images, new_color_image_views) =
-    ::get_swapchain_images(_device, new_swapchain, s._color_format.format, ec);
-  if (ec) goto fail;
+  if (s._surface != VK_NULL_HANDLE) {
+    new_swapchain =
+      ::create_swapchain(_device, s._surface, new_capabilities, new_extent,
+                         s._color_format, s._present_mode, s._swapchain, ec);
+    if (ec) goto fail;
+
+    std::tie(new_color_images, new_color_image_views) = ::get_swapchain_images(
+      _device, new_swapchain, s._color_format.format, ec);
+    if (ec) goto fail;
+  } else {
+    // Offscreen surfaces own their color images in place of a swapchain
+    for (uint32_t i = 0; i < OFFSCREEN_IMAGES; ++i) {
+      VkImage image;
+      VkDeviceMemory memory;
+      VkImageView view;
+
+      std::tie(image, memory, view) = ::create_image_and_view(
+        _physical, _device, VK_IMAGE_TYPE_2D, s._color_format.format,
+        image_extent,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_SAMPLE_COUNT_1_BIT, 0,
+        VK_IMAGE_VIEW_TYPE_2D, {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, ec);
+      if (ec) goto fail;
+
+      new_color_images.push_back(image);
+      new_color_image_memory.push_back(memory);
+      new_color_image_views.push_back(view);
+    }
+  }
 
   std::tie(new_depth_image, new_depth_image_memory, new_depth_image_view) =
     ::create_image_and_view(
@@ -1204,7 +1666,7 @@ void renderer::resize(surface& s, wsi::extent2d const& extent,
                         s._render_pass, new_extent, ec);
   if (ec) goto fail;
 
-  if (s._swapchain != VK_NULL_HANDLE) release(s);
+  if (!s._framebuffers.empty()) release(s);
 
   s._capabilities = new_capabilities;
   s._extent = new_extent;
@@ -1212,6 +1674,7 @@ void renderer::resize(surface& s, wsi::extent2d const& extent,
   s._scissor = new_scissor;
   s._swapchain = new_swapchain;
   s._color_images = std::move(new_color_images);
+  s._color_image_memory = std::move(new_color_image_memory);
   s._color_image_views = std::move(new_color_image_views);
   s._depth_image = new_depth_image;
   s._depth_image_memory = new_depth_image_memory;
@@ -1258,6 +1721,11 @@ fail:
     if (view != VK_NULL_HANDLE) { vkDestroyImageView(_device, view, nullptr); }
   }
 
+  for (std::size_t i = 0; i < new_color_image_memory.size(); ++i) {
+    vkDestroyImage(_device, new_color_images[i], nullptr);
+    vkFreeMemory(_device, new_color_image_memory[i], nullptr);
+  }
+
   if (new_swapchain != VK_NULL_HANDLE) {
     vkDestroySwapchainKHR(_device, new_swapchain, nullptr);
   }
@@ -1279,41 +1747,283 @@ uint32_t renderer::acquire_next_image(surface& s,
 void renderer::submit_present(gsl::span<VkCommandBuffer> buffers, surface& s,
                               uint32_t image_index, VkFence fence,
                               std::error_code& ec) noexcept {
-  ec.clear();
+  submit(buffers, s, fence, ec);
+  if (ec) return;
+  present(s, image_index, ec);
+} // renderer::submit_present
 
-  VkPipelineStageFlags const wait_dst = VK_PIPELINE_STAGE_TRANSFER_BIT;
-  VkSubmitInfo sinfo = {};
-  sinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  sinfo.waitSemaphoreCount = 1;
-  sinfo.pWaitSemaphores = &s._image_available;
-  sinfo.pWaitDstStageMask = &wait_dst;
-  sinfo.commandBufferCount = gsl::narrow_cast<uint32_t>(buffers.size());
-  sinfo.pCommandBuffers = buffers.data();
-  sinfo.signalSemaphoreCount = 1;
-  sinfo.pSignalSemaphores = &s._render_finished;
-
-  VkResult rslt = vkQueueSubmit(_graphics_queue, 1, &sinfo, fence);
-  if (rslt != VK_SUCCESS) {
-    ec.assign(rslt, vk::result_category());
-    return;
+void renderer::submit(gsl::span<VkCommandBuffer> buffers, surface& s,
+                      VkFence fence, std::error_code& ec) noexcept {
+  surface_frame const frame{&s, 0, buffers};
+  submit({&frame, 1}, fence, ec);
+} // renderer::submit
+
+void renderer::present(surface& s, uint32_t image_index,
+                       std::error_code& ec) noexcept {
+  surface_frame const frame{&s, image_index, {}};
+  present({&frame, 1}, {}, ec);
+} // renderer::present
+
+void renderer::submit(gsl::span<surface_frame const> frames, VkFence fence,
+                      std::error_code& ec) noexcept {
+  enqueue(frames, fence);
+  flush(ec);
+} // renderer::submit
+
+void renderer::present(gsl::span<surface_frame const> frames,
+                       gsl::span<VkResult> results,
+                       std::error_code& ec) noexcept {
+  flush(ec);
+  if (ec) return;
+
+  std::vector<VkSemaphore> waits(frames.size());
+  std::vector<VkSwapchainKHR> swapchains(frames.size());
+  std::vector<uint32_t> image_indices(frames.size());
+
+  for (std::size_t i = 0; i < waits.size(); ++i) {
+    waits[i] = frames[i].target->_render_finished;
+    swapchains[i] = frames[i].target->_swapchain;
+    image_indices[i] = frames[i].image_index;
   }
 
   VkPresentInfoKHR pinfo = {};
   pinfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  pinfo.waitSemaphoreCount = 1;
-  pinfo.pWaitSemaphores = &s._render_finished;
-  pinfo.swapchainCount = 1;
-  pinfo.pSwapchains = &s._swapchain;
-  pinfo.pImageIndices = &image_index;
-
-  rslt = vkQueuePresentKHR(_graphics_queue, &pinfo);
+  pinfo.waitSemaphoreCount = gsl::narrow_cast<uint32_t>(waits.size());
+  pinfo.pWaitSemaphores = waits.data();
+  pinfo.swapchainCount = gsl::narrow_cast<uint32_t>(swapchains.size());
+  pinfo.pSwapchains = swapchains.data();
+  pinfo.pImageIndices = image_indices.data();
+  pinfo.pResults = results.empty() ? nullptr : results.data();
+
+  VkResult rslt = vkQueuePresentKHR(_graphics_queue, &pinfo);
   if (rslt != VK_SUCCESS) ec.assign(rslt, vk::result_category());
 } // renderer::present
 
+void renderer::enqueue(gsl::span<VkCommandBuffer const> buffers,
+                       gsl::span<VkSemaphore const> waits,
+                       gsl::span<VkPipelineStageFlags const> wait_stages,
+                       gsl::span<VkSemaphore const> signals,
+                       VkFence fence) noexcept {
+  _graphics_batch.add(buffers, waits, wait_stages, signals, fence);
+} // renderer::enqueue
+
+void renderer::enqueue(gsl::span<surface_frame const> frames,
+                       VkFence fence) noexcept {
+  VkPipelineStageFlags const wait_dst = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+  // Only the last frame signals the fence, which covers all of them
+  for (std::ptrdiff_t i = 0; i < frames.size(); ++i) {
+    auto const& frame = frames[i];
+    _graphics_batch.add(frame.buffers, {&frame.target->_image_available, 1},
+                        {&wait_dst, 1}, {&frame.target->_render_finished, 1},
+                        (i + 1 == frames.size() ? fence : VK_NULL_HANDLE));
+  }
+} // renderer::enqueue
+
+void renderer::flush(std::error_code& ec) noexcept {
+  ec.clear();
+  if (_graphics_batch.empty()) return;
+
+  // Signal the next timeline value after everything else in the batch, in
+  // the same vkQueueSubmit unless a fence passed to enqueue splits it
+  auto const value = _submitted_value + 1;
+  VkFence fence = VK_NULL_HANDLE;
+  if (_timeline != VK_NULL_HANDLE) {
+    _graphics_batch.add_signal(_timeline, value);
+  } else {
+    fence = timeline_fence(ec);
+    if (ec) {
+      _graphics_batch.clear();
+      return;
+    }
+    _graphics_batch.add({}, {}, {}, {}, fence);
+  }
+
+  _submit_count += _graphics_batch.flush(_graphics_queue, ec);
+  if (ec) {
+    if (fence != VK_NULL_HANDLE) _timeline_fences.free.push_back(fence);
+    return;
+  }
+
+  _submitted_value = value;
+  if (fence != VK_NULL_HANDLE) {
+    _timeline_fences.pending.emplace_back(value, fence);
+  }
+
+  // Destroy whatever earlier frames have finished with
+  std::error_code completed_ec;
+  auto const completed = completed_value(completed_ec);
+  if (!completed_ec) destroy_deferred(completed);
+} // renderer::flush
+
+uint64_t renderer::completed_value(std::error_code& ec) noexcept {
+  ec.clear();
+
+  if (_timeline != VK_NULL_HANDLE) {
+    uint64_t value;
+    VkResult rslt = _get_semaphore_counter_value(_device, _timeline, &value);
+    if (rslt != VK_SUCCESS) {
+      ec.assign(rslt, vk::result_category());
+      return _completed_value;
+    }
+
+    _completed_value = value;
+    return _completed_value;
+  }
+
+  // Values complete in order, so stop at the first fence not yet signaled.
+  // Only a frame or two of values are ever pending.
+  auto retired = _timeline_fences.pending.begin();
+  for (; retired != _timeline_fences.pending.end(); ++retired) {
+    VkResult rslt = vkGetFenceStatus(_device, retired->second);
+    if (rslt == VK_NOT_READY) break;
+    if (rslt != VK_SUCCESS) {
+      ec.assign(rslt, vk::result_category());
+      break;
+    }
+
+    vkResetFences(_device, 1, &retired->second);
+    _timeline_fences.free.push_back(retired->second);
+    _completed_value = retired->first;
+  }
+  _timeline_fences.pending.erase(_timeline_fences.pending.begin(), retired);
+
+  return _completed_value;
+} // renderer::completed_value
+
+void renderer::wait(uint64_t value, uint64_t timeout,
+                    std::error_code& ec) noexcept {
+  ec.clear();
+  Expects(value <= _submitted_value);
+  if (value <= _completed_value) return;
+
+  if (_timeline != VK_NULL_HANDLE) {
+    VkSemaphoreWaitInfoKHR winfo = {};
+    winfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    winfo.semaphoreCount = 1;
+    winfo.pSemaphores = &_timeline;
+    winfo.pValues = &value;
+
+    VkResult rslt = _wait_semaphores(_device, &winfo, timeout);
+    if (rslt != VK_SUCCESS) {
+      ec.assign(rslt, vk::result_category());
+      return;
+    }
+
+    _completed_value = value;
+    destroy_deferred(_completed_value);
+    return;
+  }
+
+  // Every value has a fence, so wait on value's own and then retire it and
+  // any before it
+  for (auto&& pending : _timeline_fences.pending) {
+    if (pending.first != value) continue;
+
+    VkResult rslt =
+      vkWaitForFences(_device, 1, &pending.second, VK_TRUE, timeout);
+    if (rslt != VK_SUCCESS) {
+      ec.assign(rslt, vk::result_category());
+      return;
+    }
+    break;
+  }
+
+  completed_value(ec);
+  if (!ec) destroy_deferred(_completed_value);
+} // renderer::wait
+
+VkFence renderer::timeline_fence(std::error_code& ec) noexcept {
+  ec.clear();
+  if (_timeline_fences.free.empty()) return ::create_fence(_device, ec);
+
+  auto fence = _timeline_fences.free.back();
+  _timeline_fences.free.pop_back();
+  return fence;
+} // renderer::timeline_fence
+
+template <class T, class Destroy>
+void renderer::defer(deferred<T>& list, T object,
+                     Destroy destroy_now) noexcept {
+  if (object == VK_NULL_HANDLE) return;
+
+  // Anything still enqueued goes to the device with the next flush
+  auto const value =
+    _graphics_batch.empty() ? _submitted_value : _submitted_value + 1;
+
+  std::error_code ec;
+  if (value <= _completed_value ||
+      (value <= _submitted_value && value <= completed_value(ec) && !ec)) {
+    destroy_now(object);
+    return;
+  }
+
+  list.emplace_back(value, object);
+} // renderer::defer
+
+// Destroy the objects at the front of list whose value is no greater than
+// completed, with destroy_now, and remove them.
+template <class T, class Destroy>
+static void destroy_completed(std::vector<std::pair<uint64_t, T>>& list,
+                              uint64_t completed,
+                              Destroy destroy_now) noexcept {
+  auto retired = list.begin();
+  for (; retired != list.end() && retired->first <= completed; ++retired) {
+    destroy_now(retired->second);
+  }
+  list.erase(list.begin(), retired);
+} // destroy_completed
+
+void renderer::destroy_deferred(uint64_t completed) noexcept {
+  auto& d = _deferred;
+
+  // Framebuffers before their views, views before their images, images
+  // before their memory, and swapchain images before their swapchain
+  destroy_completed(d.command_buffers, completed, [this](VkCommandBuffer cb) {
+    vkFreeCommandBuffers(_device, _graphics_command_pool, 1, &cb);
+  });
+  destroy_completed(d.pipelines, completed, [this](VkPipeline pipeline) {
+    vkDestroyPipeline(_device, pipeline, nullptr);
+  });
+  destroy_completed(d.layouts, completed, [this](VkPipelineLayout layout) {
+    vkDestroyPipelineLayout(_device, layout, nullptr);
+  });
+  destroy_completed(d.framebuffers, completed,
+                    [this](VkFramebuffer framebuffer) {
+                      vkDestroyFramebuffer(_device, framebuffer, nullptr);
+                    });
+  destroy_completed(d.image_views, completed, [this](VkImageView view) {
+    vkDestroyImageView(_device, view, nullptr);
+  });
+  destroy_completed(d.images, completed, [this](VkImage image) {
+    vkDestroyImage(_device, image, nullptr);
+  });
+  destroy_completed(d.memory, completed, [this](VkDeviceMemory memory) {
+    vkFreeMemory(_device, memory, nullptr);
+  });
+  destroy_completed(d.swapchains, completed, [this](VkSwapchainKHR swapchain) {
+    vkDestroySwapchainKHR(_device, swapchain, nullptr);
+  });
+} // renderer::destroy_deferred
+
+std::size_t renderer::deferred_count() const noexcept {
+  auto const& d = _deferred;
+  return d.command_buffers.size() + d.pipelines.size() + d.layouts.size() +
+         d.framebuffers.size() + d.image_views.size() + d.images.size() +
+         d.memory.size() + d.swapchains.size();
+} // renderer::deferred_count
+
 void renderer::destroy(surface& s) noexcept {
   LOG_ENTER;
 
+  // Submit anything enqueued, so once the device is idle nothing can use
+  // the surface, and destroy its swapchain now rather than deferring it
+  std::error_code ec;
+  flush(ec);
+  vkDeviceWaitIdle(_device);
   release(s);
+  destroy_deferred(_submitted_value);
+
   if (s._render_pass != VK_NULL_HANDLE) {
     vkDestroyRenderPass(_device, s._render_pass, nullptr);
   }
@@ -1333,62 +2043,63 @@ void renderer::destroy(surface& s) noexcept {
 void renderer::release(surface& s) noexcept {
   LOG_ENTER;
 
-  vkDeviceWaitIdle(_device);
+  auto& d = _deferred;
+  auto const destroy_framebuffer = [this](VkFramebuffer framebuffer) {
+    vkDestroyFramebuffer(_device, framebuffer, nullptr);
+  };
+  auto const destroy_image_view = [this](VkImageView view) {
+    vkDestroyImageView(_device, view, nullptr);
+  };
+  auto const destroy_image = [this](VkImage image) {
+    vkDestroyImage(_device, image, nullptr);
+  };
+  auto const free_memory = [this](VkDeviceMemory memory) {
+    vkFreeMemory(_device, memory, nullptr);
+  };
 
   for (auto&& framebuffer : s._framebuffers) {
-    vkDestroyFramebuffer(_device, framebuffer, nullptr);
+    defer(d.framebuffers, framebuffer, destroy_framebuffer);
   }
   s._framebuffers.clear();
 
-  if (s._depth_target_view != VK_NULL_HANDLE) {
-    vkDestroyImageView(_device, s._depth_target_view, nullptr);
-    s._depth_target_view = VK_NULL_HANDLE;
-  }
-  if (s._depth_target != VK_NULL_HANDLE) {
-    vkDestroyImage(_device, s._depth_target, nullptr);
-    s._depth_target = VK_NULL_HANDLE;
-  }
-  if (s._depth_target_memory != VK_NULL_HANDLE) {
-    vkFreeMemory(_device, s._depth_target_memory, nullptr);
-    s._depth_target_memory = VK_NULL_HANDLE;
-  }
-
-  if (s._color_target_view != VK_NULL_HANDLE) {
-    vkDestroyImageView(_device, s._color_target_view, nullptr);
-    s._color_target_view = VK_NULL_HANDLE;
-  }
-  if (s._color_target != VK_NULL_HANDLE) {
-    vkDestroyImage(_device, s._color_target, nullptr);
-    s._color_target = VK_NULL_HANDLE;
-  }
-  if (s._color_target_memory != VK_NULL_HANDLE) {
-    vkFreeMemory(_device, s._color_target_memory, nullptr);
-    s._color_target_memory = VK_NULL_HANDLE;
-  }
-
-  if (s._depth_image_view != VK_NULL_HANDLE) {
-    vkDestroyImageView(_device, s._depth_image_view, nullptr);
-    s._depth_image_view = VK_NULL_HANDLE;
-  }
-  if (s._depth_image != VK_NULL_HANDLE) {
-    vkDestroyImage(_device, s._depth_image, nullptr);
-    s._depth_image = VK_NULL_HANDLE;
-  }
-  if (s._depth_image_memory != VK_NULL_HANDLE) {
-    vkFreeMemory(_device, s._depth_image_memory, nullptr);
-    s._depth_image_memory = VK_NULL_HANDLE;
-  }
+  defer(d.image_views, s._depth_target_view, destroy_image_view);
+  defer(d.images, s._depth_target, destroy_image);
+  defer(d.memory, s._depth_target_memory, free_memory);
+  s._depth_target_view = VK_NULL_HANDLE;
+  s._depth_target = VK_NULL_HANDLE;
+  s._depth_target_memory = VK_NULL_HANDLE;
+
+  defer(d.image_views, s._color_target_view, destroy_image_view);
+  defer(d.images, s._color_target, destroy_image);
+  defer(d.memory, s._color_target_memory, free_memory);
+  s._color_target_view = VK_NULL_HANDLE;
+  s._color_target = VK_NULL_HANDLE;
+  s._color_target_memory = VK_NULL_HANDLE;
+
+  defer(d.image_views, s._depth_image_view, destroy_image_view);
+  defer(d.images, s._depth_image, destroy_image);
+  defer(d.memory, s._depth_image_memory, free_memory);
+  s._depth_image_view = VK_NULL_HANDLE;
+  s._depth_image = VK_NULL_HANDLE;
+  s._depth_image_memory = VK_NULL_HANDLE;
 
   for (auto&& view : s._color_image_views) {
-    vkDestroyImageView(_device, view, nullptr);
+    defer(d.image_views, view, destroy_image_view);
   }
   s._color_image_views.clear();
-  s._color_images.clear();
 
-  if (s._swapchain != VK_NULL_HANDLE) {
-    vkDestroySwapchainKHR(_device, s._swapchain, nullptr);
-    s._swapchain = VK_NULL_HANDLE;
+  // Swapchain images are owned by the swapchain, offscreen images are not
+  for (std::size_t i = 0; i < s._color_image_memory.size(); ++i) {
+    defer(d.images, s._color_images[i], destroy_image);
+    defer(d.memory, s._color_image_memory[i], free_memory);
   }
+  s._color_image_memory.clear();
+  s._color_images.clear();
+
+  defer(d.swapchains, s._swapchain, [this](VkSwapchainKHR swapchain) {
+    vkDestroySwapchainKHR(_device, swapchain, nullptr);
+  });
+  s._swapchain = VK_NULL_HANDLE;
 
   LOG_LEAVE;
 } // renderer::release
@@ -1423,32 +2134,24 @@ void renderer::submit(gsl::span<VkCommandBuffer> command_buffers, bool onetime,
   LOG_ENTER;
   ec.clear();
 
-  VkSubmitInfo sinfo = {};
-  sinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  sinfo.commandBufferCount = gsl::narrow_cast<uint32_t>(command_buffers.size());
-  sinfo.pCommandBuffers = command_buffers.data();
-
-  auto fence = onetime ? _graphics_onetime_fence : VK_NULL_HANDLE;
-  VkResult rslt = vkQueueSubmit(_graphics_queue, 1, &sinfo, fence);
-  if (rslt != VK_SUCCESS) {
-    ec.assign(rslt, vk::result_category());
-    return;
-  }
+  enqueue(command_buffers, {}, {}, {}, VK_NULL_HANDLE);
+  flush(ec);
+  if (ec) return;
 
   if (onetime) {
-    rslt = vkWaitForFences(_device, 1, &_graphics_onetime_fence, VK_TRUE,
-                           UINT64_MAX);
-    if (rslt != VK_SUCCESS) {
-      ec.assign(rslt, vk::result_category());
-      return;
-    }
-
-    vkResetFences(_device, 1, &_graphics_onetime_fence);
+    wait(_submitted_value, UINT64_MAX, ec);
+    if (ec) return;
   }
 
   LOG_LEAVE;
 } // renderer::submit
 
+void renderer::submit(gsl::span<VkCommandBuffer> command_buffers,
+                      VkFence fence, std::error_code& ec) noexcept {
+  enqueue(command_buffers, {}, {}, {}, fence);
+  flush(ec);
+} // renderer::submit
+
 void renderer::free(std::vector<VkCommandBuffer>& command_buffers) noexcept {
   LOG_ENTER;
   if (command_buffers.empty()) {
@@ -1456,122 +2159,185 @@ void renderer::free(std::vector<VkCommandBuffer>& command_buffers) noexcept {
     return;
   }
 
-  vkDeviceWaitIdle(_device);
-  vkFreeCommandBuffers(_device, _graphics_command_pool,
-                       gsl::narrow_cast<uint32_t>(command_buffers.size()),
-                       command_buffers.data());
+  for (auto&& command_buffer : command_buffers) {
+    defer(_deferred.command_buffers, command_buffer,
+          [this](VkCommandBuffer cb) {
+            vkFreeCommandBuffers(_device, _graphics_command_pool, 1, &cb);
+          });
+  }
   command_buffers.clear();
 
   LOG_LEAVE;
 } // renderer::free
 
-class shader_includer : public shaderc::CompileOptions::IncluderInterface {
-public:
-  shaderc_include_result* GetInclude(const char* requested_source,
-                                     shaderc_include_type type,
-                                     const char* requesting_source,
-                                     size_t /*include_depth*/) override {
-    if (type == shaderc_include_type_relative) {
-      plat::filesystem::path parent{requesting_source};
-      parent = parent.parent_path();
-      _include_paths.push_back(parent / requested_source);
-    } else {
-      _include_paths.push_back(requested_source);
-    }
-    plat::filesystem::path& path = _include_paths.back();
-
-    try {
-      if (!plat::filesystem::exists(path)) path.clear();
-    } catch (...) { path.clear(); }
-
-    if (!path.empty()) {
-      std::error_code ec;
-      auto source = plat::read_file(path, ec);
-      if (ec) {
-        _include_sources.push_back(ec.message());
-      } else {
-        _include_sources.push_back({source.data(), source.size()});
-      }
-    } else {
-      _include_sources.push_back("file not found");
-    }
+static shaderc_shader_kind to_shaderc_kind(shader::types type) noexcept {
+  switch (type) {
+  case shader::types::vertex: return shaderc_vertex_shader;
+  case shader::types::fragment: return shaderc_fragment_shader;
+  }
+  PLAT_MARK_UNREACHABLE;
+} // to_shaderc_kind
+
+std::vector<uint32_t> renderer::compile(shader_compiler& compiler,
+                                        gsl::span<char const> source,
+                                        gsl::czstring name, shader::types type,
+                                        shader_optimization opt,
+                                        std::string& error_message,
+                                        std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
 
-    _include_results.push_back(new shaderc_include_result);
-    shaderc_include_result* result = _include_results.back();
+  auto const kind = to_shaderc_kind(type);
+  std::vector<uint32_t> code;
 
-    result->source_name_length = _include_paths.back().string().size();
-    result->source_name = _include_paths.back().string().c_str();
+  // spirv_opt only changes the code when the optimizer is built in.
+  bool const spirv_opt = opt.spirv_opt && shader_compiler::has_spirv_opt();
+  uint32_t const options =
+    static_cast<uint32_t>(opt.level) | (spirv_opt ? 0x100u : 0u);
 
-    result->content_length = _include_sources.back().size();
-    result->content = _include_sources.back().data();
+  // The preprocessed source includes the contents of every included file, so
+  // it changes whenever anything the shader depends on changes.
+  uint64_t key{0};
+  if (_spirv_cache) {
+    auto const text =
+      compiler.preprocess(source, name, kind, error_message, ec);
+    if (ec) return code;
 
-    result->user_data = nullptr;
-    return result;
-  }; // GetInclude
+    key = spirv_cache::key(text, kind, options);
+    if (_spirv_cache.load(key, code)) return code;
+  }
 
-  void ReleaseInclude(shaderc_include_result* data) override {
-    for (std::size_t i = 0; i < _include_results.size(); ++i) {
-      if (_include_results[i] == data) {
-        _include_results.erase(_include_results.begin() + i);
-        break;
-      }
+  code = compiler.compile(source, name, kind, opt, error_message, ec);
+  if (ec) return code;
+
+  if (_spirv_cache) {
+    std::error_code store_ec;
+    _spirv_cache.store(key, code, store_ec);
+    if (store_ec) {
+      LOG_WARN("storing %s in the SPIR-V cache failed: %s", name,
+               store_ec.message().c_str());
     }
-  } // ReleaseInclude
+  }
 
-private:
-  std::vector<plat::filesystem::path> _include_paths{};
-  std::vector<std::string> _include_sources{};
-  std::vector<shaderc_include_result*> _include_results{};
-}; // class shader_includer
+  LOG_LEAVE;
+  return code;
+} // renderer::compile
 
-static std::pair<std::vector<uint32_t>, std::string>
-compile_shader(plat::filesystem::path const& path, shaderc_shader_kind kind,
-               std::error_code& ec) noexcept {
+shader renderer::create_shader(plat::filesystem::path const& path,
+                               shader::types type, shader_optimization opt,
+                               std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
 
-  shaderc::Compiler compiler;
-  shaderc::CompileOptions options;
-  options.SetOptimizationLevel(shaderc_optimization_level_size);
-  options.SetIncluder(gsl::make_unique<shader_includer>());
+  shader s;
 
-  auto source = plat::read_file(path, ec);
-  if (ec) return {};
+  // Read rather than map, so the file can be rewritten during the compile
+  auto const source = plat::read_file(path, ec);
+  if (ec) return s;
 
-  auto spv = compiler.CompileGlslToSpv(source.data(), source.size(), kind,
-                                       path.string().c_str(), "main", options);
-  if (spv.GetCompilationStatus() != shaderc_compilation_status_success) {
-    ec.assign(spv.GetCompilationStatus(), vk::shaderc_result_category());
-    return {{}, spv.GetErrorMessage()};
-  }
+  auto const code = compile(*_compiler, source, path.string().c_str(),
+                            type, opt, s._error_message, ec);
+  if (ec) return s;
 
-  std::vector<uint32_t> code;
-  std::copy(spv.begin(), spv.end(), std::back_inserter(code));
+  s = create_shader(code, ec);
 
   LOG_LEAVE;
-  return {code, ""};
-} // compile_shader
+  return s;
+} // renderer::create_shader
 
-shader renderer::create_shader(plat::filesystem::path const& path,
-                               shader::types type,
+// Scan SPIR-V for the push constant members it reads. Members are only
+// followed through access chains with a constant first index, which is how
+// glslang reads block members; any other use of the block counts as reading
+// all of it. A member is taken to extend to the next member's offset.
+static uint64_t push_constants_read(gsl::span<uint32_t const> code) noexcept {
+  enum : uint32_t {
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpFunction = 54,
+    OpVariable = 59,
+    OpAccessChain = 65,
+    OpInBoundsAccessChain = 66,
+    OpMemberDecorate = 72,
+    DecorationOffset = 35,
+    StorageClassPushConstant = 9,
+  };
+  uint64_t const ALL = UINT64_MAX;
+
+  auto const size = static_cast<std::size_t>(code.size());
+  if (size < 5 || code[0] != 0x07230203) return ALL;
+
+  std::unordered_map<uint32_t, uint32_t> constants, pointees;
+  std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>>
+    offsets; // struct id to (member, byte offset)
+  uint32_t block{0}, type{0};
+
+  // The declarations all come before the first function
+  std::size_t i = 5;
+  for (; i < size; i += code[i] >> 16) {
+    uint32_t const count = code[i] >> 16, op = code[i] & 0xFFFF;
+    if (count == 0 || i + count > size) return ALL;
+    if (op == OpFunction) break;
+
+    if (op == OpConstant && count == 4) {
+      constants[code[i + 2]] = code[i + 3];
+    } else if (op == OpTypePointer && count == 4) {
+      pointees[code[i + 1]] = code[i + 3];
+    } else if (op == OpMemberDecorate && count == 5 &&
+               code[i + 3] == DecorationOffset) {
+      offsets[code[i + 1]].emplace_back(code[i + 2], code[i + 4]);
+    } else if (op == OpVariable && count >= 4 &&
+               code[i + 3] == StorageClassPushConstant) {
+      if (block != 0) return ALL;
+      block = code[i + 2];
+      type = pointees[code[i + 1]];
+    }
+  }
+
+  if (block == 0) return 0;
+
+  auto& members = offsets[type];
+  std::sort(members.begin(), members.end(),
+            [](auto&& a, auto&& b) { return a.second < b.second; });
+
+  uint64_t read = 0;
+  for (; i < size; i += code[i] >> 16) {
+    uint32_t const count = code[i] >> 16, op = code[i] & 0xFFFF;
+    if (count == 0 || i + count > size) return ALL;
+
+    if ((op == OpAccessChain || op == OpInBoundsAccessChain) && count >= 5 &&
+        code[i + 3] == block) {
+      auto const index = constants.find(code[i + 4]);
+      if (index == constants.end()) return ALL;
+
+      auto member =
+        std::find_if(members.begin(), members.end(),
+                     [&index](auto&& m) { return m.first == index->second; });
+      if (member == members.end()) return ALL;
+
+      uint32_t const begin = member->second / 4;
+      uint32_t const end =
+        ++member == members.end() ? 64 : (member->second + 3) / 4;
+      for (uint32_t w = begin; w < end && w < 64; ++w) {
+        read |= UINT64_C(1) << w;
+      }
+      continue;
+    }
+
+    for (uint32_t j = 1; j < count; ++j) {
+      if (code[i + j] == block) return ALL;
+    }
+  }
+
+  return read;
+} // push_constants_read
+
+shader renderer::create_shader(gsl::span<uint32_t const> code,
                                std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
 
   shader s;
 
-  auto const kind = [&type]() {
-    switch (type) {
-    case shader::types::vertex: return shaderc_vertex_shader;
-    case shader::types::fragment: return shaderc_fragment_shader;
-    default: PLAT_MARK_UNREACHABLE;
-    }
-  }();
-
-  std::vector<uint32_t> code;
-  std::tie(code, s._error_message) = compile_shader(path, kind, ec);
-  if (ec) return s;
-
   VkShaderModuleCreateInfo cinfo = {};
   cinfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
   cinfo.codeSize = gsl::narrow_cast<uint32_t>(code.size() * 4);
@@ -1583,12 +2349,22 @@ shader renderer::create_shader(plat::filesystem::path const& path,
     return s;
   }
 
+  s._push_constants_read = push_constants_read(code);
+
   LOG_LEAVE;
   return s;
 } // renderer::create_shader
 
+void renderer::use_spirv_cache(plat::filesystem::path directory,
+                               std::error_code& ec) noexcept {
+  LOG_ENTER;
+  _spirv_cache = spirv_cache::open(std::move(directory), ec);
+  LOG_LEAVE;
+} // renderer::use_spirv_cache
+
 void renderer::destroy(shader& s) noexcept {
   LOG_ENTER;
+  // Pipelines keep what they need of a module, so it is not deferred
   if (s._module != VK_NULL_HANDLE) {
     vkDestroyShaderModule(_device, s._module, nullptr);
   }
@@ -1625,9 +2401,9 @@ VkPipelineLayout renderer::create_pipeline_layout(
 
 void renderer::destroy(VkPipelineLayout layout) noexcept {
   LOG_ENTER;
-  if (layout != VK_NULL_HANDLE) {
-    vkDestroyPipelineLayout(_device, layout, nullptr);
-  }
+  defer(_deferred.layouts, layout, [this](VkPipelineLayout l) {
+    vkDestroyPipelineLayout(_device, l, nullptr);
+  });
   LOG_LEAVE;
 } // renderer::destroy
 
@@ -1639,7 +2415,7 @@ renderer::create_pipelines(gsl::span<VkGraphicsPipelineCreateInfo> cinfos,
 
   std::vector<VkPipeline> pipelines(cinfos.size());
   VkResult rslt = vkCreateGraphicsPipelines(
-    _device, VK_NULL_HANDLE, gsl::narrow_cast<uint32_t>(cinfos.size()),
+    _device, _pipeline_cache, gsl::narrow_cast<uint32_t>(cinfos.size()),
     cinfos.data(), nullptr, pipelines.data());
   if (rslt != VK_SUCCESS) {
     ec.assign(rslt, vk::result_category());
@@ -1652,10 +2428,88 @@ renderer::create_pipelines(gsl::span<VkGraphicsPipelineCreateInfo> cinfos,
 
 void renderer::destroy(gsl::span<VkPipeline> pipes) noexcept {
   LOG_ENTER;
-  for (auto&& pipe : pipes) vkDestroyPipeline(_device, pipe, nullptr);
+  for (auto&& pipe : pipes) {
+    defer(_deferred.pipelines, pipe, [this](VkPipeline p) {
+      vkDestroyPipeline(_device, p, nullptr);
+    });
+  }
   LOG_LEAVE;
 } // renderer::destroy
 
+void renderer::load_pipeline_cache(plat::filesystem::path const& path,
+                                   std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  plat::mapped_file data;
+  bool const found = plat::filesystem::exists(path, ec);
+  if (ec) return;
+
+  gsl::span<char const> contents;
+  if (found) {
+    data = plat::mapped_file::open(path, ec);
+    if (ec) return;
+
+    // Drivers do not all check the data beyond its header, so a truncated
+    // or corrupt file is rejected here and the current, empty, cache kept.
+    contents = cache_blob::contents(data.bytes(), device_uuid(), ec);
+    if (ec) return;
+  }
+
+  // The driver validates the header of the initial data and ignores data
+  // from a different device or driver version.
+  VkPipelineCacheCreateInfo cinfo = {};
+  cinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cinfo.initialDataSize = static_cast<std::size_t>(contents.size());
+  cinfo.pInitialData = contents.data();
+
+  VkPipelineCache cache;
+  VkResult rslt = vkCreatePipelineCache(_device, &cinfo, nullptr, &cache);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return;
+  }
+
+  if (_pipeline_cache != VK_NULL_HANDLE) {
+    vkDestroyPipelineCache(_device, _pipeline_cache, nullptr);
+  }
+  _pipeline_cache = cache;
+
+  LOG_LEAVE;
+} // renderer::load_pipeline_cache
+
+void renderer::save_pipeline_cache(plat::filesystem::path const& path,
+                                   std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  std::size_t size{0};
+  VkResult rslt =
+    vkGetPipelineCacheData(_device, _pipeline_cache, &size, nullptr);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return;
+  }
+
+  std::vector<char> data(size);
+  rslt = vkGetPipelineCacheData(_device, _pipeline_cache, &size, data.data());
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return;
+  }
+
+  cache_blob::write(path, device_uuid(), data, ec);
+
+  LOG_LEAVE;
+} // renderer::save_pipeline_cache
+
+cache_blob::uuid renderer::device_uuid() const noexcept {
+  cache_blob::uuid uuid;
+  static_assert(sizeof(uuid) == VK_UUID_SIZE, "uuid must hold a VkUUID");
+  std::memcpy(uuid.data(), _properties.pipelineCacheUUID, uuid.size());
+  return uuid;
+} // renderer::device_uuid
+
 VkFence renderer::create_fence(bool signaled, std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
@@ -1697,20 +2551,79 @@ void renderer::destroy(VkFence fence) noexcept {
   LOG_LEAVE;
 } // renderer::destroy
 
+VkQueryPool renderer::create_timestamp_query_pool(uint32_t count,
+                                                  std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  VkQueryPoolCreateInfo cinfo = {};
+  cinfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  cinfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  cinfo.queryCount = count;
+
+  VkQueryPool pool;
+  VkResult rslt = vkCreateQueryPool(_device, &cinfo, nullptr, &pool);
+  if (rslt != VK_SUCCESS) {
+    ec.assign(rslt, vk::result_category());
+    return VK_NULL_HANDLE;
+  }
+
+  LOG_LEAVE;
+  return pool;
+} // renderer::create_timestamp_query_pool
+
+std::vector<uint64_t> renderer::get_timestamps(VkQueryPool pool,
+                                               uint32_t first, uint32_t count,
+                                               std::error_code& ec) noexcept {
+  ec.clear();
+
+  std::vector<uint64_t> timestamps(count);
+  VkResult rslt = vkGetQueryPoolResults(
+    _device, pool, first, count, timestamps.size() * sizeof(uint64_t),
+    timestamps.data(), sizeof(uint64_t),
+    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+  if (rslt != VK_SUCCESS) ec.assign(rslt, vk::result_category());
+
+  return timestamps;
+} // renderer::get_timestamps
+
+void renderer::destroy(VkQueryPool pool) noexcept {
+  LOG_ENTER;
+  if (pool != VK_NULL_HANDLE) vkDestroyQueryPool(_device, pool, nullptr);
+  LOG_LEAVE;
+} // renderer::destroy
+
 renderer::renderer(renderer&& other) noexcept
 : _instance{other._instance}
 , _callback{other._callback}
 , _physical{other._physical}
+, _properties{other._properties}
 , _device{other._device}
 , _graphics_queue_family_index{other._graphics_queue_family_index}
 , _graphics_queue{other._graphics_queue}
 , _graphics_command_pool{other._graphics_command_pool}
-, _graphics_onetime_fence{other._graphics_onetime_fence} {
+, _graphics_batch{std::move(other._graphics_batch)}
+, _submit_count{other._submit_count}
+, _timeline{other._timeline}
+, _get_semaphore_counter_value{other._get_semaphore_counter_value}
+, _wait_semaphores{other._wait_semaphores}
+, _submitted_value{other._submitted_value}
+, _completed_value{other._completed_value}
+, _timeline_fences{std::move(other._timeline_fences)}
+, _deferred{std::move(other._deferred)}
+, _compiler{std::move(other._compiler)}
+, _spirv_cache{std::move(other._spirv_cache)}
+, _optimization{other._optimization}
+, _pipeline_cache{other._pipeline_cache} {
   other._instance = VK_NULL_HANDLE;
   other._callback = VK_NULL_HANDLE;
   other._device = VK_NULL_HANDLE;
   other._graphics_command_pool = VK_NULL_HANDLE;
-  other._graphics_onetime_fence = VK_NULL_HANDLE;
+  other._timeline = VK_NULL_HANDLE;
+  other._timeline_fences.pending.clear();
+  other._timeline_fences.free.clear();
+  other._deferred = deferred_deletions{};
+  other._pipeline_cache = VK_NULL_HANDLE;
 } // renderer::renderer
 
 renderer& renderer::operator=(renderer&& rhs) noexcept {
@@ -1719,17 +2632,34 @@ renderer& renderer::operator=(renderer&& rhs) noexcept {
   _instance = rhs._instance;
   _callback = rhs._callback;
   _physical = rhs._physical;
+  _properties = rhs._properties;
   _device = rhs._device;
   _graphics_queue_family_index = rhs._graphics_queue_family_index;
   _graphics_queue = rhs._graphics_queue;
   _graphics_command_pool = rhs._graphics_command_pool;
-  _graphics_onetime_fence = rhs._graphics_onetime_fence;
+  _graphics_batch = std::move(rhs._graphics_batch);
+  _submit_count = rhs._submit_count;
+  _timeline = rhs._timeline;
+  _get_semaphore_counter_value = rhs._get_semaphore_counter_value;
+  _wait_semaphores = rhs._wait_semaphores;
+  _submitted_value = rhs._submitted_value;
+  _completed_value = rhs._completed_value;
+  _timeline_fences = std::move(rhs._timeline_fences);
+  _deferred = std::move(rhs._deferred);
+  _compiler = std::move(rhs._compiler);
+  _spirv_cache = std::move(rhs._spirv_cache);
+  _optimization = rhs._optimization;
+  _pipeline_cache = rhs._pipeline_cache;
 
   rhs._instance = VK_NULL_HANDLE;
   rhs._callback = VK_NULL_HANDLE;
   rhs._device = VK_NULL_HANDLE;
   rhs._graphics_command_pool = VK_NULL_HANDLE;
-  rhs._graphics_onetime_fence = VK_NULL_HANDLE;
+  rhs._timeline = VK_NULL_HANDLE;
+  rhs._timeline_fences.pending.clear();
+  rhs._timeline_fences.free.clear();
+  rhs._deferred = deferred_deletions{};
+  rhs._pipeline_cache = VK_NULL_HANDLE;
 
   return *this;
 } // renderer::operator=
@@ -1737,8 +2667,21 @@ renderer& renderer::operator=(renderer&& rhs) noexcept {
 renderer::~renderer() noexcept {
   LOG_ENTER;
 
-  if (_graphics_onetime_fence != VK_NULL_HANDLE) {
-    vkDestroyFence(_device, _graphics_onetime_fence, nullptr);
+  if (_pipeline_cache != VK_NULL_HANDLE) {
+    vkDestroyPipelineCache(_device, _pipeline_cache, nullptr);
+  }
+
+  // The timeline may still have work pending, and objects waiting on it
+  if (_submitted_value != _completed_value) vkDeviceWaitIdle(_device);
+  destroy_deferred(UINT64_MAX);
+  for (auto&& pending : _timeline_fences.pending) {
+    vkDestroyFence(_device, pending.second, nullptr);
+  }
+  for (auto&& fence : _timeline_fences.free) {
+    vkDestroyFence(_device, fence, nullptr);
+  }
+  if (_timeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(_device, _timeline, nullptr);
   }
   if (_graphics_command_pool != VK_NULL_HANDLE) {
     vkDestroyCommandPool(_device, _graphics_command_pool, nullptr);
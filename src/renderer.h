@@ -4,13 +4,18 @@
 #include <plat/filesystem.h>
 #include <wsi/window.h>
 #include <vk/result.h>
+#include "cache_blob.h"
+#include "shader_compiler.h"
+#include "spirv_cache.h"
 #include <gsl.h>
 #include <filesystem>
+#include <utility>
 #include <vector>
 
 // Holds all of the data for a surface. This includes the swapchain,
 // renderpass, and framebuffers.
-// Surfaces must be resized when the window is resized.
+// Surfaces must be resized when the window is resized. Offscreen surfaces
+// have no swapchain and instead own their color images.
 class surface {
 public:
   std::size_t num_images() const noexcept { return _color_images.size(); }
@@ -29,6 +34,14 @@ public:
   VkRect2D& scissor() noexcept { return _scissor; }
   VkRect2D const& scissor() const noexcept { return _scissor; }
 
+  // True if the render passes of this surface and other are compatible: the
+  // same formats and sample count. Pipelines and command buffers created for
+  // one can then be used with the other.
+  bool compatible(surface const& other) const noexcept {
+    return _color_format.format == other._color_format.format &&
+           _depth_format == other._depth_format && _samples == other._samples;
+  }
+
   surface() noexcept {}
   surface(surface const&) = delete;
   surface(surface&& other) noexcept;
@@ -56,6 +69,7 @@ private:
 
   constexpr static uint32_t MAX_IMAGES = 4;
   std::vector<VkImage> _color_images{};
+  std::vector<VkDeviceMemory> _color_image_memory{}; // only when offscreen
   std::vector<VkImageView> _color_image_views{};
 
   VkImage _depth_image{VK_NULL_HANDLE};
@@ -75,6 +89,14 @@ private:
   friend class renderer;
 }; // class surface
 
+// One surface's part of a frame drawn to several surfaces at once: the image
+// acquired from it and the command buffers that render into that image.
+struct surface_frame {
+  surface* target{nullptr};
+  uint32_t image_index{0};
+  gsl::span<VkCommandBuffer> buffers{};
+}; // struct surface_frame
+
 // Convenience class to hold both the VkShaderModule for a shader as well as
 // any error message from compiling the shader.
 class shader {
@@ -88,6 +110,12 @@ public:
 
   std::string const& error_message() const noexcept { return _error_message; }
 
+  // The parts of the push constant block the shader may read, one bit per
+  // 4-byte word: bit i covers bytes [4i, 4i + 4). A member read at all sets
+  // the bits for all of it, and anything the scan of the SPIR-V cannot
+  // follow sets every bit.
+  uint64_t push_constants_read() const noexcept { return _push_constants_read; }
+
   shader() noexcept {}
   shader(shader const&) = delete;
   shader(shader&& other) noexcept;
@@ -98,16 +126,113 @@ public:
 private:
   VkShaderModule _module{VK_NULL_HANDLE};
   std::string _error_message{};
+  uint64_t _push_constants_read{UINT64_MAX};
 
   friend class renderer;
 }; // class shader
 
+// Values for the specialization constants of a pipeline's shaders, keyed by
+// constant_id. Every value is 32 bits, matching GLSL int, uint, float and
+// bool constants. Pipelines that differ only in these values can share one
+// compiled shader module.
+class specialization_constants {
+public:
+  // Set constant_id to value, replacing any earlier value.
+  void set(uint32_t constant_id, int32_t value) noexcept;
+  void set(uint32_t constant_id, uint32_t value) noexcept;
+  void set(uint32_t constant_id, float value) noexcept;
+  void set(uint32_t constant_id, bool value) noexcept;
+
+  // Get constant_id as an int, or fallback if it is not set.
+  int32_t get(uint32_t constant_id, int32_t fallback) const noexcept;
+
+  bool empty() const noexcept { return _entries.empty(); }
+
+  // The specialization info for these values, which points into this object
+  // and is valid until it is next changed.
+  VkSpecializationInfo info() const noexcept;
+
+  std::size_t hash() const noexcept;
+
+  bool operator==(specialization_constants const& other) const noexcept;
+  bool operator!=(specialization_constants const& other) const noexcept {
+    return !(*this == other);
+  }
+
+  struct hasher {
+    std::size_t operator()(specialization_constants const& c) const noexcept {
+      return c.hash();
+    }
+  }; // struct hasher
+
+private:
+  void set_bits(uint32_t constant_id, uint32_t bits) noexcept;
+
+  // Sorted by constantID so equal sets of values compare equal
+  std::vector<VkSpecializationMapEntry> _entries{};
+  std::vector<uint32_t> _data{};
+}; // class specialization_constants
+
+// Submits for one queue gathered over a frame, so they reach the device in
+// as few vkQueueSubmit calls as possible instead of one each. Command buffers
+// and semaphores are copied in, so what is passed to add need not outlive
+// the call.
+class submit_batch {
+public:
+  // Add a submit of buffers that waits on each of waits at the matching
+  // stage of wait_stages and signals each of signals when it completes. If
+  // fence is not VK_NULL_HANDLE, it is signaled once this submit and every
+  // one added before it have completed.
+  void add(gsl::span<VkCommandBuffer const> buffers,
+           gsl::span<VkSemaphore const> waits,
+           gsl::span<VkPipelineStageFlags const> wait_stages,
+           gsl::span<VkSemaphore const> signals, VkFence fence) noexcept;
+
+  // Add a submit with no command buffers that sets timeline, a timeline
+  // semaphore, to value once every submit added before it has completed.
+  void add_signal(VkSemaphore timeline, uint64_t value) noexcept;
+
+  bool empty() const noexcept { return _entries.empty(); }
+
+  // Submit everything added to queue, in order, and clear the batch.
+  // vkQueueSubmit signals one fence, so the batch is split after each submit
+  // that has a fence; usually only the last one does and there is a single
+  // call. Returns the number of calls made. If ec is true, then an error
+  // occurred and the rest of the batch was dropped.
+  uint32_t flush(VkQueue queue, std::error_code& ec) noexcept;
+
+  void clear() noexcept;
+
+private:
+  // Ranges of the arrays below. The VkSubmitInfos are only built by flush,
+  // since the arrays may reallocate while the batch is filled.
+  struct entry {
+    uint32_t first_wait;
+    uint32_t wait_count;
+    uint32_t first_buffer;
+    uint32_t buffer_count;
+    uint32_t first_signal;
+    uint32_t signal_count;
+    VkFence fence;
+    uint64_t timeline_value; // the value of a timeline signal, or 0
+  }; // struct entry
+
+  std::vector<entry> _entries{};
+  std::vector<VkSemaphore> _waits{};
+  std::vector<VkPipelineStageFlags> _wait_stages{};
+  std::vector<VkCommandBuffer> _buffers{};
+  std::vector<VkSemaphore> _signals{};
+  std::vector<VkSubmitInfo> _infos{}; // kept to reuse the allocation
+  std::vector<VkTimelineSemaphoreSubmitInfoKHR> _timeline_infos{};
+}; // class submit_batch
+
 enum class renderer_result {
   success = 0,
   no_device = 1,
   initialization_failed = 2,
   surface_not_supported = 3,
   no_memory_type = 4,
+  samples_not_supported = 5,
 }; // class renderer_result
 
 class renderer_result_category_impl : public std::error_category {
@@ -128,6 +253,8 @@ inline std::error_code make_error_code(renderer_result e) noexcept {
 enum class renderer_options : uint8_t {
   none = 0,
   use_integrated_gpu = (1 << 1),
+  headless = (1 << 2), // no window surfaces, only offscreen surfaces
+  no_timeline_semaphore = (1 << 3), // track the timeline with fences
 }; // renderer_options
 
 // Holds all of the data for rendering. Also provides methods for creating
@@ -135,6 +262,10 @@ enum class renderer_options : uint8_t {
 // command buffers for execution on the device.
 class renderer {
 public:
+  // The sample count of surfaces created for windows.
+  static constexpr VkSampleCountFlagBits WINDOW_SURFACE_SAMPLES =
+    VK_SAMPLE_COUNT_8_BIT;
+
   // Create a new renderer. If ec is true, then an error occurred during
   // creation and the renderer object is in an invalid state.
   static renderer create(gsl::czstring application_name, renderer_options opts,
@@ -147,6 +278,15 @@ public:
   surface create_surface(wsi::window const& window,
                          std::error_code& ec) noexcept;
 
+  // Create a new offscreen surface of the given extent and sample count.
+  // Offscreen surfaces cannot be acquired or presented; after rendering the
+  // color images are in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. If ec is true,
+  // then an error occurred during creation and the surface object is in an
+  // invalid state.
+  surface create_surface(wsi::extent2d const& extent,
+                         VkSampleCountFlagBits samples,
+                         std::error_code& ec) noexcept;
+
   // Resize a surface. Must be called when the window that was passed for
   // surface creation is resized. This is not automatically done to allow
   // the render loop to determine when to perform the resize. If ec is true,
@@ -169,23 +309,103 @@ public:
                       uint32_t image_index, VkFence fence,
                       std::error_code& ec) noexcept;
 
-  void destroy(surface& s) noexcept;
+  // The two halves of submit_present, for callers that time them separately.
+  // submit waits on the image acquired from s and signals that rendering to
+  // it is finished; present waits on that signal.
+  void submit(gsl::span<VkCommandBuffer> buffers, surface& s, VkFence fence,
+              std::error_code& ec) noexcept;
+  void present(surface& s, uint32_t image_index, std::error_code& ec) noexcept;
+
+  // Submit and present a frame drawn to several surfaces, such as one per
+  // window. All of the command buffers go to the queue in one vkQueueSubmit,
+  // each frame's waiting only on the image acquired from its own surface,
+  // and fence is signaled once they have all completed. If ec is true, then
+  // an error occurred during the submit.
+  void submit(gsl::span<surface_frame const> frames, VkFence fence,
+              std::error_code& ec) noexcept;
 
-private:
-  void release(surface& s) noexcept;
+  // Present every frame's image in one vkQueuePresentKHR, after flushing
+  // anything enqueued so the semaphores it waits on have been submitted. If
+  // results is not empty it must hold one VkResult per frame and receives
+  // the result for each surface, so an out of date surface can be told apart
+  // from the rest. If ec is true, then the flush failed or presenting to at
+  // least one surface did not succeed.
+  void present(gsl::span<surface_frame const> frames,
+               gsl::span<VkResult> results, std::error_code& ec) noexcept;
+
+  // Add command buffers to the graphics queue batch without submitting them,
+  // as submit_batch::add describes. Nothing reaches the device until flush.
+  void enqueue(gsl::span<VkCommandBuffer const> buffers,
+               gsl::span<VkSemaphore const> waits,
+               gsl::span<VkPipelineStageFlags const> wait_stages,
+               gsl::span<VkSemaphore const> signals, VkFence fence) noexcept;
+
+  // Add the command buffers of a frame drawn to several surfaces to the
+  // batch, as submit does, without submitting them.
+  void enqueue(gsl::span<surface_frame const> frames, VkFence fence) noexcept;
+
+  // Submit everything enqueued since the last flush. Every submit method
+  // enqueues and flushes, so work enqueued earlier is submitted first. If ec
+  // is true, then an error occurred and the enqueued work was dropped.
+  void flush(std::error_code& ec) noexcept;
+
+  // The number of vkQueueSubmit calls made so far. The difference across a
+  // frame is the number of submits in that frame.
+  uint64_t submit_count() const noexcept { return _submit_count; }
+
+  // The graphics queue timeline counts the work submitted to the queue:
+  // every flush that submits anything also signals the next value, so a
+  // value stands for everything submitted up to it. Waiting for a frame's
+  // value, or checking whether it has completed, takes the place of a fence
+  // per frame or per submit. With VK_KHR_timeline_semaphore the counter is
+  // a timeline semaphore; without it each value is tracked with a fence
+  // from a pool, which the renderer recycles itself.
+  bool timeline_semaphore() const noexcept {
+    return _timeline != VK_NULL_HANDLE;
+  }
+
+  // The value the last flush signals when its work completes.
+  uint64_t submitted_value() const noexcept { return _submitted_value; }
+
+  // The highest value whose work has completed, without waiting. If ec is
+  // true, then an error occurred and the last known value is returned.
+  uint64_t completed_value(std::error_code& ec) noexcept;
+
+  // Wait for the work of value to complete. value must not be greater than
+  // submitted_value. timeout is as for waiting on fences. If ec is true, then
+  // an error occurred or the timeout expired.
+  void wait(uint64_t value, uint64_t timeout, std::error_code& ec) noexcept;
+
+  // The number of objects waiting to be destroyed. Destroying or freeing an
+  // object the device may still be using queues it with the timeline value
+  // of the last submit that could use it, flushed or still enqueued, and
+  // flush or wait destroy it once that value has completed. The queue is not
+  // locked, so destroy and free only from the thread that submits.
+  std::size_t deferred_count() const noexcept;
+
+  // Destroy a surface and everything it owns. Unlike the other destroy
+  // methods this waits for the device, since the window system surface
+  // cannot outlive the call and its swapchain must go first.
+  void destroy(surface& s) noexcept;
 
-public:
   // Allocate a set of command buffers. If ec is true, then an error occurred
   // and the vector is invalid.
   std::vector<VkCommandBuffer>
   allocate_command_buffers(uint32_t count, std::error_code& ec) noexcept;
 
   // Submit a set of command buffers. onetime indicates that the submit should
-  // use the onetime fence and wait for the submit to complete before
-  // continuing. If ec is true, then an error occurred.
+  // wait on the timeline for the submit to complete before continuing. If ec
+  // is true, then an error occurred.
   void submit(gsl::span<VkCommandBuffer> command_buffers, bool onetime,
               std::error_code& ec) noexcept;
 
+  // Submit a set of command buffers and signal fence when they complete.
+  // Does not wait for completion. If ec is true, then an error occurred.
+  void submit(gsl::span<VkCommandBuffer> command_buffers, VkFence fence,
+              std::error_code& ec) noexcept;
+
+  // Free a set of command buffers once the submits that may use them have
+  // completed, and clear the vector.
   void free(std::vector<VkCommandBuffer>& command_buffers) noexcept;
 
   // Create a new shader from the given source code. path is expected to hold
@@ -193,6 +413,43 @@ public:
   // is true, then an error occurred and the shader is valid such that
   // shader::error_message can be called to get any compilation errors.
   shader create_shader(plat::filesystem::path const& path, shader::types type,
+                       std::error_code& ec) noexcept {
+    return create_shader(path, type, _optimization, ec);
+  }
+
+  // Create a new shader from the given source code, optimized as opt says
+  // instead of the renderer's default optimization.
+  shader create_shader(plat::filesystem::path const& path, shader::types type,
+                       shader_optimization opt, std::error_code& ec) noexcept;
+
+  // Create a new shader from already compiled SPIR-V. If ec is true, then an
+  // error occurred and the shader is invalid.
+  shader create_shader(gsl::span<uint32_t const> code,
+                       std::error_code& ec) noexcept;
+
+  // Compile GLSL source into SPIR-V with compiler, going through the SPIR-V
+  // cache if one is in use. Safe to call from multiple threads as long as
+  // each thread passes its own compiler. If ec is true, then an error
+  // occurred and error_message holds any compilation errors.
+  std::vector<uint32_t> compile(shader_compiler& compiler,
+                                gsl::span<char const> source,
+                                gsl::czstring name, shader::types type,
+                                shader_optimization opt,
+                                std::string& error_message,
+                                std::error_code& ec) noexcept;
+
+  // The optimization create_shader uses when not given one.
+  shader_optimization optimization() const noexcept { return _optimization; }
+  void optimization(shader_optimization opt) noexcept { _optimization = opt; }
+
+  // The long-lived compiler used by create_shader. Its include cache can be
+  // invalidated when an included file is known to have changed.
+  shader_compiler& compiler() noexcept { return *_compiler; }
+
+  // Look up compiled SPIR-V in directory before compiling and store newly
+  // compiled SPIR-V there. If ec is true, then an error occurred and no
+  // SPIR-V cache is used.
+  void use_spirv_cache(plat::filesystem::path directory,
                        std::error_code& ec) noexcept;
 
   void destroy(shader& s) noexcept;
@@ -215,6 +472,18 @@ public:
 
   void destroy(gsl::span<VkPipeline> pipes) noexcept;
 
+  // Replace the pipeline cache used by create_pipelines with one initialized
+  // from the data in path. A missing file is not an error and leaves an empty
+  // cache. If ec is true, then an error occurred; a file that fails the
+  // cache_blob checks also leaves the current cache in place.
+  void load_pipeline_cache(plat::filesystem::path const& path,
+                           std::error_code& ec) noexcept;
+
+  // Atomically write the contents of the pipeline cache to path. If ec is
+  // true, then an error occurred and any existing file is unchanged.
+  void save_pipeline_cache(plat::filesystem::path const& path,
+                           std::error_code& ec) noexcept;
+
   // Create a new fence. If ec is true, then an error occurred and the fence
   // is invalid.
   VkFence create_fence(bool signaled, std::error_code& ec) noexcept;
@@ -233,6 +502,29 @@ public:
 
   void destroy(VkFence fence) noexcept;
 
+  // Create a new pool of count timestamp queries. If ec is true, then an
+  // error occurred and the query pool is invalid.
+  VkQueryPool create_timestamp_query_pool(uint32_t count,
+                                          std::error_code& ec) noexcept;
+
+  // Get the results of count timestamp queries starting at first, waiting
+  // for them to become available. Multiply by timestamp_period to convert
+  // to nanoseconds. If ec is true, then an error occurred.
+  std::vector<uint64_t> get_timestamps(VkQueryPool pool, uint32_t first,
+                                       uint32_t count,
+                                       std::error_code& ec) noexcept;
+
+  void destroy(VkQueryPool pool) noexcept;
+
+  VkPhysicalDeviceProperties const& properties() const noexcept {
+    return _properties;
+  }
+
+  // The number of nanoseconds per timestamp increment.
+  float timestamp_period() const noexcept {
+    return _properties.limits.timestampPeriod;
+  }
+
   constexpr renderer() noexcept {};
   renderer(renderer const&) = delete;
   renderer(renderer&& other) noexcept;
@@ -241,16 +533,76 @@ public:
   ~renderer() noexcept;
 
 private:
+  // pipelineCacheUUID, which identifies the device and driver version.
+  cache_blob::uuid device_uuid() const noexcept;
+
+  // Take an unsignaled fence from the pool for the next timeline value,
+  // creating one if the pool is empty.
+  VkFence timeline_fence(std::error_code& ec) noexcept;
+
+  template <class T>
+  using deferred = std::vector<std::pair<uint64_t, T>>;
+
+  // Destroy object with destroy_now, immediately if every submit that could
+  // use it has completed or otherwise by queueing it on list.
+  template <class T, class Destroy>
+  void defer(deferred<T>& list, T object, Destroy destroy_now) noexcept;
+
+  // Destroy every deferred object whose value is no greater than completed.
+  void destroy_deferred(uint64_t completed) noexcept;
+
+  // Queue the swapchain, images and framebuffers of s for deferred
+  // destruction and clear them from s.
+  void release(surface& s) noexcept;
+
   VkInstance _instance{VK_NULL_HANDLE};
   VkDebugReportCallbackEXT _callback{VK_NULL_HANDLE};
 
   VkPhysicalDevice _physical{VK_NULL_HANDLE};
+  VkPhysicalDeviceProperties _properties{};
   VkDevice _device{VK_NULL_HANDLE};
 
   uint32_t _graphics_queue_family_index{UINT32_MAX};
   VkQueue _graphics_queue{VK_NULL_HANDLE};
   VkCommandPool _graphics_command_pool{VK_NULL_HANDLE};
-  VkFence _graphics_onetime_fence{VK_NULL_HANDLE};
+  submit_batch _graphics_batch{};
+  uint64_t _submit_count{0};
+
+  // Without timeline semaphores, each value not yet known to be complete
+  // has a fence, oldest first, and completed fences are reset and kept for
+  // reuse.
+  struct timeline_fences {
+    std::vector<std::pair<uint64_t, VkFence>> pending{};
+    std::vector<VkFence> free{};
+  }; // struct timeline_fences
+
+  // The graphics queue timeline, see submitted_value
+  VkSemaphore _timeline{VK_NULL_HANDLE};
+  PFN_vkGetSemaphoreCounterValueKHR _get_semaphore_counter_value{nullptr};
+  PFN_vkWaitSemaphoresKHR _wait_semaphores{nullptr};
+  uint64_t _submitted_value{0};
+  uint64_t _completed_value{0};
+  timeline_fences _timeline_fences; // {} would not be constexpr
+
+  // Objects waiting to be destroyed, see deferred_count. Within each list
+  // the values only increase.
+  struct deferred_deletions {
+    deferred<VkCommandBuffer> command_buffers{};
+    deferred<VkPipeline> pipelines{};
+    deferred<VkPipelineLayout> layouts{};
+    deferred<VkFramebuffer> framebuffers{};
+    deferred<VkImageView> image_views{};
+    deferred<VkImage> images{};
+    deferred<VkDeviceMemory> memory{};
+    deferred<VkSwapchainKHR> swapchains{};
+  }; // struct deferred_deletions
+
+  deferred_deletions _deferred; // {} would not be constexpr
+
+  gsl::unique_ptr<shader_compiler> _compiler{};
+  spirv_cache _spirv_cache{};
+  shader_optimization _optimization{};
+  VkPipelineCache _pipeline_cache{VK_NULL_HANDLE};
 }; // class renderer
 
 inline constexpr auto operator|(renderer_options a,
@@ -0,0 +1,299 @@
+#include "shader_compiler.h"
+#include <plat/file_io.h>
+#include <plat/log.h>
+#include <cstring>
+#include <iterator>
+#ifdef VKST_HAVE_SPIRV_OPT
+#include <spirv-tools/optimizer.hpp>
+#endif
+
+gsl::czstring to_string(optimization_levels level) noexcept {
+  switch (level) {
+  case optimization_levels::zero: return "zero";
+  case optimization_levels::size: return "size";
+  case optimization_levels::performance: return "performance";
+  }
+  PLAT_MARK_UNREACHABLE;
+} // to_string
+
+bool from_string(gsl::czstring name, optimization_levels& level) noexcept {
+  for (auto l : {optimization_levels::zero, optimization_levels::size,
+                 optimization_levels::performance}) {
+    if (std::strcmp(name, to_string(l)) == 0) {
+      level = l;
+      return true;
+    }
+  }
+  return false;
+} // from_string
+
+static shaderc_optimization_level
+to_shaderc_level(optimization_levels level) noexcept {
+  switch (level) {
+  case optimization_levels::zero: return shaderc_optimization_level_zero;
+  case optimization_levels::size: return shaderc_optimization_level_size;
+  case optimization_levels::performance:
+    return shaderc_optimization_level_performance;
+  }
+  PLAT_MARK_UNREACHABLE;
+} // to_shaderc_level
+
+// Run the SPIR-V optimizer's performance passes over code in place. On
+// failure code is left as compiled, which is still valid SPIR-V.
+static void spirv_opt(std::vector<uint32_t>& code,
+                      gsl::czstring name) noexcept {
+#ifdef VKST_HAVE_SPIRV_OPT
+  LOG_ENTER;
+
+  spvtools::Optimizer optimizer{SPV_ENV_VULKAN_1_0};
+  optimizer.SetMessageConsumer([name](spv_message_level_t, char const*,
+                                      spv_position_t const&,
+                                      char const* message) {
+    LOG_WARN("spirv-opt %s: %s", name, message);
+  });
+  optimizer.RegisterPerformancePasses();
+
+  std::vector<uint32_t> optimized;
+  if (optimizer.Run(code.data(), code.size(), &optimized)) {
+    code = std::move(optimized);
+  } else {
+    LOG_WARN("spirv-opt %s failed, using unoptimized SPIR-V", name);
+  }
+
+  LOG_LEAVE;
+#else
+  static_cast<void>(code);
+  static_cast<void>(name);
+#endif
+} // spirv_opt
+
+gsl::span<char const> include_cache::get(plat::filesystem::path const& path,
+                                         std::error_code& ec) noexcept {
+  auto const write_time = plat::filesystem::last_write_time(path, ec);
+  if (ec) return {};
+
+  auto& e = _entries[path.string()];
+  if (e.write_time == write_time && !e.source.empty()) {
+    _hits += 1;
+    return e.source;
+  }
+
+  _misses += 1;
+  e.source = plat::read_file(path, ec);
+  if (ec) {
+    _entries.erase(path.string());
+    return {};
+  }
+
+  e.write_time = write_time;
+  return e.source;
+} // include_cache::get
+
+void include_cache::invalidate(plat::filesystem::path const& path) noexcept {
+  _entries.erase(path.string());
+} // include_cache::invalidate
+
+// A pool of T allocated in fixed-size blocks. Allocated objects never move,
+// release pushes onto a free list and reset returns every object to the
+// pool, so all three are O(1) and blocks are reused from compile to compile.
+template <class T, std::size_t BLOCK_SIZE = 32>
+class block_pool {
+public:
+  T* allocate() noexcept {
+    if (!_free.empty()) {
+      T* t = _free.back();
+      _free.pop_back();
+      return t;
+    }
+
+    if (_used == _blocks.size() * BLOCK_SIZE) {
+      _blocks.push_back(gsl::make_unique<T[]>(BLOCK_SIZE));
+    }
+
+    T* t = &_blocks[_used / BLOCK_SIZE][_used % BLOCK_SIZE];
+    _used += 1;
+    return t;
+  }
+
+  void release(T* t) noexcept { _free.push_back(t); }
+
+  void reset() noexcept {
+    _used = 0;
+    _free.clear();
+  }
+
+private:
+  std::vector<gsl::unique_ptr<T[]>> _blocks{};
+  std::vector<T*> _free{};
+  std::size_t _used{0};
+}; // class block_pool
+
+// Resolves #include directives for shaderc. Every result handed to shaderc
+// lives in a block_pool record, so the name and content pointers stay valid
+// until the matching ReleaseInclude no matter how many more files are
+// included. Contents point directly into the include_cache. A file included
+// more than once in a compile returns the same record.
+class shader_includer : public shaderc::CompileOptions::IncluderInterface {
+public:
+  explicit shader_includer(include_cache& cache) noexcept : _cache{cache} {}
+
+  // Start a new compile. shaderc releases every include before a compile
+  // returns, so no record is in use.
+  void reset() noexcept {
+    _records.reset();
+    _by_name.clear();
+  }
+
+  shaderc_include_result* GetInclude(const char* requested_source,
+                                     shaderc_include_type type,
+                                     const char* requesting_source,
+                                     size_t /*include_depth*/) override {
+    plat::filesystem::path path{requested_source};
+    if (type == shaderc_include_type_relative) {
+      path = plat::filesystem::path{requesting_source}.parent_path() / path;
+    }
+
+    auto& existing = _by_name[path.string()];
+    if (existing) {
+      existing->refs += 1;
+      return &existing->result;
+    }
+
+    record* rec = _records.allocate();
+    rec->result.user_data = rec;
+    rec->refs = 1;
+    rec->name = path.string();
+    rec->message.clear();
+    existing = rec;
+
+    std::error_code ec;
+    if (!plat::filesystem::exists(path, ec)) {
+      // An empty source name tells shaderc the include failed
+      rec->message = "file not found";
+      set(rec->result, s_empty, rec->message);
+      return &rec->result;
+    }
+
+    auto const source = _cache.get(path, ec);
+    if (ec) {
+      rec->message = ec.message();
+      set(rec->result, s_empty, rec->message);
+    } else {
+      set(rec->result, rec->name, source);
+    }
+
+    return &rec->result;
+  } // GetInclude
+
+  void ReleaseInclude(shaderc_include_result* data) override {
+    auto rec = static_cast<record*>(data->user_data);
+    if (--rec->refs > 0) return;
+
+    _by_name.erase(rec->name);
+    _records.release(rec);
+  } // ReleaseInclude
+
+private:
+  struct record {
+    shaderc_include_result result{};
+    uint32_t refs{0};
+    std::string name{};
+    std::string message{}; // content when the include failed
+  }; // struct record
+
+  static void set(shaderc_include_result& result, std::string const& name,
+                  gsl::span<char const> content) noexcept {
+    result.source_name = name.data();
+    result.source_name_length = name.size();
+    result.content = content.data();
+    result.content_length = content.size();
+  } // set
+
+  static std::string const s_empty;
+
+  include_cache& _cache;
+  block_pool<record> _records{};
+  std::unordered_map<std::string, record*> _by_name{};
+}; // class shader_includer
+
+std::string const shader_includer::s_empty{};
+
+shader_compiler::shader_compiler() noexcept {
+  _options.SetOptimizationLevel(to_shaderc_level(_level));
+
+  auto includer = gsl::make_unique<shader_includer>(_includes);
+  _includer = includer.get();
+  _options.SetIncluder(std::move(includer));
+} // shader_compiler::shader_compiler
+
+std::vector<uint32_t>
+shader_compiler::compile(gsl::span<char const> source, gsl::czstring name,
+                         shaderc_shader_kind kind, shader_optimization opt,
+                         std::string& error_message,
+                         std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+  error_message.clear();
+
+  if (opt.level != _level) {
+    _level = opt.level;
+    _options.SetOptimizationLevel(to_shaderc_level(_level));
+  }
+
+  _includer->reset();
+  auto spv = _compiler.CompileGlslToSpv(source.data(), source.size(), kind,
+                                        name, "main", _options);
+  if (spv.GetCompilationStatus() != shaderc_compilation_status_success) {
+    ec.assign(spv.GetCompilationStatus(), vk::shaderc_result_category());
+    error_message = spv.GetErrorMessage();
+    return {};
+  }
+
+  std::vector<uint32_t> code;
+  std::copy(spv.begin(), spv.end(), std::back_inserter(code));
+  if (opt.spirv_opt) spirv_opt(code, name);
+
+  LOG_LEAVE;
+  return code;
+} // shader_compiler::compile
+
+std::vector<uint32_t>
+shader_compiler::compile(plat::filesystem::path const& path,
+                         shaderc_shader_kind kind, shader_optimization opt,
+                         std::string& error_message,
+                         std::error_code& ec) noexcept {
+  // Read rather than map, so the file can be rewritten during the compile
+  auto const source = plat::read_file(path, ec);
+  if (ec) return {};
+  return compile(source, path.string().c_str(), kind, opt, error_message, ec);
+} // shader_compiler::compile
+
+bool shader_compiler::has_spirv_opt() noexcept {
+#ifdef VKST_HAVE_SPIRV_OPT
+  return true;
+#else
+  return false;
+#endif
+} // shader_compiler::has_spirv_opt
+
+std::string shader_compiler::preprocess(gsl::span<char const> source,
+                                        gsl::czstring name,
+                                        shaderc_shader_kind kind,
+                                        std::string& error_message,
+                                        std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+  error_message.clear();
+
+  _includer->reset();
+  auto pre = _compiler.PreprocessGlsl(source.data(), source.size(), kind, name,
+                                      _options);
+  if (pre.GetCompilationStatus() != shaderc_compilation_status_success) {
+    ec.assign(pre.GetCompilationStatus(), vk::shaderc_result_category());
+    error_message = pre.GetErrorMessage();
+    return {};
+  }
+
+  LOG_LEAVE;
+  return {pre.begin(), pre.end()};
+} // shader_compiler::preprocess
@@ -0,0 +1,110 @@
+#ifndef VKST_SHADER_COMPILER_H
+#define VKST_SHADER_COMPILER_H
+
+#include <plat/filesystem.h>
+#include <vk/result.h>
+#include <gsl.h>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+// The sources of included files, kept across compiles so an unchanged file is
+// not read again. An entry is reread when the last write time of its file
+// changes, or after it is invalidated, e.g. from an fs_notify callback. The
+// contents are copied rather than mapped: the files are edited while st
+// runs, and a mapping would show a rewrite part way through a compile, or
+// fault if the file were truncated.
+class include_cache {
+public:
+  // Get the source of path, reading the file only if it is not cached or is
+  // stale. The bytes are valid until the entry is next refreshed or
+  // invalidated. If ec is true, then an error occurred and the result is
+  // empty.
+  gsl::span<char const> get(plat::filesystem::path const& path,
+                            std::error_code& ec) noexcept;
+
+  void invalidate(plat::filesystem::path const& path) noexcept;
+  void clear() noexcept { _entries.clear(); }
+
+  uint64_t hits() const noexcept { return _hits; }
+  uint64_t misses() const noexcept { return _misses; }
+
+private:
+  struct entry {
+    plat::filesystem::file_time_type write_time{};
+    std::vector<char> source{};
+  }; // struct entry
+
+  std::unordered_map<std::string, entry> _entries{};
+  uint64_t _hits{0};
+  uint64_t _misses{0};
+}; // class include_cache
+
+class shader_includer;
+
+// How hard shaderc optimizes the SPIR-V it generates. zero compiles fastest,
+// for live editing; performance favors fragment throughput, for final runs.
+enum class optimization_levels { zero, size, performance };
+
+gsl::czstring to_string(optimization_levels level) noexcept;
+
+// Parse the result of to_string. Returns false if name is not a level.
+bool from_string(gsl::czstring name, optimization_levels& level) noexcept;
+
+// The optimization to apply to one shader.
+struct shader_optimization {
+  optimization_levels level{optimization_levels::size};
+  // Also run the SPIR-V optimizer's performance passes over the compiled
+  // code. Ignored unless built with SPIRV-Tools, see has_spirv_opt.
+  bool spirv_opt{false};
+}; // struct shader_optimization
+
+// Compiles GLSL source to SPIR-V with shaderc. The shaderc compiler, the
+// compile options and the include cache are created once and reused by every
+// compile, which matters when the same shader is recompiled on every edit. A
+// shader_compiler is not thread-safe: use one per thread when compiling in
+// parallel.
+class shader_compiler {
+public:
+  shader_compiler() noexcept;
+
+  // Compile source, named name for error messages and relative includes,
+  // into SPIR-V optimized as opt says. If ec is true, then an error occurred
+  // and error_message holds any compilation errors.
+  std::vector<uint32_t> compile(gsl::span<char const> source,
+                                gsl::czstring name, shaderc_shader_kind kind,
+                                shader_optimization opt,
+                                std::string& error_message,
+                                std::error_code& ec) noexcept;
+
+  // Read path and compile it.
+  std::vector<uint32_t> compile(plat::filesystem::path const& path,
+                                shaderc_shader_kind kind,
+                                shader_optimization opt,
+                                std::string& error_message,
+                                std::error_code& ec) noexcept;
+
+  // Run only the preprocessor over source, expanding all includes. The
+  // result identifies the compiled output, so it is used to key caches.
+  std::string preprocess(gsl::span<char const> source, gsl::czstring name,
+                         shaderc_shader_kind kind, std::string& error_message,
+                         std::error_code& ec) noexcept;
+
+  include_cache& includes() noexcept { return _includes; }
+
+  // True if built with SPIRV-Tools, so shader_optimization::spirv_opt runs.
+  static bool has_spirv_opt() noexcept;
+
+  shader_compiler(shader_compiler const&) = delete;
+  shader_compiler& operator=(shader_compiler const&) = delete;
+
+private:
+  include_cache _includes{};
+  shaderc::Compiler _compiler{};
+  shaderc::CompileOptions _options{};
+  shader_includer* _includer{nullptr}; // owned by _options
+  optimization_levels _level{optimization_levels::size};
+}; // class shader_compiler
+
+#endif // VKST_SHADER_COMPILER_H
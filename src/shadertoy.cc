@@ -0,0 +1,247 @@
+#include "shadertoy.h"
+#include <plat/log.h>
+#include <algorithm>
+#include <array>
+#include <functional>
+
+VkPipelineLayout create_shadertoy_pipeline_layout(renderer& r,
+                                                  std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  VkPushConstantRange push_constant_range = {};
+  push_constant_range.stageFlags =
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  push_constant_range.offset = 0;
+  push_constant_range.size = sizeof(push_constant_uniform_block);
+
+  auto layout = r.create_pipeline_layout({}, push_constant_range, ec);
+  if (ec) return VK_NULL_HANDLE;
+
+  LOG_LEAVE;
+  return layout;
+} // create_shadertoy_pipeline_layout
+
+std::size_t shadertoy_variant::hasher::
+operator()(shadertoy_variant const& v) const noexcept {
+  std::size_t hash = v.constants.hash();
+  hash ^= std::hash<VkRenderPass>{}(v.render_pass) +
+          0x9e3779b9 + (hash << 6) + (hash >> 2);
+  hash ^= static_cast<std::size_t>(v.samples) + 0x9e3779b9 + (hash << 6) +
+          (hash >> 2);
+  return hash;
+} // shadertoy_variant::hasher::operator()
+
+std::vector<VkPipeline>
+create_shadertoy_pipelines(renderer& r, VkShaderModule vshader,
+                           VkShaderModule fshader, VkPipelineLayout layout,
+                           gsl::span<shadertoy_variant const> variants,
+                           std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  if (variants.empty()) return {};
+
+  // There are no binding or attribute descriptions for the vertex input as
+  // the fsq.vert vertex shader just uses gl_VertexIndex to create a triangle
+  VkPipelineVertexInputStateCreateInfo vertex_input = {};
+  vertex_input.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
+  input_assembly.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  // The viewport and scissor are specified later as dynamic states
+  VkPipelineViewportStateCreateInfo viewport = {};
+  viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewport.viewportCount = 1;
+  viewport.pViewports = nullptr;
+  viewport.scissorCount = 1;
+  viewport.pScissors = nullptr;
+
+  // fsq.vert outputs the vertices in clock-wise order
+  VkPipelineRasterizationStateCreateInfo rasterization = {};
+  rasterization.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterization.cullMode = VK_CULL_MODE_FRONT_BIT;
+  rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  rasterization.lineWidth = 1.f;
+
+  VkPipelineDepthStencilStateCreateInfo depth_stencil = {};
+  depth_stencil.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depth_stencil.depthWriteEnable = VK_TRUE;
+
+  VkPipelineColorBlendAttachmentState color_blend_attachment = {};
+  color_blend_attachment.colorWriteMask =
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+    VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  VkPipelineColorBlendStateCreateInfo color_blend = {};
+  color_blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  color_blend.attachmentCount = 1;
+  color_blend.pAttachments = &color_blend_attachment;
+
+  std::array<VkDynamicState, 2> dynamic_states = {
+    {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR}};
+
+  VkPipelineDynamicStateCreateInfo dynamic = {};
+  dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamic.dynamicStateCount = gsl::narrow_cast<uint32_t>(dynamic_states.size());
+  dynamic.pDynamicStates = dynamic_states.data();
+
+  // Everything above is shared; the shader stages, with their specialization
+  // info, and the multisample state differ per variant. Map entries for
+  // constant ids a shader does not declare are ignored, so both stages of a
+  // variant share one specialization info.
+  std::size_t const count = variants.size();
+  std::vector<VkSpecializationInfo> specializations(count);
+  std::vector<std::array<VkPipelineShaderStageCreateInfo, 2>> stages(count);
+  std::vector<VkPipelineMultisampleStateCreateInfo> multisamples(count);
+  std::vector<VkGraphicsPipelineCreateInfo> cinfos(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    auto&& variant = variants[i];
+
+    specializations[i] = variant.constants.info();
+    VkSpecializationInfo const* const specialization_info =
+      variant.constants.empty() ? nullptr : &specializations[i];
+
+    stages[i] = {{
+      {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
+       VK_SHADER_STAGE_VERTEX_BIT, vshader, "main", specialization_info},
+      {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
+       VK_SHADER_STAGE_FRAGMENT_BIT, fshader, "main", specialization_info},
+    }};
+
+    auto& multisample = multisamples[i];
+    multisample = {};
+    multisample.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = variant.samples;
+    multisample.minSampleShading = 1.f;
+
+    auto& cinfo = cinfos[i];
+    cinfo = {};
+    cinfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    cinfo.stageCount = gsl::narrow_cast<uint32_t>(stages[i].size());
+    cinfo.pStages = stages[i].data();
+    cinfo.pVertexInputState = &vertex_input;
+    cinfo.pInputAssemblyState = &input_assembly;
+    cinfo.pViewportState = &viewport;
+    cinfo.pRasterizationState = &rasterization;
+    cinfo.pMultisampleState = &multisample;
+    cinfo.pDepthStencilState = &depth_stencil;
+    cinfo.pColorBlendState = &color_blend;
+    cinfo.pDynamicState = &dynamic;
+    cinfo.layout = layout;
+    cinfo.renderPass = variant.render_pass;
+    cinfo.subpass = 0;
+    cinfo.basePipelineHandle = VK_NULL_HANDLE;
+    cinfo.basePipelineIndex = -1;
+
+    // The base pipeline must come before its derivatives in the batch
+    if (count > 1 && i == 0) {
+      cinfo.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+    } else if (count > 1) {
+      cinfo.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+      cinfo.basePipelineIndex = 0;
+    }
+  }
+
+  auto pipelines = r.create_pipelines(cinfos, ec);
+  if (ec) {
+    // Some pipelines may have been created before the failure
+    pipelines.erase(
+      std::remove(pipelines.begin(), pipelines.end(), VK_NULL_HANDLE),
+      pipelines.end());
+    r.destroy(pipelines);
+    return {};
+  }
+
+  LOG_LEAVE;
+  return pipelines;
+} // create_shadertoy_pipelines
+
+VkPipeline create_shadertoy_pipeline(renderer& r, surface const& s,
+                                     VkShaderModule vshader,
+                                     VkShaderModule fshader,
+                                     VkPipelineLayout layout,
+                                     specialization_constants const& constants,
+                                     std::error_code& ec) noexcept {
+  shadertoy_variant const variant{s.render_pass(), s.samples(), constants};
+  auto pipelines = create_shadertoy_pipelines(r, vshader, fshader, layout,
+                                              {&variant, 1}, ec);
+  return ec ? VK_NULL_HANDLE : pipelines[0];
+} // create_shadertoy_pipeline
+
+void shadertoy_pipelines::create(renderer& r,
+                                 gsl::span<shadertoy_variant const> variants,
+                                 std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  std::vector<shadertoy_variant> missing;
+  for (auto&& variant : variants) {
+    if (_variants.count(variant) > 0) continue;
+    if (std::find(missing.begin(), missing.end(), variant) != missing.end()) {
+      continue;
+    }
+    missing.push_back(variant);
+  }
+  if (missing.empty()) return;
+
+  auto pipelines = create_shadertoy_pipelines(r, _vshader, _fshader, _layout,
+                                              missing, ec);
+  if (ec) return;
+
+  for (std::size_t i = 0; i < missing.size(); ++i) {
+    _variants.emplace(std::move(missing[i]), pipelines[i]);
+  }
+
+  LOG_LEAVE;
+} // shadertoy_pipelines::create
+
+VkPipeline shadertoy_pipelines::get(renderer& r,
+                                    shadertoy_variant const& variant,
+                                    std::error_code& ec) noexcept {
+  ec.clear();
+
+  auto iter = _variants.find(variant);
+  if (iter != _variants.end()) return iter->second;
+
+  create(r, {&variant, 1}, ec);
+  if (ec) return VK_NULL_HANDLE;
+
+  return _variants.find(variant)->second;
+} // shadertoy_pipelines::get
+
+void shadertoy_pipelines::destroy(renderer& r) noexcept {
+  for (auto&& variant : _variants) r.destroy(variant.second);
+  _variants.clear();
+} // shadertoy_pipelines::destroy
+
+shadertoy_pipelines::shadertoy_pipelines(shadertoy_pipelines&& other) noexcept
+: _vshader{other._vshader}
+, _fshader{other._fshader}
+, _layout{other._layout}
+, _variants{std::move(other._variants)} {
+  other._variants.clear();
+} // shadertoy_pipelines::shadertoy_pipelines
+
+shadertoy_pipelines& shadertoy_pipelines::
+operator=(shadertoy_pipelines&& rhs) noexcept {
+  if (this == &rhs) return *this;
+
+  _vshader = rhs._vshader;
+  _fshader = rhs._fshader;
+  _layout = rhs._layout;
+  _variants = std::move(rhs._variants);
+
+  rhs._variants.clear();
+
+  return *this;
+} // shadertoy_pipelines::operator=
@@ -0,0 +1,142 @@
+#ifndef VKST_SHADERTOY_H
+#define VKST_SHADERTOY_H
+
+#include "renderer.h"
+#include <plat/core.h>
+PLAT_PUSH_WARNING
+PLAT_MSVC_DISABLE_WARNING(4201)
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+PLAT_POP_WARNING
+#include <unordered_map>
+
+// These are the shader uniforms.
+// Currently the uniforms update at different rates:
+//   - iMouse only on input
+//   - iTime, iTimeDelta, iFrameRate, iFrame each frame
+//   - iResolution only on resize
+// So they should probably be broken out into different sets.
+struct push_constant_uniform_block {
+  glm::vec4 iMouse{0.f, 0.f, 0.f, 0.f};
+  float iTime{0.f};
+  float iTimeDelta{0.f};
+  float iFrameRate{0.f};
+  float iFrame{0};
+  glm::vec3 iResolution{0.f, 0.f, 0.f};
+  float padding0;
+};
+
+// Create a pipeline layout with a single push constant range holding a
+// push_constant_uniform_block. If ec is true, then an error occurred and the
+// pipeline layout is invalid.
+VkPipelineLayout create_shadertoy_pipeline_layout(renderer& r,
+                                                  std::error_code& ec) noexcept;
+
+// The specialization constants declared by shadertoy.frag. Shaders read them
+// as iQuality and iAATaps; setting them selects a pipeline variant without
+// recompiling.
+enum class shadertoy_constants : uint32_t {
+  quality = 0, // general quality level, e.g. raymarch steps
+  aa_taps = 1, // antialiasing taps per pixel
+}; // enum class shadertoy_constants
+
+// One pipeline for create_shadertoy_pipelines: the render pass and sample
+// count it draws into and the values of its specialization constants. Render
+// passes from surfaces with the same formats and sample count are compatible,
+// so a variant can be used with any of them.
+struct shadertoy_variant {
+  VkRenderPass render_pass{VK_NULL_HANDLE};
+  VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+  specialization_constants constants{};
+
+  bool operator==(shadertoy_variant const& other) const noexcept {
+    return render_pass == other.render_pass && samples == other.samples &&
+           constants == other.constants;
+  }
+
+  struct hasher {
+    std::size_t operator()(shadertoy_variant const& v) const noexcept;
+  }; // struct hasher
+}; // struct shadertoy_variant
+
+// Create a pipeline for every variant, drawing a full-screen triangle with
+// vshader and shading it with fshader, in one vkCreateGraphicsPipelines call.
+// With more than one variant the first is created to allow derivatives and
+// the rest derive from it, so the driver can share work between them. If ec
+// is true, then an error occurred and no pipelines are returned.
+std::vector<VkPipeline>
+create_shadertoy_pipelines(renderer& r, VkShaderModule vshader,
+                           VkShaderModule fshader, VkPipelineLayout layout,
+                           gsl::span<shadertoy_variant const> variants,
+                           std::error_code& ec) noexcept;
+
+// Create a pipeline that draws a full-screen triangle with vshader and shades
+// it with fshader into the render pass of s, with constants specializing
+// both shaders. If ec is true, then an error occurred and the pipeline is
+// invalid.
+VkPipeline create_shadertoy_pipeline(renderer& r, surface const& s,
+                                     VkShaderModule vshader,
+                                     VkShaderModule fshader,
+                                     VkPipelineLayout layout,
+                                     specialization_constants const& constants,
+                                     std::error_code& ec) noexcept;
+
+inline VkPipeline create_shadertoy_pipeline(renderer& r, surface const& s,
+                                            VkShaderModule vshader,
+                                            VkShaderModule fshader,
+                                            VkPipelineLayout layout,
+                                            std::error_code& ec) noexcept {
+  return create_shadertoy_pipeline(r, s, vshader, fshader, layout, {}, ec);
+}
+
+// The variants of one ShaderToy pipeline, all created from the same shader
+// modules. A variant is created the first time it is asked for, or up front
+// in a batch with create, and reused after, so switching between variants
+// costs a lookup rather than a GLSL recompile or a driver compile. The
+// shaders and layout are not owned.
+class shadertoy_pipelines {
+public:
+  shadertoy_pipelines(VkShaderModule vshader, VkShaderModule fshader,
+                      VkPipelineLayout layout) noexcept
+  : _vshader{vshader}
+  , _fshader{fshader}
+  , _layout{layout} {}
+
+  // Create every variant not already created, in one batch. If ec is true,
+  // then an error occurred and none of them were created.
+  void create(renderer& r, gsl::span<shadertoy_variant const> variants,
+              std::error_code& ec) noexcept;
+
+  // Get a variant, creating it if needed. If ec is true, then an error
+  // occurred and the pipeline is invalid.
+  VkPipeline get(renderer& r, shadertoy_variant const& variant,
+                 std::error_code& ec) noexcept;
+
+  // Get the variant for constants in the render pass of s.
+  VkPipeline get(renderer& r, surface const& s,
+                 specialization_constants const& constants,
+                 std::error_code& ec) noexcept {
+    return get(r, {s.render_pass(), s.samples(), constants}, ec);
+  }
+
+  std::size_t size() const noexcept { return _variants.size(); }
+
+  // Destroy every variant.
+  void destroy(renderer& r) noexcept;
+
+  shadertoy_pipelines() noexcept = default;
+  shadertoy_pipelines(shadertoy_pipelines const&) = delete;
+  shadertoy_pipelines(shadertoy_pipelines&& other) noexcept;
+  shadertoy_pipelines& operator=(shadertoy_pipelines const&) = delete;
+  shadertoy_pipelines& operator=(shadertoy_pipelines&& rhs) noexcept;
+  ~shadertoy_pipelines() noexcept = default;
+
+private:
+  VkShaderModule _vshader{VK_NULL_HANDLE};
+  VkShaderModule _fshader{VK_NULL_HANDLE};
+  VkPipelineLayout _layout{VK_NULL_HANDLE};
+  std::unordered_map<shadertoy_variant, VkPipeline, shadertoy_variant::hasher>
+    _variants{};
+}; // class shadertoy_pipelines
+
+#endif // VKST_SHADERTOY_H
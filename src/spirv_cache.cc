@@ -0,0 +1,81 @@
+#include "spirv_cache.h"
+#include "cache_blob.h"
+#include <plat/log.h>
+#include <plat/mapped_file.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+spirv_cache spirv_cache::open(plat::filesystem::path directory,
+                              std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  spirv_cache cache;
+  plat::filesystem::create_directories(directory, ec);
+  if (ec) return cache;
+
+  cache._directory = std::move(directory);
+
+  LOG_LEAVE;
+  return cache;
+} // spirv_cache::open
+
+// 64-bit FNV-1a
+uint64_t spirv_cache::key(gsl::span<char const> text, uint32_t kind,
+                          uint32_t options) noexcept {
+  uint64_t hash = UINT64_C(14695981039346656037);
+  auto const mix = [&hash](unsigned char byte) {
+    hash ^= byte;
+    hash *= UINT64_C(1099511628211);
+  };
+
+  for (auto&& c : text) mix(static_cast<unsigned char>(c));
+  for (int i = 0; i < 4; ++i) mix(static_cast<unsigned char>(kind >> (i * 8)));
+  for (int i = 0; i < 4; ++i) {
+    mix(static_cast<unsigned char>(options >> (i * 8)));
+  }
+
+  return hash;
+} // spirv_cache::key
+
+bool spirv_cache::load(uint64_t key, std::vector<uint32_t>& code) const
+  noexcept {
+  LOG_ENTER;
+
+  std::error_code ec;
+  auto const file = plat::mapped_file::open(path(key), ec);
+  if (ec) return false;
+
+  // SPIR-V does not depend on the device, so entries have no device UUID
+  auto const bytes = cache_blob::contents(file.bytes(), cache_blob::uuid{}, ec);
+  if (ec) {
+    LOG_WARN("ignoring invalid SPIR-V cache entry %s: %s",
+             path(key).string().c_str(), ec.message().c_str());
+    return false;
+  }
+  if (bytes.empty() || bytes.size() % sizeof(uint32_t) != 0) return false;
+
+  code.resize(bytes.size() / sizeof(uint32_t));
+  std::memcpy(code.data(), bytes.data(), bytes.size());
+
+  LOG_LEAVE;
+  return true;
+} // spirv_cache::load
+
+void spirv_cache::store(uint64_t key, gsl::span<uint32_t const> code,
+                        std::error_code& ec) const noexcept {
+  LOG_ENTER;
+
+  auto const bytes = reinterpret_cast<char const*>(code.data());
+  cache_blob::write(path(key), cache_blob::uuid{},
+                    {bytes, bytes + code.size() * sizeof(uint32_t)}, ec);
+
+  LOG_LEAVE;
+} // spirv_cache::store
+
+plat::filesystem::path spirv_cache::path(uint64_t key) const noexcept {
+  char name[21];
+  std::snprintf(name, sizeof(name), "%016" PRIx64 ".spv", key);
+  return _directory / name;
+} // spirv_cache::path
@@ -0,0 +1,48 @@
+#ifndef VKST_SPIRV_CACHE_H
+#define VKST_SPIRV_CACHE_H
+
+#include <plat/filesystem.h>
+#include <gsl.h>
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+// A directory of compiled SPIR-V, one file per shader, named by a hash of the
+// preprocessed source, shader kind and compile options. Different keys are
+// different files, so one cache can be shared by threads compiling different
+// shaders. Each file is a cache_blob, so a damaged entry is just recompiled.
+class spirv_cache {
+public:
+  // Open, creating if needed, the cache in directory. If ec is true, then an
+  // error occurred and the cache is invalid.
+  static spirv_cache open(plat::filesystem::path directory,
+                          std::error_code& ec) noexcept;
+
+  // Hash preprocessed source text, shader kind and options into a cache key.
+  // options holds anything else that changes the compiled code, such as the
+  // optimization level.
+  static uint64_t key(gsl::span<char const> text, uint32_t kind,
+                      uint32_t options) noexcept;
+
+  // Load the SPIR-V stored under key. Returns false if there is none.
+  bool load(uint64_t key, std::vector<uint32_t>& code) const noexcept;
+
+  // Store SPIR-V under key. If ec is true, then an error occurred.
+  void store(uint64_t key, gsl::span<uint32_t const> code,
+             std::error_code& ec) const noexcept;
+
+  plat::filesystem::path const& directory() const noexcept {
+    return _directory;
+  }
+
+  explicit operator bool() const noexcept { return !_directory.empty(); }
+
+  spirv_cache() noexcept = default;
+
+private:
+  plat::filesystem::path path(uint64_t key) const noexcept;
+
+  plat::filesystem::path _directory{};
+}; // class spirv_cache
+
+#endif // VKST_SPIRV_CACHE_H
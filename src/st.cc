@@ -1,70 +1,147 @@
 // Vulkan-based ShaderToy Example
 
 #include <plat/core.h>
+#include <plat/file_io.h>
+#include <plat/frame_clock.h>
+#include <plat/frame_pacer.h>
+#include <plat/frame_stats.h>
+#include <plat/frame_trace.h>
 #include <plat/fs_notify.h>
 #include <plat/log.h>
+#include <plat/thread_pool.h>
 #include "renderer.h"
-PLAT_PUSH_WARNING
-PLAT_MSVC_DISABLE_WARNING(4201)
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/glm.hpp>
-PLAT_POP_WARNING
+#include "shadertoy.h"
+#include <algorithm>
 #include <array>
+#include <cctype>
 #include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdio>
+#include <mutex>
 #if TURF_TARGET_WIN32
 #include <shellapi.h>
 #endif
 
 static bool s_igpu{false}; // force integrated gpu
+static bool s_timeline{true}; // use timeline semaphores when supported
+static float s_fixed_step_rate{0.f}; // fixed-step clock rate; 0 is realtime
+static float s_fps{0.f}; // frame rate limit; 0 is unlimited
+static plat::filesystem::path s_record_path{}; // record the uniform stream
+static plat::filesystem::path s_replay_path{}; // replay a recorded stream
+static plat::filesystem::path s_stats_path{}; // write frame stats to a file
+static float s_stats_interval{5.f}; // seconds between frame stats reports
+static plat::filesystem::path s_trace_path{}; // write a Chrome trace on exit
+static plat::filesystem::path s_cache_path{PROJECT_DIR "/cache"}; // or empty
+static plat::filesystem::path s_precompile_path{}; // batch compile directory
+static uint32_t s_precompile_threads{0}; // 0 is one per hardware thread
+static shader_optimization s_optimization{}; // how shaders compile
+static bool s_tiered{true}; // rebuild unoptimized first, optimize after
+static int32_t s_quality_levels{4}; // iQuality variants created up front
+static bool s_idle{true}; // sleep while the picture cannot change
+static uint32_t s_windows{1}; // windows showing the shader
 static renderer s_renderer;
-static wsi::window s_window;
-static surface s_surface;
 
-// s_command_buffers has one recorded command buffer
-// for each image in the surface swapchain
-static std::vector<VkCommandBuffer> s_command_buffers;
+// A window and everything needed to draw into it. s_views[0] is the main
+// window: input is read from it and its size is iResolution. Every other
+// window shows the same shader at its own resolution. All of the windows are
+// drawn with one submit and presented with one present each frame.
+struct view {
+  wsi::window window{};
+  surface surf{};
+
+  // One recorded command buffer for each image in the surface swapchain
+  std::vector<VkCommandBuffer> command_buffers{};
+
+  // One command buffer to update push constants for each frame in flight
+  std::vector<VkCommandBuffer> update_push_constants_command_buffers{};
+
+  VkPipeline pipeline{VK_NULL_HANDLE}; // from s_pipelines for s_constants
+  glm::vec3 resolution{};
+  uint32_t image_index{0}; // acquired for the frame being drawn
+  std::array<VkCommandBuffer, 2> submitted{}; // for the frame being drawn
+  bool resize{false};
+}; // struct view
+
+static std::vector<view> s_views;
 
 static std::array<VkClearValue, 3> s_clear_values;
 
 static shader s_vshader, s_fshader;
 static VkPipelineLayout s_layout;
-static VkPipeline s_pipeline;
-static bool s_resize{false};
+static shadertoy_pipelines s_pipelines; // one per set of s_constants values
+static specialization_constants s_constants;
+static bool s_resize{false}; // some view needs resizing
 static bool s_rebuild{false};
 
-// s_update_push_constants_{command_buffers, fences} have one command buffer
-// or fence for each image in the surface swapchain to update push constants
-static std::vector<VkCommandBuffer> s_update_push_constants_command_buffers;
-static std::vector<VkFence> s_update_push_constants_fences;
+// The renderer timeline value of the last frame drawn in each frame slot;
+// once it completes the slot's command buffers in every view can be reused.
+// s_frame_slot is the next frame's.
+static std::vector<uint64_t> s_frame_values;
+static std::size_t s_frame_slot{0};
 
 // These are the shader uniforms.
-// Currently the uniforms update at different rates:
-//   - iMouse only on input
-//   - iTime, iTimeDelta, iFrameRate, iFrame each frame
-//   - iResolution only on resize
-// So they should probably be broken out into different sets.
-struct push_constant_uniform_block {
-  glm::vec4 iMouse{0.f, 0.f, 0.f, 0.f};
-  float iTime{0.f};
-  float iTimeDelta{0.f};
-  float iFrameRate{0.f};
-  float iFrame{0};
-  glm::vec3 iResolution{0.f, 0.f, 0.f};
-  float padding0;
-} s_shader_push_constants;
-
-// Create a full pipeline with a full-screen quad vertex shader
-static std::tuple<shader, shader, VkPipelineLayout, VkPipeline>
-create_pipeline(std::error_code& ec) noexcept {
+static push_constant_uniform_block s_shader_push_constants;
+
+// Frame timing histograms, reported every s_stats_interval seconds
+static plat::frame_stats s_frame_stats;
+using stats_clock = std::chrono::steady_clock;
+
+// Tiered compilation: rebuild() builds the pipeline from a fast, unoptimized
+// compile and queues a compile at s_optimization on s_background. The main
+// loop swaps in a pipeline built from the optimized code once it is ready,
+// unless another rebuild has started since.
+struct optimized_shader {
+  std::mutex mutex{};
+  uint64_t generation{0}; // of the latest rebuild
+  bool pending{false}; // queued and not yet finished
+  bool ready{false};
+  std::vector<uint32_t> code{};
+  stats_clock::time_point start{};
+}; // struct optimized_shader
+
+static optimized_shader s_optimized;
+static gsl::unique_ptr<plat::thread_pool> s_background{};
+static gsl::unique_ptr<shader_compiler> s_background_compiler{};
+
+// One frame of a recorded run: the clock time for the frame and the full set
+// of uniforms, including iMouse, that were pushed for it.
+struct frame_record {
+  int64_t elapsed_ns;
+  push_constant_uniform_block uniforms;
+};
+
+// The pipeline variants to create whenever the shaders are rebuilt: the one
+// for s_constants and one for each iQuality from 1 to s_quality_levels with
+// the other constants unchanged, so stepping iQuality only binds a different
+// pipeline.
+static std::vector<shadertoy_variant> prebuilt_variants() {
+  auto const quality = static_cast<uint32_t>(shadertoy_constants::quality);
+
+  shadertoy_variant const current{s_views[0].surf.render_pass(),
+                                  s_views[0].surf.samples(), s_constants};
+
+  std::vector<shadertoy_variant> variants{current};
+  for (int32_t level = 1; level <= s_quality_levels; ++level) {
+    if (level == s_constants.get(quality, 1)) continue;
+    variants.push_back(current);
+    variants.back().constants.set(quality, level);
+  }
+
+  return variants;
+} // prebuilt_variants
+
+// Create a full pipeline with a full-screen quad vertex shader and the
+// fragment shader compiled as fopt says. The returned variants hold the
+// pipelines for prebuilt_variants.
+static std::tuple<shader, shader, VkPipelineLayout, shadertoy_pipelines>
+create_pipeline(shader_optimization fopt, std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
 
   shader vshader{};
   shader fshader{};
   VkPipelineLayout layout{VK_NULL_HANDLE};
-  std::vector<VkPipeline> pipelines{};
 
   vshader = s_renderer.create_shader(
     PROJECT_DIR "/assets/shaders/fsq.vert", shader::types::vertex, ec);
@@ -74,121 +151,37 @@ create_pipeline(std::error_code& ec) noexcept {
       ec.message().c_str(), (vshader.error_message().empty() ? "" : "\n"),
       vshader.error_message().c_str());
     return std::make_tuple(std::move(vshader), std::move(fshader), layout,
-                           VkPipeline{VK_NULL_HANDLE});
+                           shadertoy_pipelines{});
   }
 
   fshader = s_renderer.create_shader(
-    PROJECT_DIR "/assets/shaders/shadertoy.frag", shader::types::fragment, ec);
+    PROJECT_DIR "/assets/shaders/shadertoy.frag", shader::types::fragment,
+    fopt, ec);
   if (ec) {
     LOG_FATAL("creating shader " PROJECT_DIR
               "/assets/shaders/shadertoy.frag failed: %s%s%s",
               ec.message().c_str(), (fshader.error_message().empty() ? "" : "\n"),
               fshader.error_message().c_str());
     return std::make_tuple(std::move(vshader), std::move(fshader), layout,
-                           VkPipeline{VK_NULL_HANDLE});
-  }
-
-  std::array<VkPipelineShaderStageCreateInfo, 2> stages{{
-    {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-     VK_SHADER_STAGE_VERTEX_BIT, vshader, "main", nullptr},
-    {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-     VK_SHADER_STAGE_FRAGMENT_BIT, fshader, "main", nullptr},
-  }};
-
-
-  // There are no binding or attribute descriptions for the vertex input as
-  // the fsq.vert vertex shader just uses gl_VertexIndex to create a triangle
-  VkPipelineVertexInputStateCreateInfo vertex_input = {};
-  vertex_input.sType =
-    VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-  VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
-  input_assembly.sType =
-    VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-  // The viewport and scissor are specified later as dynamic states
-  VkPipelineViewportStateCreateInfo viewport = {};
-  viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewport.viewportCount = 1;
-  viewport.pViewports = nullptr;
-  viewport.scissorCount = 1;
-  viewport.pScissors = nullptr;
-
-  // fsq.vert outputs the vertices in clock-wise order
-  VkPipelineRasterizationStateCreateInfo rasterization = {};
-  rasterization.sType =
-    VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterization.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterization.cullMode = VK_CULL_MODE_FRONT_BIT;
-  rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-  rasterization.lineWidth = 1.f;
-
-  VkPipelineMultisampleStateCreateInfo multisample = {};
-  multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisample.rasterizationSamples = s_surface.samples();
-  multisample.minSampleShading = 1.f;
-
-  VkPipelineDepthStencilStateCreateInfo depth_stencil = {};
-  depth_stencil.sType =
-    VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depth_stencil.depthWriteEnable = VK_TRUE;
-
-  VkPipelineColorBlendAttachmentState color_blend_attachment = {};
-  color_blend_attachment.colorWriteMask =
-    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-    VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-  VkPipelineColorBlendStateCreateInfo color_blend = {};
-  color_blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  color_blend.attachmentCount = 1;
-  color_blend.pAttachments = &color_blend_attachment;
-
-  std::array<VkDynamicState, 2> dynamic_states = {
-    {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR}};
-
-  VkPipelineDynamicStateCreateInfo dynamic = {};
-  dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-  dynamic.dynamicStateCount = gsl::narrow_cast<uint32_t>(dynamic_states.size());
-  dynamic.pDynamicStates = dynamic_states.data();
-
-  VkPushConstantRange push_constant_range = {};
-  push_constant_range.stageFlags =
-    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  push_constant_range.offset = 0;
-  push_constant_range.size = sizeof(s_shader_push_constants);
-
-  layout = s_renderer.create_pipeline_layout({}, push_constant_range, ec);
+                           shadertoy_pipelines{});
+  }
+
+  layout = create_shadertoy_pipeline_layout(s_renderer, ec);
   if (ec) {
     return std::make_tuple(std::move(vshader), std::move(fshader), layout,
-                           VkPipeline{VK_NULL_HANDLE});
-  }
-
-  VkGraphicsPipelineCreateInfo cinfo = {};
-  cinfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  cinfo.stageCount = gsl::narrow_cast<uint32_t>(stages.size());
-  cinfo.pStages = stages.data();
-  cinfo.pVertexInputState = &vertex_input;
-  cinfo.pInputAssemblyState = &input_assembly;
-  cinfo.pViewportState = &viewport;
-  cinfo.pRasterizationState = &rasterization;
-  cinfo.pMultisampleState = &multisample;
-  cinfo.pDepthStencilState = &depth_stencil;
-  cinfo.pColorBlendState = &color_blend;
-  cinfo.pDynamicState = &dynamic;
-  cinfo.layout = layout;
-  cinfo.renderPass = s_surface.render_pass();
-  cinfo.subpass = 0;
-
-  pipelines = s_renderer.create_pipelines(cinfo, ec);
+                           shadertoy_pipelines{});
+  }
+
+  shadertoy_pipelines pipelines{vshader, fshader, layout};
+  pipelines.create(s_renderer, prebuilt_variants(), ec);
   if (ec) {
     return std::make_tuple(std::move(vshader), std::move(fshader), layout,
-                           VkPipeline{VK_NULL_HANDLE});
+                           std::move(pipelines));
   }
 
   LOG_LEAVE;
   return std::make_tuple(std::move(vshader), std::move(fshader), layout,
-                         pipelines[0]);
+                         std::move(pipelines));
 } // create_pipeline
 
 // Log a Vulkan debug report callback message
@@ -226,8 +219,10 @@ static VkBool32 debug_report(VkDebugReportFlagsEXT flags,
   return VK_FALSE;
 }
 
-// Pre-record the command buffers to bind the pipeline and draw the vertices
-static void record_command_buffers(gsl::span<VkCommandBuffer> command_buffers,
+// Pre-record the command buffers of v to bind the pipeline and draw the
+// vertices
+static void record_command_buffers(view const& v,
+                                   gsl::span<VkCommandBuffer> command_buffers,
                                    VkPipeline pipeline) noexcept {
   LOG_ENTER;
 
@@ -238,20 +233,20 @@ static void record_command_buffers(gsl::span<VkCommandBuffer> command_buffers,
   // Use the renderpass from the surface
   static VkRenderPassBeginInfo rbinfo = {};
   rbinfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  rbinfo.renderPass = s_surface.render_pass();
+  rbinfo.renderPass = v.surf.render_pass();
   rbinfo.renderArea.extent = {
-    gsl::narrow_cast<uint32_t>(s_window.size().width),
-    gsl::narrow_cast<uint32_t>(s_window.size().height)};
+    gsl::narrow_cast<uint32_t>(v.window.size().width),
+    gsl::narrow_cast<uint32_t>(v.window.size().height)};
   rbinfo.clearValueCount = gsl::narrow_cast<uint32_t>(s_clear_values.size());
   rbinfo.pClearValues = s_clear_values.data();
 
   for (std::size_t i = 0; i < command_buffers.size(); ++i) {
-    rbinfo.framebuffer = s_surface.framebuffer(i);
+    rbinfo.framebuffer = v.surf.framebuffer(i);
 
     vkBeginCommandBuffer(command_buffers[i], &cbinfo);
 
-    vkCmdSetViewport(command_buffers[i], 0, 1, &s_surface.viewport());
-    vkCmdSetScissor(command_buffers[i], 0, 1, &s_surface.scissor());
+    vkCmdSetViewport(command_buffers[i], 0, 1, &v.surf.viewport());
+    vkCmdSetScissor(command_buffers[i], 0, 1, &v.surf.scissor());
 
     vkCmdBeginRenderPass(command_buffers[i], &rbinfo,
                          VK_SUBPASS_CONTENTS_INLINE);
@@ -267,197 +262,793 @@ static void record_command_buffers(gsl::span<VkCommandBuffer> command_buffers,
   LOG_LEAVE;
 }
 
+// The variant in pipelines for s_constants to draw v with. Views whose render
+// passes are compatible with the main window's share its variant.
+static VkPipeline get_pipeline(shadertoy_pipelines& pipelines, view const& v,
+                               std::error_code& ec) noexcept {
+  auto const& s =
+    v.surf.compatible(s_views[0].surf) ? s_views[0].surf : v.surf;
+  return pipelines.get(s_renderer, s, s_constants, ec);
+} // get_pipeline
+
+// Record command buffers drawing with pipelines for every view and replace
+// the views' command buffers and pipelines with them. If ec is true, then an
+// error occurred and the views are unchanged.
+static void replace_command_buffers(shadertoy_pipelines& pipelines,
+                                    std::error_code& ec) noexcept {
+  LOG_ENTER;
+  ec.clear();
+
+  std::vector<std::vector<VkCommandBuffer>> command_buffers(s_views.size());
+  std::vector<VkPipeline> view_pipelines(s_views.size());
+
+  for (std::size_t i = 0; i < s_views.size(); ++i) {
+    view_pipelines[i] = get_pipeline(pipelines, s_views[i], ec);
+    if (ec) goto fail;
+
+    command_buffers[i] = s_renderer.allocate_command_buffers(
+      gsl::narrow_cast<uint32_t>(s_views[i].surf.num_images()), ec);
+    if (ec) goto fail;
+
+    record_command_buffers(s_views[i], command_buffers[i], view_pipelines[i]);
+  }
+
+  for (std::size_t i = 0; i < s_views.size(); ++i) {
+    s_renderer.free(s_views[i].command_buffers);
+    s_views[i].command_buffers = std::move(command_buffers[i]);
+    s_views[i].pipeline = view_pipelines[i];
+  }
+
+  LOG_LEAVE;
+  return;
+
+fail:
+  for (auto&& buffers : command_buffers) s_renderer.free(buffers);
+} // replace_command_buffers
+
+// Use the SPIR-V and pipeline caches in s_cache_path. A cache that cannot be
+// opened is only a warning, everything still works without it.
+static void open_caches() noexcept {
+  LOG_ENTER;
+  if (s_cache_path.empty()) return;
+
+  std::error_code ec;
+  s_renderer.use_spirv_cache(s_cache_path / "spirv", ec);
+  if (ec) {
+    LOG_WARN("opening SPIR-V cache %s failed: %s",
+             (s_cache_path / "spirv").string().c_str(), ec.message().c_str());
+  }
+
+  s_renderer.load_pipeline_cache(s_cache_path / "pipeline.cache", ec);
+  if (ec) {
+    LOG_WARN("loading pipeline cache %s failed: %s",
+             (s_cache_path / "pipeline.cache").string().c_str(),
+             ec.message().c_str());
+  }
+} // open_caches
+
+static void save_caches() noexcept {
+  LOG_ENTER;
+  if (s_cache_path.empty()) return;
+
+  std::error_code ec;
+  s_renderer.save_pipeline_cache(s_cache_path / "pipeline.cache", ec);
+  if (ec) {
+    LOG_WARN("saving pipeline cache %s failed: %s",
+             (s_cache_path / "pipeline.cache").string().c_str(),
+             ec.message().c_str());
+  }
+} // save_caches
+
 static void init(std::error_code& ec) noexcept {
   LOG_ENTER;
   ec.clear();
 
   s_renderer = renderer::create(
     "st",
-    (s_igpu ? renderer_options::use_integrated_gpu : renderer_options::none),
+    (s_igpu ? renderer_options::use_integrated_gpu : renderer_options::none) |
+      (s_timeline ? renderer_options::none
+                  : renderer_options::no_timeline_semaphore),
     &debug_report, sizeof(s_shader_push_constants), ec);
   if (ec) return;
 
-  s_window = wsi::window::create(
-    {{0, 0}, {900, 900}}, "st",
-    wsi::window_options::sizeable | wsi::window_options::decorated, ec);
-  if (ec) return;
+  open_caches();
+  s_renderer.optimization(s_optimization);
 
-  s_surface = s_renderer.create_surface(s_window, ec);
-  if (ec) return;
+  // Extra windows open cascaded from the main one
+  s_views.resize(s_windows);
+  for (std::size_t i = 0; i < s_views.size(); ++i) {
+    auto& v = s_views[i];
+    int const offset = static_cast<int>(i) * 50;
 
-  s_command_buffers = s_renderer.allocate_command_buffers(
-    gsl::narrow_cast<uint32_t>(s_surface.num_images()), ec);
-  if (ec) return;
+    v.window = wsi::window::create(
+      {{offset, offset}, {900, 900}}, "st",
+      wsi::window_options::sizeable | wsi::window_options::decorated, ec);
+    if (ec) return;
 
-  s_update_push_constants_command_buffers = s_renderer.allocate_command_buffers(
-    gsl::narrow_cast<uint32_t>(s_surface.num_images()), ec);
-  if (ec) return;
+    v.surf = s_renderer.create_surface(v.window, ec);
+    if (ec) return;
+
+    v.command_buffers = s_renderer.allocate_command_buffers(
+      gsl::narrow_cast<uint32_t>(v.surf.num_images()), ec);
+    if (ec) return;
+  }
+
+  // As many frames in flight as the main window has swapchain images
+  auto const frame_slots =
+    gsl::narrow_cast<uint32_t>(s_views[0].surf.num_images());
 
-  s_update_push_constants_fences.reserve(s_surface.num_images());
-  for (std::size_t i = 0; i < s_surface.num_images(); ++i) {
-    s_update_push_constants_fences.push_back(s_renderer.create_fence(true, ec));
+  for (auto&& v : s_views) {
+    v.update_push_constants_command_buffers =
+      s_renderer.allocate_command_buffers(frame_slots, ec);
     if (ec) return;
   }
 
+  // Value 0 has always completed, so the first frames do not wait
+  s_frame_values.assign(frame_slots, 0);
+
   s_clear_values[0] = {0.2f, 0.f, 0.3f, 0.f};
   s_clear_values[2] = {1.f, 0};
 
-  std::tie(s_vshader, s_fshader, s_layout, s_pipeline) = create_pipeline(ec);
+  std::tie(s_vshader, s_fshader, s_layout, s_pipelines) =
+    create_pipeline(s_optimization, ec);
   if (ec) return;
 
-  record_command_buffers(s_command_buffers, s_pipeline);
+  for (auto&& v : s_views) {
+    v.pipeline = get_pipeline(s_pipelines, v, ec);
+    if (ec) return;
+
+    record_command_buffers(v, v.command_buffers, v.pipeline);
+  }
 
   LOG_LEAVE;
 } // init
 
-// Record a command buffer to update the shader push constants
-// Use one comman buffer/fence for each surface swapchain image
-static void update_push_constants(uint32_t index,
-                                  std::error_code& ec) noexcept {
-  // Wait on the fence for this swapchain image, after the wait returns
-  // the associated command buffer is free to be recorded into
-  s_renderer.wait(s_update_push_constants_fences[index], true, UINT64_MAX, ec);
-  if (ec) return;
-  s_renderer.reset(s_update_push_constants_fences[index], ec);
-  if (ec) return;
-
+// Record the command buffer of v for frame slot to update the shader push
+// constants, with iResolution set to the size of v
+static void update_push_constants(view& v, std::size_t slot) noexcept {
   static VkCommandBufferBeginInfo cbinfo = {};
   cbinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   cbinfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
 
-  vkBeginCommandBuffer(s_update_push_constants_command_buffers[index], &cbinfo);
+  auto push_constants = s_shader_push_constants;
+  push_constants.iResolution = v.resolution;
+
+  auto command_buffer = v.update_push_constants_command_buffers[slot];
+  vkBeginCommandBuffer(command_buffer, &cbinfo);
 
-  vkCmdPushConstants(s_update_push_constants_command_buffers[index], s_layout,
+  vkCmdPushConstants(command_buffer, s_layout,
                      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                     0, sizeof(s_shader_push_constants),
-                     &s_shader_push_constants);
+                     0, sizeof(push_constants), &push_constants);
 
-  vkEndCommandBuffer(s_update_push_constants_command_buffers[index]);
+  vkEndCommandBuffer(command_buffer);
 } // update_push_constants
 
+// True if result says the surface no longer matches its window
+static bool needs_resize(VkResult result) noexcept {
+  return result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR;
+} // needs_resize
+
+// Draw every view: acquire an image from each, submit all of their command
+// buffers at once and present all of the images at once
 static void draw() {
+  LOG_ENTER;
+  using series = plat::frame_stats::series;
   std::error_code ec;
 
-  uint32_t image_index = s_renderer.acquire_next_image(s_surface, ec);
+  static std::vector<view*> drawn;
+  static std::vector<surface_frame> frames;
+  static std::vector<VkResult> results;
+  drawn.clear();
+  frames.clear();
+
+  // Wait for the last frame drawn in this slot, after the wait returns the
+  // associated command buffers are free to be recorded into
+  s_renderer.wait(s_frame_values[s_frame_slot], UINT64_MAX, ec);
   if (ec) {
-    if (ec.value() == VK_SUBOPTIMAL_KHR ||
-        ec.value() == VK_ERROR_OUT_OF_DATE_KHR) {
-      s_resize = true;
-    } else {
-      LOG_FATAL("draw: acquire next image failed: %s", ec.message().c_str());
-      s_window.close();
-      return;
-    }
+    LOG_FATAL("draw: waiting for frame failed: %s", ec.message().c_str());
+    s_views[0].window.close();
+    return;
   }
 
-  update_push_constants(image_index, ec);
+  // A suboptimal surface still returns an image, an out of date one does not
+  // and is skipped until it has been resized
+  auto start = stats_clock::now();
+  for (auto&& v : s_views) {
+    v.image_index = s_renderer.acquire_next_image(v.surf, ec);
+    if (ec) {
+      if (needs_resize(static_cast<VkResult>(ec.value()))) {
+        v.resize = s_resize = true;
+        if (ec.value() == VK_ERROR_OUT_OF_DATE_KHR) continue;
+      } else {
+        LOG_FATAL("draw: acquire next image failed: %s", ec.message().c_str());
+        s_views[0].window.close();
+        return;
+      }
+    }
+
+    v.submitted = {{
+      v.update_push_constants_command_buffers[s_frame_slot],
+      v.command_buffers[v.image_index],
+    }};
+    drawn.push_back(&v);
+    frames.push_back({&v.surf, v.image_index, v.submitted});
+    update_push_constants(v, s_frame_slot);
+  }
+  s_frame_stats.record(series::acquire, stats_clock::now() - start);
+  if (frames.empty()) return;
+
+  // Submit the command buffers, with anything else enqueued this frame, and
+  // then present the swapchain images
+  start = stats_clock::now();
+  s_renderer.enqueue(frames, VK_NULL_HANDLE);
+  s_renderer.flush(ec);
+  s_frame_stats.record(series::submit, stats_clock::now() - start);
   if (ec) {
-    LOG_FATAL("update push constants failed: %s", ec.message().c_str());
-    s_window.close();
+    LOG_FATAL("draw: submit failed: %s", ec.message().c_str());
+    s_views[0].window.close();
+    return;
+  }
+  s_frame_values[s_frame_slot] = s_renderer.submitted_value();
+  s_frame_slot = (s_frame_slot + 1) % s_frame_values.size();
+
+  results.assign(frames.size(), VK_SUCCESS);
+  start = stats_clock::now();
+  s_renderer.present(frames, results, ec);
+  s_frame_stats.record(series::present, stats_clock::now() - start);
+  if (ec && !needs_resize(static_cast<VkResult>(ec.value()))) {
+    LOG_FATAL("draw: present failed: %s", ec.message().c_str());
+    s_views[0].window.close();
     return;
   }
 
-  std::array<VkCommandBuffer, 2> submit_command_buffers = {{
-    s_update_push_constants_command_buffers[image_index],
-    s_command_buffers[image_index],
-  }};
+  for (std::size_t i = 0; i < drawn.size(); ++i) {
+    if (needs_resize(results[i])) drawn[i]->resize = s_resize = true;
+  }
+} // draw
 
-  // Both submit the command buffers and then present the swapchain image
-  s_renderer.submit_present(submit_command_buffers, s_surface, image_index,
-                            s_update_push_constants_fences[image_index], ec);
-  if (ec) {
-    if (ec.value() == VK_SUBOPTIMAL_KHR ||
-        ec.value() == VK_ERROR_OUT_OF_DATE_KHR) {
-      s_resize = true;
-    } else {
-      LOG_FATAL("draw: submit and present failed: %s", ec.message().c_str());
-      s_window.close();
+// Resize the surface of every view whose window has been resized
+static void resize() {
+  LOG_ENTER;
+  std::error_code ec;
+
+  for (auto&& v : s_views) {
+    if (!v.resize) continue;
+
+    auto const size = v.window.size();
+    s_renderer.resize(v.surf, size, ec);
+    if (ec) {
+      LOG_FATAL("resize: surface resize failed: %s", ec.message().c_str());
+      s_views[0].window.close();
       return;
     }
+
+    v.resolution.x = static_cast<float>(size.width);
+    v.resolution.y = static_cast<float>(size.height);
+    v.resolution.z = v.resolution.x / v.resolution.y;
+
+    // The surface swapchain has changed, so record new command buffers. The
+    // old ones may still be in flight; the renderer frees them once their
+    // frames have completed.
+    auto command_buffers = s_renderer.allocate_command_buffers(
+      gsl::narrow_cast<uint32_t>(v.surf.num_images()), ec);
+    if (ec) {
+      LOG_FATAL("resize: allocating command buffers failed: %s",
+                ec.message().c_str());
+      s_views[0].window.close();
+      return;
+    }
+
+    record_command_buffers(v, command_buffers, v.pipeline);
+    s_renderer.free(v.command_buffers);
+    v.command_buffers = std::move(command_buffers);
+    v.resize = false;
   }
-} // draw
 
-static void resize() {
+  s_shader_push_constants.iResolution = s_views[0].resolution;
+  s_resize = false;
+
+  LOG_LEAVE;
+} // resize
+
+// s_constants have changed, so switch to their pipeline variant. Variants are
+// cached, so only the first switch to a set of values creates a pipeline.
+static void respecialize() {
   LOG_ENTER;
   std::error_code ec;
 
-  auto const size = s_window.size();
-  s_renderer.resize(s_surface, size, ec);
+  replace_command_buffers(s_pipelines, ec);
   if (ec) {
-    LOG_FATAL("resize: surface resize failed: %s", ec.message().c_str());
-    s_window.close();
+    LOG_ERROR("respecialize: recording command buffers failed: %s",
+              ec.message().c_str());
     return;
   }
 
-  s_shader_push_constants.iResolution.x = static_cast<float>(size.width);
-  s_shader_push_constants.iResolution.y = static_cast<float>(size.height);
-  s_shader_push_constants.iResolution.z =
-    s_shader_push_constants.iResolution.x /
-    s_shader_push_constants.iResolution.y;
+  LOG_INFO("iQuality %d iAATaps %d (%zu variants)",
+           s_constants.get(
+             static_cast<uint32_t>(shadertoy_constants::quality), 1),
+           s_constants.get(
+             static_cast<uint32_t>(shadertoy_constants::aa_taps), 1),
+           s_pipelines.size());
+  LOG_LEAVE;
+} // respecialize
+
+// Add step to a shadertoy constant, keeping it at least 1
+static void step_constant(shadertoy_constants constant, int32_t step) {
+  auto const id = static_cast<uint32_t>(constant);
+  s_constants.set(id, std::max(1, s_constants.get(id, 1) + step));
+  respecialize();
+} // step_constant
+
+// True if rebuild should compile twice: unoptimized, then s_optimization
+static bool tiered() noexcept {
+  return s_tiered && (s_optimization.level != optimization_levels::zero ||
+                      s_optimization.spirv_opt);
+} // tiered
+
+// Compile shadertoy.frag at s_optimization on the background thread and hand
+// the code to swap_optimized, unless a newer rebuild has started
+static void compile_optimized(uint64_t generation) noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  std::string error_message;
+  std::vector<uint32_t> code;
+  // Read rather than map: the file may be edited while this compiles
+  auto const source =
+    plat::read_file(PROJECT_DIR "/assets/shaders/shadertoy.frag", ec);
+  if (!ec) {
+    code = s_renderer.compile(*s_background_compiler, source,
+                              PROJECT_DIR "/assets/shaders/shadertoy.frag",
+                              shader::types::fragment, s_optimization,
+                              error_message, ec);
+  }
 
-  // The surface swapchain has changed, so re-record the command buffers
-  record_command_buffers(s_command_buffers, s_pipeline);
-  s_resize = false;
+  std::lock_guard<std::mutex> lock{s_optimized.mutex};
+  if (generation != s_optimized.generation) return; // superseded
+  s_optimized.pending = false;
+
+  if (ec) {
+    LOG_WARN("compiling optimized shader failed: %s%s%s", ec.message().c_str(),
+             (error_message.empty() ? "" : "\n"), error_message.c_str());
+    return;
+  }
+
+  s_optimized.code = std::move(code);
+  s_optimized.ready = true;
 
   LOG_LEAVE;
-} // resize
+} // compile_optimized
+
+// If the background compile has finished, build a pipeline from the
+// optimized fragment shader and swap it in for the unoptimized one
+static void swap_optimized() {
+  LOG_ENTER;
+  std::error_code ec;
+
+  std::vector<uint32_t> code;
+  stats_clock::time_point start;
+  {
+    std::lock_guard<std::mutex> lock{s_optimized.mutex};
+    if (!s_optimized.ready) return;
+    s_optimized.ready = false;
+    code = std::move(s_optimized.code);
+    start = s_optimized.start;
+  }
+
+  shadertoy_pipelines new_pipelines;
+
+  shader new_fshader = s_renderer.create_shader(code, ec);
+  if (ec) {
+    LOG_ERROR("swap_optimized: creating shader failed: %s",
+              ec.message().c_str());
+    goto fail;
+  }
+
+  new_pipelines = shadertoy_pipelines{s_vshader, new_fshader, s_layout};
+  new_pipelines.create(s_renderer, prebuilt_variants(), ec);
+  if (ec) {
+    LOG_ERROR("swap_optimized: creating pipeline failed: %s",
+              ec.message().c_str());
+    goto fail;
+  }
+
+  replace_command_buffers(new_pipelines, ec);
+  if (ec) {
+    LOG_ERROR("swap_optimized: recording command buffers failed: %s",
+              ec.message().c_str());
+    goto fail;
+  }
+
+  s_pipelines.destroy(s_renderer);
+  s_renderer.destroy(s_fshader);
+
+  s_pipelines = std::move(new_pipelines);
+  s_fshader = std::move(new_fshader);
 
-// The shaders have changed, so rebuild the command buffers and pipeline
+  LOG_INFO("optimized shader swapped in %.1f ms after rebuild",
+           std::chrono::duration<double, std::milli>{stats_clock::now() -
+                                                     start}.count());
+  LOG_LEAVE;
+  return;
+
+fail:
+  new_pipelines.destroy(s_renderer);
+  s_renderer.destroy(new_fshader);
+} // swap_optimized
+
+// The shaders have changed, so rebuild the command buffers and pipeline. With
+// tiered compilation the fragment shader is first compiled unoptimized, for
+// immediate feedback, and recompiled at s_optimization in the background.
 static void rebuild() {
   LOG_ENTER;
   std::error_code ec;
 
   shader new_vshader, new_fshader;
   VkPipelineLayout new_layout{VK_NULL_HANDLE};
-  VkPipeline new_pipeline{VK_NULL_HANDLE};
-  std::vector<VkCommandBuffer> new_command_buffers;
+  shadertoy_pipelines new_pipelines;
+
+  // Discard any optimized code from an earlier rebuild
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock{s_optimized.mutex};
+    generation = ++s_optimized.generation;
+    s_optimized.ready = false;
+    s_optimized.code.clear();
+    s_optimized.start = stats_clock::now();
+  }
 
-  std::tie(new_vshader, new_fshader, new_layout, new_pipeline) =
-    create_pipeline(ec);
+  std::tie(new_vshader, new_fshader, new_layout, new_pipelines) =
+    create_pipeline(tiered() ? shader_optimization{optimization_levels::zero,
+                                                   false}
+                             : s_optimization,
+                    ec);
   if (ec) {
     LOG_FATAL("rebuild: creating pipeline failed: %s", ec.message().c_str());
     goto fail;
   }
 
-  new_command_buffers = s_renderer.allocate_command_buffers(
-    gsl::narrow_cast<uint32_t>(s_surface.num_images()), ec);
+  // create_pipeline created the main window's variant, so this only looks it
+  // up unless another window's render pass is not compatible
+  replace_command_buffers(new_pipelines, ec);
   if (ec) {
-    LOG_FATAL("rebuild: allocating command buffers failed: %s",
+    LOG_FATAL("rebuild: recording command buffers failed: %s",
               ec.message().c_str());
     goto fail;
   }
 
-  record_command_buffers(new_command_buffers, new_pipeline);
-
-  s_renderer.free(s_command_buffers);
-  s_renderer.destroy(s_pipeline);
+  s_pipelines.destroy(s_renderer);
   s_renderer.destroy(s_layout);
   s_renderer.destroy(s_fshader);
   s_renderer.destroy(s_vshader);
 
-  s_command_buffers = std::move(new_command_buffers);
-  s_pipeline = new_pipeline;
+  s_pipelines = std::move(new_pipelines);
   s_layout = new_layout;
   s_fshader = std::move(new_fshader);
   s_vshader = std::move(new_vshader);
 
+  if (tiered()) {
+    {
+      std::lock_guard<std::mutex> lock{s_optimized.mutex};
+      s_optimized.pending = true;
+    }
+    s_background->submit(
+      [generation](std::size_t) { compile_optimized(generation); });
+  }
+
   s_rebuild = false;
   LOG_LEAVE;
   return;
 
 fail:
-  s_renderer.free(new_command_buffers);
-  s_renderer.destroy(new_pipeline);
+  new_pipelines.destroy(s_renderer);
   s_renderer.destroy(new_layout);
   s_renderer.destroy(new_fshader);
   s_renderer.destroy(new_vshader);
 } // rebuild
 
+// True if text defines the GLSL entry point: void, then main, then an open
+// parenthesis, as whole words. A Shadertoy snippet only defines mainImage.
+static bool defines_main(std::string const& text) noexcept {
+  auto const is_word = [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+  };
+  auto const skip_space = [&](std::size_t i) {
+    while (i < text.size() &&
+           std::isspace(static_cast<unsigned char>(text[i]))) {
+      ++i;
+    }
+    return i;
+  };
+
+  for (auto i = text.find("void"); i != std::string::npos;
+       i = text.find("void", i + 4)) {
+    if (i > 0 && is_word(text[i - 1])) continue;
+
+    auto j = i + 4;
+    if (j >= text.size() ||
+        !std::isspace(static_cast<unsigned char>(text[j]))) {
+      continue;
+    }
+    j = skip_space(j);
+    if (text.compare(j, 4, "main") != 0) continue;
+
+    j = skip_space(j + 4);
+    if (j < text.size() && text[j] == '(') return true;
+  }
+  return false;
+} // defines_main
+
+// The result of compiling one file in precompile
+struct precompile_report {
+  plat::filesystem::path path{};
+  double compile_ms{0.0};
+  double pipeline_ms{0.0};
+  std::string error{};
+  // Destroyed on the main thread: destroying a pipeline is deferred on the
+  // renderer's timeline, which is not safe to touch from the workers.
+  VkPipeline pipeline{VK_NULL_HANDLE};
+}; // struct precompile_report
+
+// Compile every .frag file in s_precompile_path on a thread pool, with one
+// shader_compiler per worker, creating a pipeline for each so that both the
+// SPIR-V and pipeline caches are populated. Files without a main function
+// are ShaderToy snippets; they are compiled in place of the first #include
+// of shadertoy.frag, the same way st uses them. Returns the exit status.
+static int precompile() noexcept {
+  LOG_ENTER;
+  using precompile_clock = std::chrono::steady_clock;
+  auto const to_ms = [](precompile_clock::duration d) {
+    return std::chrono::duration<double, std::milli>{d}.count();
+  };
+
+  std::error_code ec;
+  auto const start = precompile_clock::now();
+
+  s_renderer = renderer::create(
+    "st",
+    renderer_options::headless |
+      (s_igpu ? renderer_options::use_integrated_gpu : renderer_options::none),
+    &debug_report, sizeof(s_shader_push_constants), ec);
+  if (ec) {
+    LOG_FATAL("creating renderer failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  open_caches();
+  s_renderer.optimization(s_optimization);
+
+  std::vector<precompile_report> reports;
+  plat::filesystem::directory_iterator iter{s_precompile_path, ec}, end;
+  for (; !ec && iter != end; iter.increment(ec)) {
+    if (iter->path().extension() != ".frag") continue;
+    precompile_report report;
+    report.path = plat::filesystem::absolute(iter->path(), ec);
+    if (ec) break;
+    reports.push_back(std::move(report));
+  }
+  if (ec) {
+    LOG_FATAL("reading %s failed: %s", s_precompile_path.string().c_str(),
+              ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::sort(reports.begin(), reports.end(),
+            [](auto const& a, auto const& b) { return a.path < b.path; });
+
+  // Split shadertoy.frag around its first #include line
+  std::string prefix, suffix;
+  auto const shadertoy =
+    plat::read_file(PROJECT_DIR "/assets/shaders/shadertoy.frag", ec);
+  if (ec) {
+    LOG_FATAL("reading " PROJECT_DIR
+              "/assets/shaders/shadertoy.frag failed: %s",
+              ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+  {
+    std::string const text{shadertoy.data(), shadertoy.size()};
+    auto const include = text.find("\n#include");
+    if (include != std::string::npos) {
+      prefix = text.substr(0, include + 1);
+      suffix =
+        text.substr(std::min(text.find('\n', include + 1), text.size()));
+    }
+  }
+
+  // The pipelines only need a render pass compatible with the window surface
+  shader vshader = s_renderer.create_shader(
+    PROJECT_DIR "/assets/shaders/fsq.vert", shader::types::vertex, ec);
+  if (ec) {
+    LOG_FATAL("creating shader " PROJECT_DIR
+              "/assets/shaders/fsq.vert failed: %s%s%s",
+              ec.message().c_str(),
+              (vshader.error_message().empty() ? "" : "\n"),
+              vshader.error_message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  VkPipelineLayout layout = create_shadertoy_pipeline_layout(s_renderer, ec);
+  if (ec) {
+    LOG_FATAL("creating pipeline layout failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  wsi::extent2d extent;
+  extent.width = extent.height = 1;
+  surface target = s_renderer.create_surface(
+    extent, renderer::WINDOW_SURFACE_SAMPLES, ec);
+  if (ec) {
+    LOG_WARN("creating offscreen surface failed, not creating pipelines: %s",
+             ec.message().c_str());
+  }
+  bool const create_pipelines = !ec;
+
+  plat::thread_pool pool{s_precompile_threads};
+  std::vector<shader_compiler> compilers(pool.size());
+
+  for (auto&& report : reports) {
+    pool.submit([&](std::size_t worker) {
+      std::error_code ec;
+      auto const source = plat::read_file(report.path, ec);
+      if (ec) {
+        report.error = ec.message();
+        return;
+      }
+
+      std::string wrapped;
+      gsl::span<char const> text = source;
+      std::string name = report.path.string();
+
+      if (!prefix.empty() && !defines_main({source.data(), source.size()})) {
+        wrapped = prefix + "#include \"" + report.path.generic_string() +
+                  "\"" + suffix;
+        text = wrapped;
+        name = PROJECT_DIR "/assets/shaders/shadertoy.frag";
+      }
+
+      auto const compile_start = precompile_clock::now();
+      std::string error_message;
+      auto const code =
+        s_renderer.compile(compilers[worker], text, name.c_str(),
+                           shader::types::fragment, s_optimization,
+                           error_message, ec);
+      report.compile_ms = to_ms(precompile_clock::now() - compile_start);
+      if (ec) {
+        report.error = ec.message() + (error_message.empty() ? "" : "\n") +
+                       error_message;
+        return;
+      }
+
+      if (!create_pipelines) return;
+
+      auto const pipeline_start = precompile_clock::now();
+      shader fshader = s_renderer.create_shader(code, ec);
+      if (ec) {
+        report.error = ec.message();
+        return;
+      }
+
+      report.pipeline = create_shadertoy_pipeline(
+        s_renderer, target, vshader, fshader, layout, ec);
+      report.pipeline_ms = to_ms(precompile_clock::now() - pipeline_start);
+      if (ec) report.error = ec.message();
+
+      s_renderer.destroy(fshader);
+    });
+  }
+
+  pool.wait();
+
+  std::size_t failed{0};
+  double total_compile_ms{0.0};
+  for (auto&& report : reports) {
+    if (report.pipeline != VK_NULL_HANDLE) s_renderer.destroy(report.pipeline);
+    total_compile_ms += report.compile_ms;
+    if (report.error.empty()) {
+      std::printf("ok     %9.2fms %9.2fms  %s\n", report.compile_ms,
+                  report.pipeline_ms, report.path.string().c_str());
+      LOG_INFO("precompile: %s compile %.2fms pipeline %.2fms",
+               report.path.string().c_str(), report.compile_ms,
+               report.pipeline_ms);
+    } else {
+      failed += 1;
+      std::printf("FAILED %9.2fms %9s    %s\n%s\n", report.compile_ms, "",
+                  report.path.string().c_str(), report.error.c_str());
+      LOG_ERROR("precompile: %s failed: %s", report.path.string().c_str(),
+                report.error.c_str());
+    }
+  }
+
+  s_renderer.destroy(target);
+  s_renderer.destroy(layout);
+  s_renderer.destroy(vshader);
+  save_caches();
+
+  auto const wall_ms = to_ms(precompile_clock::now() - start);
+  std::printf("%zu shaders, %zu failed, %zu threads: %.2fms compiling, "
+              "%.2fms wall\n",
+              reports.size(), failed, pool.size(), total_compile_ms, wall_ms);
+  LOG_INFO("precompile: %zu shaders, %zu failed, %zu threads: %.2fms "
+           "compiling, %.2fms wall",
+           reports.size(), failed, pool.size(), total_compile_ms, wall_ms);
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // precompile
+
+// Write the profiling trace if one was requested
+static void write_trace() noexcept {
+  if (s_trace_path.empty()) return;
+
+  std::error_code ec;
+  plat::profile::stop();
+  plat::profile::write_chrome_trace(s_trace_path, ec);
+  if (ec) {
+    LOG_ERROR("writing trace %s failed: %s", s_trace_path.string().c_str(),
+              ec.message().c_str());
+  }
+} // write_trace
+
 #if TURF_TARGET_WIN32
 
 void parse_options(LPWSTR* szArgList, int nArgs) {
   for (int i = 0; i < nArgs; ++i) {
-    if (wcscmp(szArgList[i], L"--igpu") == 0) s_igpu = true;
+    if (wcscmp(szArgList[i], L"--igpu") == 0) {
+      s_igpu = true;
+    } else if (wcscmp(szArgList[i], L"--no-timeline") == 0) {
+      s_timeline = false;
+    } else if (wcscmp(szArgList[i], L"--fixed-step") == 0 && i + 1 < nArgs) {
+      s_fixed_step_rate = std::wcstof(szArgList[++i], nullptr);
+    } else if (wcscmp(szArgList[i], L"--fps") == 0 && i + 1 < nArgs) {
+      s_fps = std::wcstof(szArgList[++i], nullptr);
+    } else if (wcscmp(szArgList[i], L"--windows") == 0 && i + 1 < nArgs) {
+      s_windows = std::max(1ul, std::wcstoul(szArgList[++i], nullptr, 10));
+    } else if (wcscmp(szArgList[i], L"--record") == 0 && i + 1 < nArgs) {
+      s_record_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--replay") == 0 && i + 1 < nArgs) {
+      s_replay_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--stats") == 0 && i + 1 < nArgs) {
+      s_stats_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--stats-interval") == 0 &&
+               i + 1 < nArgs) {
+      s_stats_interval = std::wcstof(szArgList[++i], nullptr);
+    } else if (wcscmp(szArgList[i], L"--trace") == 0 && i + 1 < nArgs) {
+      s_trace_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--cache") == 0 && i + 1 < nArgs) {
+      s_cache_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--no-cache") == 0) {
+      s_cache_path.clear();
+    } else if (wcscmp(szArgList[i], L"--precompile") == 0 && i + 1 < nArgs) {
+      s_precompile_path = szArgList[++i];
+    } else if (wcscmp(szArgList[i], L"--threads") == 0 && i + 1 < nArgs) {
+      s_precompile_threads = std::wcstoul(szArgList[++i], nullptr, 10);
+    } else if (wcscmp(szArgList[i], L"--opt") == 0 && i + 1 < nArgs) {
+      char level[16];
+      std::snprintf(level, sizeof(level), "%ls", szArgList[++i]);
+      if (!from_string(level, s_optimization.level)) {
+        LOG_WARN("unknown optimization level %s", level);
+      }
+    } else if (wcscmp(szArgList[i], L"--constant") == 0 && i + 1 < nArgs) {
+      wchar_t* value;
+      auto const id = std::wcstoul(szArgList[++i], &value, 10);
+      if (*value++ == L'=') {
+        s_constants.set(static_cast<uint32_t>(id),
+                        static_cast<int32_t>(std::wcstol(value, nullptr, 10)));
+      }
+    } else if (wcscmp(szArgList[i], L"--no-tiered") == 0) {
+      s_tiered = false;
+    } else if (wcscmp(szArgList[i], L"--no-idle") == 0) {
+      s_idle = false;
+    } else if (wcscmp(szArgList[i], L"--quality-levels") == 0 &&
+               i + 1 < nArgs) {
+      s_quality_levels =
+        static_cast<int32_t>(std::wcstol(szArgList[++i], nullptr, 10));
+    } else if (wcscmp(szArgList[i], L"--spirv-opt") == 0) {
+      s_optimization.spirv_opt = true;
+      if (!shader_compiler::has_spirv_opt()) {
+        LOG_WARN("built without SPIRV-Tools, --spirv-opt is ignored");
+      }
+    }
   }
 } // parse_options
 
@@ -465,12 +1056,118 @@ void parse_options(LPWSTR* szArgList, int nArgs) {
 
 void parse_options(int argc, char* argv[]) {
   for (int i = 0; i < argc; ++i) {
-    if (strcmp(argv[i], "--igpu") == 0) s_igpu = true;
+    if (strcmp(argv[i], "--igpu") == 0) {
+      s_igpu = true;
+    } else if (strcmp(argv[i], "--no-timeline") == 0) {
+      s_timeline = false;
+    } else if (strcmp(argv[i], "--fixed-step") == 0 && i + 1 < argc) {
+      s_fixed_step_rate = std::strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+      s_fps = std::strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+      s_windows = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      s_record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      s_replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      s_stats_path = argv[++i];
+    } else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {
+      s_stats_interval = std::strtof(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      s_trace_path = argv[++i];
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      s_cache_path = argv[++i];
+    } else if (strcmp(argv[i], "--no-cache") == 0) {
+      s_cache_path.clear();
+    } else if (strcmp(argv[i], "--precompile") == 0 && i + 1 < argc) {
+      s_precompile_path = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      s_precompile_threads = std::strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--opt") == 0 && i + 1 < argc) {
+      if (!from_string(argv[++i], s_optimization.level)) {
+        LOG_WARN("unknown optimization level %s", argv[i]);
+      }
+    } else if (strcmp(argv[i], "--constant") == 0 && i + 1 < argc) {
+      char* value;
+      auto const id = std::strtoul(argv[++i], &value, 10);
+      if (*value++ == '=') {
+        s_constants.set(static_cast<uint32_t>(id),
+                        static_cast<int32_t>(std::strtol(value, nullptr, 10)));
+      }
+    } else if (strcmp(argv[i], "--no-tiered") == 0) {
+      s_tiered = false;
+    } else if (strcmp(argv[i], "--no-idle") == 0) {
+      s_idle = false;
+    } else if (strcmp(argv[i], "--quality-levels") == 0 && i + 1 < argc) {
+      s_quality_levels =
+        static_cast<int32_t>(std::strtol(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--spirv-opt") == 0) {
+      s_optimization.spirv_opt = true;
+      if (!shader_compiler::has_spirv_opt()) {
+        LOG_WARN("built without SPIRV-Tools, --spirv-opt is ignored");
+      }
+    }
   }
 } // parse_options
 
 #endif // TURF_TARGET_WIN32
 
+// The words of push_constant_uniform_block, as in shader::push_constants_read,
+// that change every frame whether or not anything else happens.
+static uint64_t animated_uniforms() noexcept {
+  uint64_t words = 0;
+  for (auto&& offset : {offsetof(push_constant_uniform_block, iTime),
+                        offsetof(push_constant_uniform_block, iTimeDelta),
+                        offsetof(push_constant_uniform_block, iFrameRate),
+                        offsetof(push_constant_uniform_block, iFrame)}) {
+    words |= UINT64_C(1) << (offset / 4);
+  }
+  return words;
+} // animated_uniforms
+
+// True if the next frame would look the same as the last one unless there is
+// input, a resize or a file change: the shaders read none of the uniforms
+// that animate and there is no rebuild or optimized shader to swap in.
+// iMouse and iResolution only change with window events, which end the wait.
+static bool idle(plat::frame_clock const& clock) noexcept {
+  if (!s_idle || s_resize || s_rebuild || !s_record_path.empty() ||
+      clock.mode() == plat::frame_clock::modes::recorded) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{s_optimized.mutex};
+    if (s_optimized.pending || s_optimized.ready) return false;
+  }
+
+  auto const read =
+    s_vshader.push_constants_read() | s_fshader.push_constants_read();
+  return (read & animated_uniforms()) == 0;
+} // idle
+
+// Create the clock that drives iTime and iTimeDelta. A replayed run takes its
+// times from the trace, otherwise the clock is either fixed-step or realtime.
+static plat::frame_clock
+create_clock(plat::frame_trace::reader const& replay) noexcept {
+  using namespace std::chrono;
+
+  if (!s_replay_path.empty()) {
+    std::vector<plat::frame_clock::duration> times(replay.size());
+    for (std::size_t i = 0; i < times.size(); ++i) {
+      times[i] = nanoseconds{replay.record<frame_record>(i).elapsed_ns};
+    }
+    return plat::frame_clock::recorded(std::move(times));
+  }
+
+  if (s_fixed_step_rate > 0.f) {
+    return plat::frame_clock::fixed_step(duration_cast<nanoseconds>(
+      duration<double>{1.0 / s_fixed_step_rate}));
+  }
+
+  return plat::frame_clock::realtime();
+} // create_clock
+
 #if TURF_TARGET_WIN32
 int CALLBACK WinMain(::HINSTANCE, ::HINSTANCE, ::LPSTR, int) {
 #else
@@ -490,22 +1187,37 @@ int main(int argc, char* argv[]) {
   parse_options(argc, argv);
 #endif
 
+  if (!s_trace_path.empty()) plat::profile::start();
+
+  if (!s_precompile_path.empty()) {
+    int const status = precompile();
+    write_trace();
+    std::exit(status);
+  }
+
   init(ec);
   if (ec) {
     LOG_FATAL("initialization failed: %s", ec.message().c_str());
     std::exit(EXIT_FAILURE);
   }
 
-  s_window.on_resize([](auto, auto) { s_resize = true; });
+  if (tiered()) {
+    s_background = gsl::make_unique<plat::thread_pool>(1);
+    s_background_compiler = gsl::make_unique<shader_compiler>();
+  }
+
+  for (std::size_t i = 0; i < s_views.size(); ++i) {
+    s_views[i].window.on_resize(
+      [i](auto, auto) { s_views[i].resize = s_resize = true; });
+    s_views[i].window.show();
+    s_views[i].resize = true;
+  }
 
-  auto input = wsi::input{&s_window};
-  s_window.show();
+  auto& window = s_views[0].window;
+  auto input = wsi::input{&window};
   resize();
 
-  auto shader_changed = [](auto, auto path, auto action) {
-    if (action != plat::fs_notify::actions::removed) return;
-    s_rebuild = true;
-  };
+  auto shader_changed = [](auto, auto, auto) { s_rebuild = true; };
 
   plat::fs_notify watcher;
 
@@ -524,53 +1236,222 @@ int main(int argc, char* argv[]) {
               ec.message().c_str());
   }
 
-  auto start{std::chrono::steady_clock::now()}, last{start};
+  // Included files live next to shadertoy.frag. Drop a changed file from the
+  // include cache right away instead of relying on its write time on the
+  // next compile.
+  auto include_changed = [shader_changed](auto id, auto path, auto action) {
+    s_renderer.compiler().includes().invalidate(path);
+    shader_changed(id, path, action);
+  };
+
+  watcher.add(PROJECT_DIR "/assets/shaders", include_changed, false, ec);
+  if (ec) {
+    LOG_ERROR("watching " PROJECT_DIR "/assets/shaders failed: %s",
+              ec.message().c_str());
+  }
+
+  plat::frame_trace::reader replay;
+  if (!s_replay_path.empty()) {
+    replay = plat::frame_trace::reader::open(s_replay_path,
+                                             sizeof(frame_record), ec);
+    if (ec) {
+      LOG_FATAL("opening replay %s failed: %s", s_replay_path.string().c_str(),
+                ec.message().c_str());
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  plat::frame_trace::writer record;
+  if (!s_record_path.empty()) {
+    record = plat::frame_trace::writer::open(s_record_path,
+                                             sizeof(frame_record), ec);
+    if (ec) {
+      LOG_ERROR("opening record %s failed: %s", s_record_path.string().c_str(),
+                ec.message().c_str());
+    }
+  }
+
+  plat::file_handle stats;
+  if (!s_stats_path.empty()) {
+    stats = plat::file_handle::open(s_stats_path,
+                                    plat::file_handle::open_modes::write, ec);
+    if (ec) {
+      LOG_ERROR("opening stats %s failed: %s", s_stats_path.string().c_str(),
+                ec.message().c_str());
+    } else {
+      plat::frame_stats::write_header(stats);
+    }
+  }
+
+  auto clock = create_clock(replay);
   int32_t frame{0};
 
+#if !TURF_TARGET_WIN32
+  // Only to wake an idle wait; watcher.tick below reads the changes. On
+  // Win32 the watcher's completion routines already end the wait.
+  window.events().add(watcher.descriptor(), {}, ec);
+  if (ec) LOG_WARN("waiting on the watcher failed: %s", ec.message().c_str());
+
+  // The same for the other windows' connections, whose events are handled
+  // below. On Win32 every window of the thread shares one message queue.
+  for (std::size_t i = 1; i < s_views.size(); ++i) {
+    window.events().add(s_views[i].window.descriptor(), {}, ec);
+    if (ec) {
+      LOG_WARN("waiting on window %zu failed: %s", i, ec.message().c_str());
+    }
+  }
+#endif
+
+  auto const report_timer = window.events().add_timer(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<float>{s_stats_interval}),
+    [&stats]() { s_frame_stats.report(stats); }, ec);
+  if (ec) LOG_WARN("starting stats timer failed: %s", ec.message().c_str());
+
+  // Paces frames to --fps. The time it sleeps is counted as frame time, so
+  // cpu_frame shows the paced frame interval.
+  plat::frame_pacer pacer;
+  if (s_fps > 0.f) {
+    pacer = plat::frame_pacer{std::chrono::duration_cast<
+      std::chrono::nanoseconds>(std::chrono::duration<double>{1.0 / s_fps})};
+  }
+
+  auto frame_start = stats_clock::now();
+  auto submit_count = s_renderer.submit_count();
+
   LOG_TRACE("running");
-  while (!s_window.closed()) {
-    auto const now = std::chrono::steady_clock::now();
-    std::chrono::duration<float> elapsed{now - start}, delta{now - last};
-    last = now;
+  // Closing any of the windows ends the run
+  auto const closed = []() {
+    return std::any_of(s_views.begin(), s_views.end(),
+                       [](auto const& v) { return v.window.closed(); });
+  };
+
+  while (!closed()) {
+    // Sleep until something could change the picture. The time asleep is
+    // not counted as frame time.
+    if (frame > 0 && idle(clock)) {
+      window.wait_events(plat::event_loop::forever);
+      frame_start = stats_clock::now();
+      pacer.reset();
+    }
 
-    s_window.poll_events();
+    // Wait for the frame's start time before reading the clock and input,
+    // so they are as recent as possible when the frame is presented
+    if (s_fps > 0.f) {
+      s_frame_stats.record(plat::frame_stats::series::pacing_error,
+                           pacer.wait());
+    }
+
+    // A recorded clock runs out at the end of the replayed trace
+    if (!clock.tick()) break;
+
+    auto const now = stats_clock::now();
+    if (frame > 0) {
+      s_frame_stats.record(plat::frame_stats::series::cpu_frame,
+                           now - frame_start);
+    }
+    frame_start = now;
+
+    // Handle window events and run the stats timer if it is due
+    window.wait_events(std::chrono::nanoseconds{0});
+    for (std::size_t i = 1; i < s_views.size(); ++i) {
+      s_views[i].window.poll_events();
+    }
     if (s_resize) resize();
     watcher.tick();
     if (s_rebuild) rebuild();
+    if (s_background) swap_optimized();
     input.tick();
 
     if (input.key_released(wsi::keys::eEscape)) break;
 
-    if (input.button_down(wsi::buttons::e1)) {
-      s_shader_push_constants.iMouse.x =
-        static_cast<float>(s_window.cursor_pos().x);
-      s_shader_push_constants.iMouse.y =
-        static_cast<float>(s_window.cursor_pos().y);
-    } else if (input.button_released(wsi::buttons::e1)) {
-      s_shader_push_constants.iMouse.z =
-        static_cast<float>(s_window.cursor_pos().x);
-      s_shader_push_constants.iMouse.w =
-        static_cast<float>(s_window.cursor_pos().y);
+    if (input.key_released(wsi::keys::eLeftBracket)) {
+      step_constant(shadertoy_constants::quality, -1);
+    } else if (input.key_released(wsi::keys::eRightBracket)) {
+      step_constant(shadertoy_constants::quality, 1);
+    } else if (input.key_released(wsi::keys::eMinus)) {
+      step_constant(shadertoy_constants::aa_taps, -1);
+    } else if (input.key_released(wsi::keys::eEqual)) {
+      step_constant(shadertoy_constants::aa_taps, 1);
+    }
+
+    if (clock.mode() == plat::frame_clock::modes::recorded) {
+      // Replay everything but iResolution, which is recorded but follows the
+      // surface size rather than the trace
+      auto const uniforms =
+        replay.record<frame_record>(clock.ticks() - 1).uniforms;
+      s_shader_push_constants.iMouse = uniforms.iMouse;
+      s_shader_push_constants.iTime = uniforms.iTime;
+      s_shader_push_constants.iTimeDelta = uniforms.iTimeDelta;
+      s_shader_push_constants.iFrame = uniforms.iFrame;
+      s_shader_push_constants.iFrameRate = uniforms.iFrameRate;
+    } else {
+      if (input.button_down(wsi::buttons::e1)) {
+        s_shader_push_constants.iMouse.x =
+          static_cast<float>(window.cursor_pos().x);
+        s_shader_push_constants.iMouse.y =
+          static_cast<float>(window.cursor_pos().y);
+      } else if (input.button_released(wsi::buttons::e1)) {
+        s_shader_push_constants.iMouse.z =
+          static_cast<float>(window.cursor_pos().x);
+        s_shader_push_constants.iMouse.w =
+          static_cast<float>(window.cursor_pos().y);
+      }
+
+      s_shader_push_constants.iTime = plat::to_seconds(clock.elapsed());
+      s_shader_push_constants.iTimeDelta = plat::to_seconds(clock.delta());
+      s_shader_push_constants.iFrame = static_cast<float>(frame);
+      // The first frame has an elapsed time of exactly zero; keep the
+      // previous rate rather than push a NaN
+      if (s_shader_push_constants.iTime > 0.f) {
+        s_shader_push_constants.iFrameRate =
+          frame / s_shader_push_constants.iTime;
+      }
     }
 
-    s_shader_push_constants.iTime = elapsed.count();
-    s_shader_push_constants.iTimeDelta = delta.count();
-    s_shader_push_constants.iFrame = static_cast<float>(frame);
-    s_shader_push_constants.iFrameRate = frame / s_shader_push_constants.iTime;
+    if (record) {
+      record.write(frame_record{clock.elapsed().count(),
+                                s_shader_push_constants}, ec);
+      if (ec) {
+        LOG_ERROR("recording frame %d failed: %s", frame,
+                  ec.message().c_str());
+        record = {};
+      }
+    }
 
     draw();
+    if (s_fps > 0.f) pacer.presented();
+
+    s_frame_stats.record(plat::frame_stats::counter::submits,
+                         s_renderer.submit_count() - submit_count);
+    submit_count = s_renderer.submit_count();
+
+    // Input read this frame is on screen once the frame is presented
+    if (!input.events().empty()) {
+      s_frame_stats.record(plat::frame_stats::series::input_latency,
+                           stats_clock::now() - input.events()[0].received);
+    }
     frame += 1;
   }
   LOG_TRACE("done");
 
-  s_renderer.free(s_update_push_constants_command_buffers);
-  for (auto&& fence : s_update_push_constants_fences) s_renderer.destroy(fence);
+  window.events().remove(report_timer);
+  s_frame_stats.report(stats);
+
+  // Joins the background thread after any queued compile finishes
+  s_background.reset();
 
-  s_renderer.free(s_command_buffers);
-  s_renderer.destroy(s_pipeline);
+  for (auto&& v : s_views) {
+    s_renderer.free(v.update_push_constants_command_buffers);
+    s_renderer.free(v.command_buffers);
+  }
+  s_pipelines.destroy(s_renderer);
   s_renderer.destroy(s_layout);
   s_renderer.destroy(s_fshader);
   s_renderer.destroy(s_vshader);
-  s_renderer.destroy(s_surface);
+  for (auto&& v : s_views) s_renderer.destroy(v.surf);
+
+  save_caches();
+  write_trace();
   return 0;
 }
@@ -0,0 +1,1141 @@
+// Benchmark ShaderToy fragment shaders across resolutions and sample counts.
+//
+// Each shader is rendered offscreen for a number of frames with a fixed-step
+// clock, so every run does identical GPU work. The GPU time of each frame is
+// measured with timestamp queries and the results are written as JSON. The
+// renderer is headless, so this also runs on lavapipe without a display.
+
+#include <plat/async_io.h>
+#include <plat/core.h>
+#include <plat/file_handle.h>
+#include <plat/file_io.h>
+#include <plat/frame_clock.h>
+#include <plat/log.h>
+#include <plat/mapped_file.h>
+#include "renderer.h"
+#include "shadertoy.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static bool s_igpu{false};      // force integrated gpu
+static bool s_timeline{true};   // use timeline semaphores when supported
+static uint32_t s_frames{100};  // measured frames per run
+static uint32_t s_warmup{10};   // unmeasured frames before each run
+static uint32_t s_reloads{0};   // hot-reload compiles per shader
+static uint32_t s_include_depth{0}; // include chain depth for --include-stress
+static uint32_t s_reads{0}; // reads per file for --read-bench
+static uint32_t s_dumps{0}; // frames written by --dump-bench
+static uint32_t s_input_frames{0}; // frames run by --input-bench
+static uint32_t s_submit_passes{0}; // submits a frame for --submit-bench
+static std::vector<wsi::extent2d> s_resolutions{};
+static std::vector<VkSampleCountFlagBits> s_samples{};
+static std::vector<optimization_levels> s_levels{};
+static bool s_spirv_opt{false}; // also run the SPIR-V optimizer
+static std::vector<plat::filesystem::path> s_shaders{};
+static plat::filesystem::path s_output{};
+static plat::filesystem::path s_trace{};
+
+struct statistics {
+  double mean{0.0};
+  double median{0.0};
+  double min{0.0};
+  double max{0.0};
+}; // struct statistics
+
+// The result of rendering one shader at one resolution and sample count
+struct run {
+  wsi::extent2d extent{};
+  VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+  statistics gpu_ms{};
+  statistics submit_ms{};
+  std::string error{};
+}; // struct run
+
+// The results of all runs of one shader at one optimization level
+struct result {
+  plat::filesystem::path shader{};
+  shader_optimization opt{};
+  double compile_ms{0.0};
+  double pipelines_ms{0.0}; // one batch with a variant per sample count
+  statistics fresh_compiler_ms{}; // hot reload with a new compiler each time
+  statistics reused_compiler_ms{}; // hot reload with one long-lived compiler
+  std::string error{};
+  std::vector<run> runs{};
+}; // struct result
+
+static double to_ms(bench_clock::duration d) noexcept {
+  return std::chrono::duration<double, std::milli>{d}.count();
+}
+
+static statistics summarize(std::vector<double> samples) noexcept {
+  statistics stats;
+  if (samples.empty()) return stats;
+
+  std::sort(samples.begin(), samples.end());
+  stats.min = samples.front();
+  stats.max = samples.back();
+  stats.median = samples[samples.size() / 2];
+
+  for (auto&& sample : samples) stats.mean += sample;
+  stats.mean /= samples.size();
+
+  return stats;
+} // summarize
+
+// Log Vulkan debug report warnings and errors
+static VkBool32 debug_report(VkDebugReportFlagsEXT flags,
+                             VkDebugReportObjectTypeEXT, uint64_t, size_t,
+                             int32_t, char const* layer_prefix,
+                             char const* message, void*) noexcept {
+  if ((flags & VK_DEBUG_REPORT_ERROR_BIT_EXT) ==
+      VK_DEBUG_REPORT_ERROR_BIT_EXT) {
+    LOG_ERROR("%s: %s", layer_prefix, message);
+  } else if ((flags & (VK_DEBUG_REPORT_WARNING_BIT_EXT |
+                       VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT)) != 0) {
+    LOG_WARN("%s: %s", layer_prefix, message);
+  }
+  return VK_FALSE;
+} // debug_report
+
+// Record one frame: push the uniforms and draw the full-screen triangle
+// between two timestamps.
+static void record_command_buffer(VkCommandBuffer command_buffer,
+                                  surface const& s, VkPipeline pipeline,
+                                  VkPipelineLayout layout, VkQueryPool pool,
+                                  push_constant_uniform_block const& uniforms) {
+  static std::array<VkClearValue, 3> clear_values{};
+  clear_values[0].color = {{0.2f, 0.f, 0.3f, 0.f}};
+  clear_values[2].depthStencil = {1.f, 0};
+
+  VkCommandBufferBeginInfo cbinfo = {};
+  cbinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cbinfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  VkRenderPassBeginInfo rbinfo = {};
+  rbinfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  rbinfo.renderPass = s.render_pass();
+  rbinfo.framebuffer = s.framebuffer(0);
+  rbinfo.renderArea = s.scissor();
+  rbinfo.clearValueCount = gsl::narrow_cast<uint32_t>(clear_values.size());
+  rbinfo.pClearValues = clear_values.data();
+
+  vkBeginCommandBuffer(command_buffer, &cbinfo);
+  vkCmdResetQueryPool(command_buffer, pool, 0, 2);
+  vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool,
+                      0);
+
+  vkCmdSetViewport(command_buffer, 0, 1, &s.viewport());
+  vkCmdSetScissor(command_buffer, 0, 1, &s.scissor());
+  vkCmdPushConstants(command_buffer, layout,
+                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                     0, sizeof(uniforms), &uniforms);
+
+  vkCmdBeginRenderPass(command_buffer, &rbinfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  vkCmdDraw(command_buffer, 3, 1, 0, 0);
+  vkCmdEndRenderPass(command_buffer);
+
+  vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                      pool, 1);
+  vkEndCommandBuffer(command_buffer);
+} // record_command_buffer
+
+// Render s_warmup + s_frames frames of one shader at one resolution and
+// sample count with pipeline, which must have been created for a render pass
+// with the same sample count, waiting for each frame to complete before the
+// next.
+static run bench(renderer& r, VkPipeline pipeline, VkPipelineLayout layout,
+                 wsi::extent2d extent, VkSampleCountFlagBits samples) noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  run rn;
+  rn.extent = extent;
+  rn.samples = samples;
+
+  std::vector<double> gpu_ms, submit_ms;
+  gpu_ms.reserve(s_frames);
+  submit_ms.reserve(s_frames);
+
+  // iTime advances by a fixed step so every run does the same work
+  auto clock = plat::frame_clock::fixed_step(std::chrono::microseconds{16667});
+  push_constant_uniform_block uniforms;
+  uniforms.iResolution.x = static_cast<float>(extent.width);
+  uniforms.iResolution.y = static_cast<float>(extent.height);
+  uniforms.iResolution.z = uniforms.iResolution.x / uniforms.iResolution.y;
+
+  VkQueryPool pool{VK_NULL_HANDLE};
+  std::vector<VkCommandBuffer> command_buffers;
+  bench_clock::time_point start;
+
+  surface s = r.create_surface(extent, samples, ec);
+  if (ec) goto done;
+
+  pool = r.create_timestamp_query_pool(2, ec);
+  if (ec) goto done;
+
+  command_buffers = r.allocate_command_buffers(1, ec);
+  if (ec) goto done;
+
+  for (uint32_t i = 0; i < s_warmup + s_frames; ++i) {
+    clock.tick();
+    uniforms.iTime = plat::to_seconds(clock.elapsed());
+    uniforms.iTimeDelta = plat::to_seconds(clock.delta());
+    uniforms.iFrame = static_cast<float>(i);
+    uniforms.iFrameRate = 60.f;
+
+    record_command_buffer(command_buffers[0], s, pipeline, layout, pool,
+                          uniforms);
+
+    start = bench_clock::now();
+    r.submit(command_buffers, false, ec);
+    auto const submitted = bench_clock::now();
+    if (ec) goto done;
+
+    r.wait(r.submitted_value(), UINT64_MAX, ec);
+    auto const completed = plat::profile::now();
+    if (ec) goto done;
+
+    auto const timestamps = r.get_timestamps(pool, 0, 2, ec);
+    if (ec) goto done;
+
+    // The GPU and CPU clocks are not calibrated against each other, so the
+    // GPU zone is placed to end when the timeline wait returned. That is an
+    // upper bound on when the GPU actually finished.
+    auto const gpu_ns = static_cast<uint64_t>(
+      (timestamps[1] - timestamps[0]) * r.timestamp_period());
+    plat::profile::record_gpu("frame", completed - gpu_ns, completed);
+
+    if (i < s_warmup) continue;
+    gpu_ms.push_back(gpu_ns / 1e6);
+    submit_ms.push_back(to_ms(submitted - start));
+  }
+
+  rn.gpu_ms = summarize(std::move(gpu_ms));
+  rn.submit_ms = summarize(std::move(submit_ms));
+
+done:
+  if (ec) rn.error = ec.message();
+
+  r.free(command_buffers);
+  r.destroy(pool);
+  r.destroy(s);
+
+  LOG_LEAVE;
+  return rn;
+} // bench
+
+// Recompile a shader s_reloads times as hot reload does, first with a new
+// shader_compiler for every compile, which is what every compile used to
+// pay for, then with the renderer's long-lived compiler. The difference is
+// the per-compile overhead saved: compiler and options setup plus re-reading
+// the include files.
+static void bench_reload(renderer& r, result& res) noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  auto const source = plat::read_file(res.shader, ec);
+  if (ec) return;
+
+  std::string const name = res.shader.string();
+  std::string error_message;
+  std::vector<double> fresh_ms, reused_ms;
+
+  for (uint32_t i = 0; i < s_reloads; ++i) {
+    auto const start = bench_clock::now();
+    shader_compiler compiler;
+    r.compile(compiler, source, name.c_str(), shader::types::fragment,
+              res.opt, error_message, ec);
+    fresh_ms.push_back(to_ms(bench_clock::now() - start));
+  }
+
+  for (uint32_t i = 0; i < s_reloads; ++i) {
+    auto const start = bench_clock::now();
+    r.compile(r.compiler(), source, name.c_str(), shader::types::fragment,
+              res.opt, error_message, ec);
+    reused_ms.push_back(to_ms(bench_clock::now() - start));
+  }
+
+  res.fresh_compiler_ms = summarize(std::move(fresh_ms));
+  res.reused_compiler_ms = summarize(std::move(reused_ms));
+
+  LOG_LEAVE;
+} // bench_reload
+
+// Closes the JSON output unless it is stdout
+struct output_closer {
+  void operator()(std::FILE* fh) const noexcept {
+    if (fh != stdout) std::fclose(fh);
+  }
+}; // struct output_closer
+
+using output_file = std::unique_ptr<std::FILE, output_closer>;
+
+// Open s_output for the JSON results, or use stdout when it is empty. Returns
+// null, after logging, when the file cannot be opened.
+static output_file open_output() noexcept {
+  if (s_output.empty()) return output_file{stdout};
+  output_file output{std::fopen(s_output.string().c_str(), "w")};
+  if (!output) LOG_FATAL("opening %s failed", s_output.string().c_str());
+  return output;
+} // open_output
+
+// Write a string as a JSON string literal
+static void write_json(std::FILE* fh, std::string const& str) noexcept {
+  std::fputc('"', fh);
+  for (auto&& c : str) {
+    switch (c) {
+    case '"': std::fputs("\\\"", fh); break;
+    case '\\': std::fputs("\\\\", fh); break;
+    case '\n': std::fputs("\\n", fh); break;
+    case '\t': std::fputs("\\t", fh); break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        std::fprintf(fh, "\\u%04x", c);
+      } else {
+        std::fputc(c, fh);
+      }
+    }
+  }
+  std::fputc('"', fh);
+} // write_json
+
+static void write_json(std::FILE* fh, statistics const& stats) noexcept {
+  std::fprintf(fh,
+               "{\"mean\": %.6f, \"median\": %.6f, \"min\": %.6f, "
+               "\"max\": %.6f}",
+               stats.mean, stats.median, stats.min, stats.max);
+} // write_json
+
+static void write_json(std::FILE* fh, renderer const& r,
+                       std::vector<result> const& results) noexcept {
+  std::fputs("{\n  \"device\": ", fh);
+  write_json(fh, r.properties().deviceName);
+  std::fprintf(fh, ",\n  \"frames\": %u,\n  \"warmup\": %u,\n", s_frames,
+               s_warmup);
+  std::fprintf(fh, "  \"reloads\": %u,\n", s_reloads);
+  std::fprintf(fh, "  \"spirv_opt_available\": %s,\n",
+               shader_compiler::has_spirv_opt() ? "true" : "false");
+  std::fputs("  \"results\": [", fh);
+
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto&& res = results[i];
+    std::fputs(i == 0 ? "\n    {\"shader\": " : ",\n    {\"shader\": ", fh);
+    write_json(fh, res.shader.string());
+    std::fprintf(fh, ", \"optimization\": \"%s\", \"spirv_opt\": %s",
+                 to_string(res.opt.level),
+                 res.opt.spirv_opt ? "true" : "false");
+    std::fprintf(fh, ", \"compile_ms\": %.6f", res.compile_ms);
+    if (res.error.empty()) {
+      std::fprintf(fh, ", \"pipelines_ms\": %.6f", res.pipelines_ms);
+    }
+    if (s_reloads > 0 && res.error.empty()) {
+      std::fputs(", \"fresh_compiler_ms\": ", fh);
+      write_json(fh, res.fresh_compiler_ms);
+      std::fputs(", \"reused_compiler_ms\": ", fh);
+      write_json(fh, res.reused_compiler_ms);
+    }
+    if (!res.error.empty()) {
+      std::fputs(", \"error\": ", fh);
+      write_json(fh, res.error);
+    }
+    std::fputs(", \"runs\": [", fh);
+
+    for (std::size_t j = 0; j < res.runs.size(); ++j) {
+      auto&& rn = res.runs[j];
+      std::fprintf(fh,
+                   "%s\n      {\"width\": %d, \"height\": %d, \"samples\": %d",
+                   j == 0 ? "" : ",", rn.extent.width, rn.extent.height,
+                   static_cast<int>(rn.samples));
+      if (rn.error.empty()) {
+        std::fputs(", \"gpu_ms\": ", fh);
+        write_json(fh, rn.gpu_ms);
+        std::fputs(", \"submit_ms\": ", fh);
+        write_json(fh, rn.submit_ms);
+      } else {
+        std::fputs(", \"error\": ", fh);
+        write_json(fh, rn.error);
+      }
+      std::fputc('}', fh);
+    }
+
+    std::fputs(res.runs.empty() ? "]}" : "\n    ]}", fh);
+  }
+
+  std::fputs("\n  ]\n}\n", fh);
+} // write_json
+
+// Write a chain of s_include_depth include files, each including a shared
+// guarded file and the next link, then compile a shader including the head
+// of the chain with one shader_compiler. This exercises the includer with
+// deep nesting and repeated includes of the same file across many compiles.
+static int stress_includes() noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  auto const directory =
+    plat::filesystem::temp_directory_path(ec) / "st_bench_includes";
+  if (!ec) plat::filesystem::create_directories(directory, ec);
+  if (ec) {
+    LOG_FATAL("creating include directory failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  auto const write = [&directory, &ec](char const* name,
+                                       std::string const& text) {
+    if (!ec) {
+      plat::write_file(directory / name,
+                       {text.data(), text.data() + text.size()}, ec);
+    }
+  };
+
+  write("common.glsl", "#ifndef COMMON\n#define COMMON\n"
+                       "float common_f(float x) { return x * 0.5; }\n"
+                       "#endif\n");
+
+  char name[32];
+  for (uint32_t i = 0; i < s_include_depth; ++i) {
+    auto const n = std::to_string(i);
+    std::string text = "#ifndef CHAIN_" + n + "\n#define CHAIN_" + n +
+                       "\n#include \"common.glsl\"\n";
+    if (i + 1 < s_include_depth) {
+      text += "#include \"chain_" + std::to_string(i + 1) + ".glsl\"\n";
+    }
+    text += "float chain_" + n + "(float x) { return common_f(x)";
+    if (i + 1 < s_include_depth) {
+      text += " + chain_" + std::to_string(i + 1) + "(x)";
+    }
+    text += "; }\n#endif\n";
+
+    std::snprintf(name, sizeof(name), "chain_%u.glsl", i);
+    write(name, text);
+  }
+
+  if (ec) {
+    LOG_FATAL("writing include files failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::string const source =
+    "#version 450\n"
+    "layout(location = 0) out vec4 fragColor;\n"
+    "#include \"common.glsl\"\n"
+    "#include \"chain_0.glsl\"\n"
+    "void main() { fragColor = vec4(chain_0(1.0)); }\n";
+  std::string const main_name = (directory / "main.frag").string();
+  uint32_t const compiles = s_reloads > 0 ? s_reloads : 10;
+
+  shader_compiler compiler;
+  std::string error_message;
+  std::vector<double> compile_ms;
+  uint32_t errors = 0;
+
+  for (uint32_t i = 0; i < compiles; ++i) {
+    auto const start = bench_clock::now();
+    compiler.compile({source.data(), source.data() + source.size()},
+                     main_name.c_str(), shaderc_fragment_shader,
+                     shader_optimization{}, error_message, ec);
+    compile_ms.push_back(to_ms(bench_clock::now() - start));
+    if (ec) {
+      LOG_ERROR("compiling include chain failed: %s: %s",
+                ec.message().c_str(), error_message.c_str());
+      errors += 1;
+    }
+  }
+
+  auto const output = open_output();
+  if (!output) return EXIT_FAILURE;
+  std::FILE* fh = output.get();
+
+  std::fprintf(fh, "{\n  \"include_depth\": %u,\n  \"compiles\": %u,\n",
+               s_include_depth, compiles);
+  std::fputs("  \"compile_ms\": ", fh);
+  write_json(fh, summarize(std::move(compile_ms)));
+  std::fprintf(fh,
+               ",\n  \"include_cache_hits\": %llu,\n"
+               "  \"include_cache_misses\": %llu,\n  \"errors\": %u\n}\n",
+               static_cast<unsigned long long>(compiler.includes().hits()),
+               static_cast<unsigned long long>(compiler.includes().misses()),
+               errors);
+
+  plat::filesystem::remove_all(directory, ec);
+
+  LOG_LEAVE;
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // stress_includes
+
+// Read every shader s_reads times with plat::read_file, which copies the
+// file into a new vector, and with plat::mapped_file, which maps it, summing
+// every byte so both touch all of the data. After the first read the files
+// are in the page cache, so this measures the cost of the read path itself.
+static int bench_reads() noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  auto const output = open_output();
+  if (!output) return EXIT_FAILURE;
+  std::FILE* fh = output.get();
+
+  auto const sum = [](gsl::span<char const> bytes) {
+    uint32_t s = 0;
+    for (auto&& c : bytes) s += static_cast<unsigned char>(c);
+    return s;
+  };
+
+  std::fprintf(fh, "{\n  \"reads\": %u,\n  \"files\": [", s_reads);
+  uint32_t errors = 0;
+
+  for (std::size_t i = 0; i < s_shaders.size(); ++i) {
+    auto&& path = s_shaders[i];
+    std::vector<double> read_ms, mapped_ms;
+    std::size_t size = 0;
+    uint32_t read_sum = 0, mapped_sum = 0;
+
+    for (uint32_t j = 0; j < s_reads && !ec; ++j) {
+      auto start = bench_clock::now();
+      {
+        auto const bytes = plat::read_file(path, ec);
+        read_sum = sum(bytes);
+        size = bytes.size();
+      }
+      read_ms.push_back(to_ms(bench_clock::now() - start));
+      if (ec) break;
+
+      start = bench_clock::now();
+      {
+        auto const mapped = plat::mapped_file::open(path, ec);
+        mapped_sum = sum(mapped.bytes());
+      }
+      mapped_ms.push_back(to_ms(bench_clock::now() - start));
+    }
+
+    std::fputs(i == 0 ? "\n    {\"file\": " : ",\n    {\"file\": ", fh);
+    write_json(fh, path.string());
+    if (!ec && read_sum != mapped_sum) {
+      ec.assign(EIO, std::generic_category());
+    }
+
+    if (ec) {
+      LOG_ERROR("reading %s failed: %s", path.string().c_str(),
+                ec.message().c_str());
+      std::fputs(", \"error\": ", fh);
+      write_json(fh, ec.message());
+      errors += 1;
+      ec.clear();
+    } else {
+      std::fprintf(fh, ", \"bytes\": %zu, \"read_file_ms\": ", size);
+      write_json(fh, summarize(std::move(read_ms)));
+      std::fputs(", \"mapped_file_ms\": ", fh);
+      write_json(fh, summarize(std::move(mapped_ms)));
+    }
+    std::fputc('}', fh);
+  }
+
+  std::fprintf(fh, "%s],\n  \"errors\": %u\n}\n",
+               s_shaders.empty() ? "" : "\n  ", errors);
+
+  LOG_LEAVE;
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // bench_reads
+
+// Write s_dumps synthetic 3840x2160 RGBA frames, one file each, the way a
+// frame capture would: once with blocking file_handle writes, then through
+// plat::async_io on each available backend with every frame split into 1MiB
+// requests. The files are not synced, so this measures the path into the
+// page cache rather than the disk.
+static int bench_dumps() noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  auto const directory =
+    plat::filesystem::temp_directory_path(ec) / "st_bench_dumps";
+  if (!ec) plat::filesystem::create_directories(directory, ec);
+  if (ec) {
+    LOG_FATAL("creating dump directory failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::size_t const frame_bytes = 3840 * 2160 * 4;
+  std::size_t const chunk_bytes = 1024 * 1024;
+  uint32_t const queue_depth = 8;
+
+  std::vector<char> frame(frame_bytes);
+  for (std::size_t i = 0; i < frame.size(); ++i) {
+    frame[i] = static_cast<char>(i * 31 + (i >> 12));
+  }
+
+  auto const frame_path = [&directory](uint32_t i) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%04u.raw", i);
+    return directory / name;
+  };
+
+  auto const mode = plat::file_handle::open_modes::write;
+  std::vector<plat::file_handle> handles(s_dumps);
+
+  // Open every file up front so each run times only the writes and closes
+  auto const open_all = [&]() {
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < s_dumps; ++i) {
+      handles[i] = plat::file_handle::open(frame_path(i), mode, ec);
+      if (ec) {
+        LOG_ERROR("opening %s failed: %s", frame_path(i).string().c_str(),
+                  ec.message().c_str());
+        errors += 1;
+        ec.clear();
+      }
+    }
+    return errors;
+  };
+
+  auto const write_sync = [&]() {
+    uint32_t errors = 0;
+    for (auto&& fh : handles) {
+      if (!fh) continue;
+      fh.write(frame.data(), frame.size(), ec);
+      if (ec) {
+        errors += 1;
+        ec.clear();
+      }
+      fh.reset();
+    }
+    return errors;
+  };
+
+  auto const write_async = [&](plat::async_io& io) {
+    uint32_t errors = 0;
+    for (auto&& fh : handles) {
+      if (!fh) continue;
+      for (std::size_t offset = 0; offset < frame.size();
+           offset += chunk_bytes) {
+        auto const size = std::min(chunk_bytes, frame.size() - offset);
+        io.write(fh, offset, frame.data() + offset, size,
+                 [&errors, size](std::size_t n, std::error_code const& e) {
+                   if (e || n != size) errors += 1;
+                 });
+      }
+      io.submit();
+    }
+    io.wait();
+    for (auto&& fh : handles) fh.reset();
+    return errors;
+  };
+
+  auto const output = open_output();
+  if (!output) return EXIT_FAILURE;
+  std::FILE* fh = output.get();
+
+  std::fprintf(fh,
+               "{\n  \"frames\": %u,\n  \"frame_bytes\": %zu,\n"
+               "  \"queue_depth\": %u,\n  \"runs\": [",
+               s_dumps, frame_bytes, queue_depth);
+
+  uint32_t total_errors = 0;
+  auto const report = [&](char const* backend, bool first,
+                          bench_clock::duration elapsed, uint32_t errors) {
+    double const ms = to_ms(elapsed);
+    double const mb = static_cast<double>(frame_bytes) * s_dumps / 1.0e6;
+    std::fprintf(fh,
+                 "%s\n    {\"backend\": \"%s\", \"ms\": %.3f, "
+                 "\"mb_per_s\": %.1f, \"errors\": %u}",
+                 first ? "" : ",", backend, ms,
+                 ms > 0.0 ? mb / (ms / 1000.0) : 0.0, errors);
+    total_errors += errors;
+  };
+
+  {
+    uint32_t errors = open_all();
+    auto const start = bench_clock::now();
+    errors += write_sync();
+    report("sync", true, bench_clock::now() - start, errors);
+  }
+
+  for (auto&& backend : {plat::async_io::backends::thread_pool,
+                         plat::async_io::backends::io_uring}) {
+    plat::async_io io(queue_depth, backend);
+    // io_uring falls back to the thread pool, which has already been run
+    if (io.backend() != backend) continue;
+
+    uint32_t errors = open_all();
+    auto const start = bench_clock::now();
+    errors += write_async(io);
+    report(plat::to_string(backend), false, bench_clock::now() - start,
+           errors);
+  }
+
+  std::fprintf(fh, "\n  ],\n  \"errors\": %u\n}\n", total_errors);
+
+  plat::filesystem::remove_all(directory, ec);
+
+  LOG_LEAVE;
+  return total_errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // bench_dumps
+
+// Time s_input_frames frames of the window work st does each frame: handle
+// events, tick the input and read the cursor position twice. The frames are
+// run once with the cursor position window::cursor_pos caches from pointer
+// events, and once asking the X server for it with a QueryPointer request
+// each time. The time of one round trip is reported with them, so the
+// difference shows how many round trips a frame spent on the cursor.
+static int bench_input() noexcept {
+  LOG_ENTER;
+#if TURF_KERNEL_LINUX
+  std::error_code ec;
+
+  wsi::rect2d rect;
+  rect.extent.width = 640;
+  rect.extent.height = 360;
+  auto window = wsi::window::create(rect, "st_bench", wsi::window_options::none,
+                                    0, ec);
+  if (ec) {
+    LOG_FATAL("creating window failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+  window.show();
+  wsi::input input(&window);
+
+  auto const output = open_output();
+  if (!output) return EXIT_FAILURE;
+  std::FILE* fh = output.get();
+
+#if WSI_XCB
+  xcb_connection_t* connection = std::get<0>(window.native_handle());
+  xcb_window_t handle = std::get<2>(window.native_handle());
+
+  auto const query_pointer = [&]() {
+    auto const reply = xcb_query_pointer_reply(
+      connection, xcb_query_pointer(connection, handle), nullptr);
+    wsi::offset2d pos;
+    if (reply) pos = {reply->win_x, reply->win_y};
+    std::free(reply);
+    return pos;
+  };
+
+  // XCB has no XSync; any request with a reply is a round trip
+  auto const sync = [&]() {
+    std::free(xcb_get_input_focus_reply(
+      connection, xcb_get_input_focus(connection), nullptr));
+  };
+#else
+  Display* display = std::get<0>(window.native_handle());
+  Window handle = std::get<2>(window.native_handle());
+
+  auto const query_pointer = [&]() {
+    Window root, child;
+    wsi::offset2d root_pos, pos;
+    unsigned int mask;
+    XQueryPointer(display, handle, &root, &child, &root_pos.x, &root_pos.y,
+                  &pos.x, &pos.y, &mask);
+    return pos;
+  };
+
+  auto const sync = [&]() { XSync(display, False); };
+#endif
+
+  // Each frame reads the cursor where st does: in input.tick and twice for
+  // iMouse. The sum keeps the reads from being optimized out.
+  int sum = 0;
+  auto const frames = [&](bool cached) {
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < s_warmup + s_input_frames; ++i) {
+      auto const start = bench_clock::now();
+      window.poll_events();
+      input.tick();
+      for (int j = 0; j < 2; ++j) {
+        auto const pos = cached ? window.cursor_pos() : query_pointer();
+        sum += pos.x + pos.y;
+      }
+      if (!cached) sum += query_pointer().x; // in place of input.tick's read
+      if (i >= s_warmup) samples.push_back(to_ms(bench_clock::now() - start));
+    }
+    return summarize(std::move(samples));
+  };
+
+  std::vector<double> round_trips;
+  for (uint32_t i = 0; i < s_input_frames; ++i) {
+    auto const start = bench_clock::now();
+    sync();
+    round_trips.push_back(to_ms(bench_clock::now() - start));
+  }
+
+  auto const cached = frames(true);
+  auto const queried = frames(false);
+  auto const round_trip = summarize(std::move(round_trips));
+
+  std::fprintf(fh, "{\n  \"frames\": %u,\n  \"round_trip\": ",
+               s_input_frames);
+  write_json(fh, round_trip);
+  std::fputs(",\n  \"cached\": ", fh);
+  write_json(fh, cached);
+  std::fputs(",\n  \"query_pointer\": ", fh);
+  write_json(fh, queried);
+  std::fprintf(fh, ",\n  \"checksum\": %d\n}\n", sum);
+
+  LOG_LEAVE;
+  return EXIT_SUCCESS;
+#else
+  LOG_FATAL("--input-bench times X server round trips and needs X11");
+  LOG_LEAVE;
+  return EXIT_FAILURE;
+#endif
+} // bench_input
+
+// Time s_frames frames that each submit s_submit_passes command buffers, as
+// a frame with that many passes, uploads and readbacks would: first with a
+// vkQueueSubmit for each, then enqueued and flushed together. The command
+// buffers are empty, so the time is the submission overhead alone.
+static int bench_submits() noexcept {
+  LOG_ENTER;
+  std::error_code ec;
+
+  auto opts = renderer_options::headless;
+  if (s_igpu) opts = opts | renderer_options::use_integrated_gpu;
+  if (!s_timeline) opts = opts | renderer_options::no_timeline_semaphore;
+
+  renderer r = renderer::create("st_bench", opts, &debug_report,
+                                sizeof(push_constant_uniform_block), ec);
+  if (ec) {
+    LOG_FATAL("creating renderer failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  auto command_buffers = r.allocate_command_buffers(s_submit_passes, ec);
+  if (ec) {
+    LOG_FATAL("allocating command buffers failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  VkCommandBufferBeginInfo cbinfo = {};
+  cbinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  cbinfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+  for (auto&& command_buffer : command_buffers) {
+    vkBeginCommandBuffer(command_buffer, &cbinfo);
+    vkEndCommandBuffer(command_buffer);
+  }
+
+  // Each frame waits on the timeline value of its last submit, either way
+  auto const frames = [&](bool batched, double& submits) {
+    std::vector<double> samples;
+    auto const first_count = r.submit_count();
+
+    for (uint32_t i = 0; i < s_warmup + s_frames && !ec; ++i) {
+      auto const start = bench_clock::now();
+      for (uint32_t j = 0; j < s_submit_passes; ++j) {
+        if (batched) {
+          r.enqueue({&command_buffers[j], 1}, {}, {}, {}, VK_NULL_HANDLE);
+        } else {
+          r.submit({&command_buffers[j], 1}, false, ec);
+        }
+      }
+      if (batched) r.flush(ec);
+      if (i >= s_warmup) samples.push_back(to_ms(bench_clock::now() - start));
+
+      if (!ec) r.wait(r.submitted_value(), UINT64_MAX, ec);
+    }
+
+    submits = static_cast<double>(r.submit_count() - first_count) /
+              (s_warmup + s_frames);
+    return summarize(std::move(samples));
+  };
+
+  double individual_submits, batched_submits;
+  auto const individual = frames(false, individual_submits);
+  auto const batched = frames(true, batched_submits);
+
+  r.free(command_buffers);
+
+  if (ec) {
+    LOG_FATAL("submitting failed: %s", ec.message().c_str());
+    return EXIT_FAILURE;
+  }
+
+  auto const output = open_output();
+  if (!output) return EXIT_FAILURE;
+  std::FILE* fh = output.get();
+
+  std::fputs("{\n  \"device\": ", fh);
+  write_json(fh, r.properties().deviceName);
+  std::fprintf(fh, ",\n  \"timeline\": \"%s\"",
+               r.timeline_semaphore() ? "semaphore" : "fences");
+  std::fprintf(fh, ",\n  \"frames\": %u,\n  \"passes\": %u,\n", s_frames,
+               s_submit_passes);
+  std::fprintf(fh, "  \"individual\": {\"submits_per_frame\": %.1f, \"ms\": ",
+               individual_submits);
+  write_json(fh, individual);
+  std::fprintf(fh, "},\n  \"batched\": {\"submits_per_frame\": %.1f, \"ms\": ",
+               batched_submits);
+  write_json(fh, batched);
+  std::fputs("}\n}\n", fh);
+
+  LOG_LEAVE;
+  return EXIT_SUCCESS;
+} // bench_submits
+
+static void usage() noexcept {
+  std::fputs(
+    "usage: st_bench [options] [shader.frag ...]\n"
+    "  --igpu                  use an integrated gpu\n"
+    "  --no-timeline           track GPU progress with fences even if\n"
+    "                          timeline semaphores are supported\n"
+    "  --frames N              measured frames per run (default 100)\n"
+    "  --warmup N              unmeasured frames per run (default 10)\n"
+    "  --reloads N             time N hot-reload compiles per shader\n"
+    "  --include-stress DEPTH  only compile a chain of DEPTH nested includes,\n"
+    "                          --reloads times (default 10)\n"
+    "  --read-bench N          only time N reads of each shader with\n"
+    "                          read_file and mapped_file\n"
+    "  --dump-bench N          only time writing N 4K frames with blocking\n"
+    "                          and asynchronous I/O\n"
+    "  --input-bench N         only time N frames of window event handling\n"
+    "                          with cached and queried cursor positions\n"
+    "  --submit-bench N        only time frames of N command buffers\n"
+    "                          submitted one at a time and as one batch\n"
+    "  --resolutions WxH,...   (default 640x360,1280x720,1920x1080)\n"
+    "  --samples N,...         (default 1,4)\n"
+    "  --opt-levels L,...      zero, size and/or performance (default all)\n"
+    "  --spirv-opt             also run the SPIR-V optimizer\n"
+    "  --output FILE           write JSON to FILE instead of stdout\n"
+    "  --trace FILE            write a Chrome trace with GPU zones to FILE\n",
+    stderr);
+} // usage
+
+static bool parse_options(int argc, char* argv[]) noexcept {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--igpu") == 0) {
+      s_igpu = true;
+    } else if (strcmp(argv[i], "--no-timeline") == 0) {
+      s_timeline = false;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      s_frames = std::strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+      s_warmup = std::strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--reloads") == 0 && i + 1 < argc) {
+      s_reloads = std::strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--include-stress") == 0 && i + 1 < argc) {
+      s_include_depth = std::strtoul(argv[++i], nullptr, 10);
+      if (s_include_depth == 0) return false;
+    } else if (strcmp(argv[i], "--read-bench") == 0 && i + 1 < argc) {
+      s_reads = std::strtoul(argv[++i], nullptr, 10);
+      if (s_reads == 0) return false;
+    } else if (strcmp(argv[i], "--dump-bench") == 0 && i + 1 < argc) {
+      s_dumps = std::strtoul(argv[++i], nullptr, 10);
+      if (s_dumps == 0) return false;
+    } else if (strcmp(argv[i], "--input-bench") == 0 && i + 1 < argc) {
+      s_input_frames = std::strtoul(argv[++i], nullptr, 10);
+      if (s_input_frames == 0) return false;
+    } else if (strcmp(argv[i], "--submit-bench") == 0 && i + 1 < argc) {
+      s_submit_passes = std::strtoul(argv[++i], nullptr, 10);
+      if (s_submit_passes == 0) return false;
+    } else if (strcmp(argv[i], "--resolutions") == 0 && i + 1 < argc) {
+      for (char* p = argv[++i]; *p != '\0';) {
+        wsi::extent2d extent;
+        extent.width = std::strtol(p, &p, 10);
+        if (*p++ != 'x') return false;
+        extent.height = std::strtol(p, &p, 10);
+        if (extent.width <= 0 || extent.height <= 0) return false;
+        s_resolutions.push_back(extent);
+        if (*p == ',') ++p;
+      }
+    } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      for (char* p = argv[++i]; *p != '\0';) {
+        char* end;
+        long const samples = std::strtol(p, &end, 10);
+        if (end == p || (*end != ',' && *end != '\0')) return false;
+        // A single VkSampleCountFlagBits bit, 1 to 64
+        if (samples < 1 || samples > 64 || (samples & (samples - 1)) != 0) {
+          return false;
+        }
+        s_samples.push_back(static_cast<VkSampleCountFlagBits>(samples));
+        p = *end == ',' ? end + 1 : end;
+      }
+    } else if (strcmp(argv[i], "--opt-levels") == 0 && i + 1 < argc) {
+      for (char* p = std::strtok(argv[++i], ","); p;
+           p = std::strtok(nullptr, ",")) {
+        optimization_levels level;
+        if (!from_string(p, level)) return false;
+        s_levels.push_back(level);
+      }
+    } else if (strcmp(argv[i], "--spirv-opt") == 0) {
+      s_spirv_opt = true;
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      s_output = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      s_trace = argv[++i];
+    } else if (argv[i][0] == '-') {
+      return false;
+    } else {
+      s_shaders.push_back(argv[i]);
+    }
+  }
+
+  if (s_resolutions.empty()) {
+    int const defaults[][2] = {{640, 360}, {1280, 720}, {1920, 1080}};
+    for (auto&& wh : defaults) {
+      wsi::extent2d extent;
+      extent.width = wh[0];
+      extent.height = wh[1];
+      s_resolutions.push_back(extent);
+    }
+  }
+
+  if (s_samples.empty()) {
+    s_samples = {VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_4_BIT};
+  }
+  if (s_levels.empty()) {
+    s_levels = {optimization_levels::zero, optimization_levels::size,
+                optimization_levels::performance};
+  }
+  if (s_shaders.empty()) {
+    s_shaders.push_back(PROJECT_DIR "/assets/shaders/shadertoy.frag");
+  }
+
+  return true;
+} // parse_options
+
+int main(int argc, char* argv[]) {
+  std::error_code ec;
+
+  plat::init_logging("st_bench.log", ec);
+  if (ec) std::exit(EXIT_FAILURE);
+
+  if (!parse_options(argc, argv)) {
+    usage();
+    std::exit(EXIT_FAILURE);
+  }
+
+  if (s_include_depth > 0) return stress_includes();
+  if (s_reads > 0) return bench_reads();
+  if (s_dumps > 0) return bench_dumps();
+  if (s_input_frames > 0) return bench_input();
+  if (s_submit_passes > 0) return bench_submits();
+
+  if (!s_trace.empty()) plat::profile::start();
+
+  auto opts = renderer_options::headless;
+  if (s_igpu) opts = opts | renderer_options::use_integrated_gpu;
+  if (!s_timeline) opts = opts | renderer_options::no_timeline_semaphore;
+
+  renderer r = renderer::create("st_bench", opts, &debug_report,
+                                sizeof(push_constant_uniform_block), ec);
+  if (ec) {
+    LOG_FATAL("creating renderer failed: %s", ec.message().c_str());
+    std::fprintf(stderr, "creating renderer failed: %s\n",
+                 ec.message().c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  shader vshader = r.create_shader(PROJECT_DIR "/assets/shaders/fsq.vert",
+                                   shader::types::vertex, ec);
+  if (ec) {
+    LOG_FATAL("creating shader " PROJECT_DIR
+              "/assets/shaders/fsq.vert failed: %s",
+              ec.message().c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  VkPipelineLayout layout = create_shadertoy_pipeline_layout(r, ec);
+  if (ec) {
+    LOG_FATAL("creating pipeline layout failed: %s", ec.message().c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<result> results;
+  results.reserve(s_shaders.size() * s_levels.size());
+
+  for (auto&& path : s_shaders) {
+    for (auto&& level : s_levels) {
+      result res;
+      res.shader = path;
+      res.opt.level = level;
+      res.opt.spirv_opt = s_spirv_opt;
+
+      auto const start = bench_clock::now();
+      shader fshader =
+        r.create_shader(path, shader::types::fragment, res.opt, ec);
+      res.compile_ms = to_ms(bench_clock::now() - start);
+
+      if (ec) {
+        res.error = ec.message() +
+                    (fshader.error_message().empty() ? "" : "\n") +
+                    fshader.error_message();
+        LOG_ERROR("creating shader %s failed: %s", path.string().c_str(),
+                  res.error.c_str());
+        results.push_back(std::move(res));
+        continue;
+      }
+
+      if (s_reloads > 0) bench_reload(r, res);
+
+      // Create the variant for every sample count in one batch. Each one is
+      // created against the render pass of a 1x1 template surface, which is
+      // compatible with the render pass of any surface with the same sample
+      // count, so the runs at every resolution share them.
+      wsi::extent2d template_extent;
+      template_extent.width = template_extent.height = 1;
+
+      std::vector<surface> templates;
+      std::vector<shadertoy_variant> variants;
+      shadertoy_pipelines pipelines{vshader, fshader, layout};
+
+      for (auto&& samples : s_samples) {
+        surface s = r.create_surface(template_extent, samples, ec);
+        if (ec) break;
+        variants.push_back({s.render_pass(), samples, {}});
+        templates.push_back(std::move(s));
+      }
+
+      if (!ec) {
+        auto const pipelines_start = bench_clock::now();
+        pipelines.create(r, variants, ec);
+        res.pipelines_ms = to_ms(bench_clock::now() - pipelines_start);
+      }
+
+      if (ec) {
+        res.error = "creating pipelines failed: " + ec.message();
+        LOG_ERROR("%s: %s", path.string().c_str(), res.error.c_str());
+      } else {
+        for (auto&& extent : s_resolutions) {
+          for (auto&& variant : variants) {
+            VkPipeline pipeline = pipelines.get(r, variant, ec);
+            res.runs.push_back(
+              bench(r, pipeline, layout, extent, variant.samples));
+          }
+        }
+      }
+
+      pipelines.destroy(r);
+      for (auto&& s : templates) r.destroy(s);
+      r.destroy(fshader);
+      results.push_back(std::move(res));
+    }
+  }
+
+  r.destroy(layout);
+  r.destroy(vshader);
+
+  auto const output = open_output();
+  if (!output) std::exit(EXIT_FAILURE);
+  std::FILE* fh = output.get();
+
+  write_json(fh, r, results);
+
+  if (!s_trace.empty()) {
+    plat::profile::stop();
+    plat::profile::write_chrome_trace(s_trace, ec);
+    if (ec) {
+      LOG_ERROR("writing trace %s failed: %s", s_trace.string().c_str(),
+                ec.message().c_str());
+    }
+  }
+
+  return 0;
+}
@@ -2,9 +2,12 @@
 #define VKST_VK_RESULT_H
 
 #include <turf/c/core.h>
+#include "wsi/wsi_config.h"
 
 #ifdef TURF_TARGET_WIN32
 #  define VK_USE_PLATFORM_WIN32_KHR
+#elif WSI_XCB
+#  define VK_USE_PLATFORM_XCB_KHR
 #else
 #  define VK_USE_PLATFORM_XLIB_KHR
 #endif
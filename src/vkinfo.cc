@@ -411,6 +411,8 @@ VkInstance create_instance(std::error_code& ec) {
     VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME};
 #if TURF_TARGET_WIN32
   enabled_extension_names.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#elif TURF_KERNEL_LINUX && WSI_XCB
+  enabled_extension_names.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #elif TURF_KERNEL_LINUX
   enabled_extension_names.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
 #endif
@@ -495,6 +497,17 @@ VkSurfaceKHR create_surface(VkInstance instance, wsi::window const& win,
 
   rslt = vkCreateWin32SurfaceKHR(instance, &create_info, nullptr, &sfc);
 
+#elif TURF_KERNEL_LINUX && WSI_XCB
+
+  VkXcbSurfaceCreateInfoKHR create_info;
+  create_info.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+  create_info.pNext = nullptr;
+  create_info.flags = 0;
+  create_info.connection = std::get<0>(native);
+  create_info.window = std::get<2>(native);
+
+  rslt = vkCreateXcbSurfaceKHR(instance, &create_info, nullptr, &sfc);
+
 #elif TURF_KERNEL_LINUX
 
   VkXlibSurfaceCreateInfoKHR create_info;
@@ -9,20 +9,69 @@ wsi::input::input(gsl::not_null<window*> win) noexcept
 : _win{win}
 , _prev_keys{}
 , _curr_keys{}
+, _pressed_keys{}
+, _released_keys{}
 , _prev_buttons{}
 , _curr_buttons{}
+, _pressed_buttons{}
+, _released_buttons{}
 , _prev_scroll{0}
 , _curr_scroll{0}
 , _prev_pos{}
-, _curr_pos{} {} // wsi::input::input(
+, _curr_pos{}
+, _events{}
+, _dropped_events{0} {
+  _events.reserve(input_event_queue::capacity());
+} // wsi::input::input(
 
 void wsi::input::tick() noexcept {
-  _prev_keys = std::move(_curr_keys);
-  _curr_keys = _win->keys();
-  _prev_buttons = std::move(_curr_buttons);
-  _curr_buttons = _win->buttons();
+  _prev_keys = _curr_keys;
+  _prev_buttons = _curr_buttons;
   _prev_scroll = _curr_scroll;
-  _curr_scroll = _win->scroll();
   _prev_pos = std::move(_curr_pos);
+
+  _pressed_keys = {};
+  _released_keys = {};
+  _pressed_buttons = {};
+  _released_buttons = {};
+  _events.clear();
+
+  // Replay the events in order so a press and release between two ticks
+  // are both seen, then check the state against the window's in case
+  // events were dropped.
+  if (auto queue = _win->input_events()) {
+    input_event ev;
+    while (queue->pop(ev)) {
+      switch (ev.type) {
+      case input_event::types::key_press:
+        _pressed_keys.set(ev.key);
+        _curr_keys.set(ev.key);
+        break;
+      case input_event::types::key_release:
+        _released_keys.set(ev.key);
+        _curr_keys.reset(ev.key);
+        break;
+      case input_event::types::button_press:
+        _pressed_buttons.set(ev.button);
+        _curr_buttons.set(ev.button);
+        break;
+      case input_event::types::button_release:
+        _released_buttons.set(ev.button);
+        _curr_buttons.reset(ev.button);
+        break;
+      case input_event::types::scroll: _curr_scroll += ev.scroll; break;
+      }
+      _events.push_back(ev);
+    }
+  }
+
+  // The window's count only grows, so resync only when it has grown since
+  // the last tick rather than on every tick after the first drop.
+  auto const dropped = _win->dropped_input_events();
+  if (dropped != _dropped_events) {
+    _curr_keys = _win->keys();
+    _curr_buttons = _win->buttons();
+    _dropped_events = dropped;
+  }
   _curr_pos = _win->cursor_pos();
 } // wsi::input::tick()
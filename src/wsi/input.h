@@ -1,9 +1,12 @@
 #ifndef VKST_WSI_INPUT_H
 #define VKST_WSI_INPUT_H
 
+#include <plat/spsc_queue.h>
 #include <gsl.h>
 #include <wsi/types.h>
 #include <bitset>
+#include <chrono>
+#include <vector>
 
 namespace wsi {
 
@@ -206,36 +209,63 @@ public:
   }
 }; // class buttonset
 
+// One key, button or scroll event, as the window system reported it.
+struct input_event {
+  enum class types : uint8_t {
+    key_press,
+    key_release,
+    button_press,
+    button_release,
+    scroll,
+  }; // enum class types
+
+  types type{types::key_press};
+  keys key{keys::eUnknown};    // key_press and key_release
+  buttons button{buttons::e1}; // button_press and button_release
+  int scroll{0};               // scroll steps, in the sign scroll() uses
+  offset2d pos{};              // pointer position in the window, if known
+
+  // When the event happened in the window system's clock: the X server time
+  // or GetMessageTime, both in milliseconds and wrapping at 2^32.
+  uint32_t time{0};
+
+  // When the window read the event from the window system.
+  std::chrono::steady_clock::time_point received{};
+}; // struct input_event
+
+// Events travel from the window to an input through this queue. Events
+// arriving while it is full are dropped and counted by the window.
+using input_event_queue = plat::spsc_queue<input_event, 1024>;
+
 class window;
 
 class input final {
 public:
   input(gsl::not_null<window*> win) noexcept;
 
-  bool key_pressed(keys key) const noexcept {
-    return !_prev_keys[key] && _curr_keys[key];
-  }
-
-  bool key_released(keys key) const noexcept {
-    return _prev_keys[key] && !_curr_keys[key];
-  }
+  // A key or button pressed or released at any point since the previous tick
+  // is reported as pressed or released by this tick, even if it went back
+  // up or down again before it.
+  bool key_pressed(keys key) const noexcept { return _pressed_keys[key]; }
+  bool key_released(keys key) const noexcept { return _released_keys[key]; }
 
   bool key_down(keys key) const noexcept {
     return _prev_keys[key] && _curr_keys[key];
   }
 
   bool button_pressed(buttons button) const noexcept {
-    return !_prev_buttons[button] && _curr_buttons[button];
+    return _pressed_buttons[button];
   }
 
   bool button_released(buttons button) const noexcept {
-    return _prev_buttons[button] && !_curr_buttons[button];
+    return _released_buttons[button];
   }
 
   bool button_down(buttons button) const noexcept {
     return _prev_buttons[button] && _curr_buttons[button];
   }
 
+  // The sum of every scroll event so far, as of the previous and this tick.
   int prev_scroll() const noexcept { return _prev_scroll; }
   int curr_scroll() const noexcept { return _curr_scroll; }
 
@@ -248,14 +278,22 @@ public:
 
   offset2d cursor_delta() const noexcept { return _curr_pos - _prev_pos; }
 
+  // Every event taken from the window by the last tick, oldest first.
+  gsl::span<input_event const> events() const noexcept { return _events; }
+
+  // Take the events the window has queued since the previous tick.
   void tick() noexcept;
 
 private:
   window* _win;
   keyset _prev_keys, _curr_keys;
+  keyset _pressed_keys, _released_keys;
   buttonset _prev_buttons, _curr_buttons;
+  buttonset _pressed_buttons, _released_buttons;
   int _prev_scroll, _curr_scroll;
   offset2d _prev_pos, _curr_pos;
+  std::vector<input_event> _events;
+  uint64_t _dropped_events; // the window's dropped count as of the last tick
 }; // class input
 
 } // namespace wsi
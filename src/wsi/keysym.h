@@ -0,0 +1,138 @@
+#ifndef VKST_WSI_KEYSYM_H
+#define VKST_WSI_KEYSYM_H
+
+#include <wsi/input.h>
+#include <X11/keysym.h>
+
+namespace wsi {
+
+// Map an X keysym to a key. Shared by the Xlib and XCB windows, which look
+// up the keysyms of each keycode in their own way.
+inline keys translate_keysym(uint32_t keysym) noexcept {
+  switch (keysym) {
+  case XK_BackSpace: return keys::eBackspace;
+  case XK_Tab: return keys::eTab;
+  case XK_Return: return keys::eEnter;
+  case XK_Pause: return keys::ePause;
+  case XK_Scroll_Lock: return keys::eScrollLock;
+  case XK_Escape: return keys::eEscape;
+  case XK_Delete: return keys::eDelete;
+
+  case XK_Home: return keys::eHome;
+  case XK_Left: return keys::eLeft;
+  case XK_Up: return keys::eUp;
+  case XK_Down: return keys::eDown;
+  case XK_Page_Up: return keys::ePageUp;
+  case XK_Page_Down: return keys::ePageDown;
+  case XK_End: return keys::eEnd;
+
+  case XK_Insert: return keys::eInsert;
+  case XK_Num_Lock: return keys::eNumLock;
+
+  case XK_KP_Enter: return keys::eKeypadEnter;
+  case XK_KP_Home: return keys::eKeypad7;
+  case XK_KP_Left: return keys::eKeypad4;
+  case XK_KP_Up: return keys::eKeypad8;
+  case XK_KP_Right: return keys::eKeypad6;
+  case XK_KP_Down: return keys::eKeypad2;
+  case XK_KP_Page_Up: return keys::eKeypad9;
+  case XK_KP_Page_Down: return keys::eKeypad3;
+  case XK_KP_End: return keys::eKeypad1;
+  case XK_KP_Insert: return keys::eKeypad0;
+  case XK_KP_Delete: return keys::eKeypadDecimal;
+  case XK_KP_Multiply: return keys::eKeypadMultiply;
+  case XK_KP_Add: return keys::eKeypadAdd;
+  case XK_KP_Subtract: return keys::eKeypadSubtract;
+  case XK_KP_Divide: return keys::eKeypadDivide;
+
+  case XK_F1: return keys::eF1;
+  case XK_F2: return keys::eF2;
+  case XK_F3: return keys::eF3;
+  case XK_F4: return keys::eF4;
+  case XK_F5: return keys::eF5;
+  case XK_F6: return keys::eF6;
+  case XK_F7: return keys::eF7;
+  case XK_F8: return keys::eF8;
+  case XK_F9: return keys::eF9;
+  case XK_F10: return keys::eF10;
+  case XK_F11: return keys::eF11;
+  case XK_F12: return keys::eF12;
+  case XK_F13: return keys::eF13;
+  case XK_F14: return keys::eF14;
+  case XK_F15: return keys::eF15;
+  case XK_F16: return keys::eF16;
+  case XK_F17: return keys::eF17;
+  case XK_F18: return keys::eF18;
+  case XK_F19: return keys::eF19;
+  case XK_F20: return keys::eF20;
+  case XK_F21: return keys::eF21;
+  case XK_F22: return keys::eF22;
+  case XK_F23: return keys::eF23;
+  case XK_F24: return keys::eF24;
+  case XK_F25: return keys::eF25;
+
+  case XK_Shift_L: return keys::eLeftShift;
+  case XK_Shift_R: return keys::eRightShift;
+  case XK_Control_L: return keys::eLeftControl;
+  case XK_Control_R: return keys::eRightControl;
+  case XK_Caps_Lock: return keys::eCapsLock;
+  case XK_Meta_L: return keys::eLeftAlt;
+  case XK_Meta_R: return keys::eRightAlt;
+  case XK_Super_L: return keys::eLeftSuper;
+  case XK_Super_R: return keys::eRightSuper;
+
+  case XK_space: return keys::eSpace;
+  case XK_apostrophe: return keys::eApostrophe;
+  case XK_comma: return keys::eComma;
+  case XK_minus: return keys::eMinus;
+  case XK_period: return keys::ePeriod;
+  case XK_slash: return keys::eSlash;
+  case XK_0: return keys::e0;
+  case XK_1: return keys::e1;
+  case XK_2: return keys::e2;
+  case XK_3: return keys::e3;
+  case XK_4: return keys::e4;
+  case XK_5: return keys::e5;
+  case XK_6: return keys::e6;
+  case XK_7: return keys::e7;
+  case XK_8: return keys::e8;
+  case XK_9: return keys::e9;
+  case XK_semicolon: return keys::eSemicolon;
+  case XK_equal: return keys::eEqual;
+  case XK_A: return keys::eA;
+  case XK_B: return keys::eB;
+  case XK_C: return keys::eC;
+  case XK_D: return keys::eD;
+  case XK_E: return keys::eE;
+  case XK_F: return keys::eF;
+  case XK_G: return keys::eG;
+  case XK_H: return keys::eH;
+  case XK_I: return keys::eI;
+  case XK_J: return keys::eJ;
+  case XK_K: return keys::eK;
+  case XK_L: return keys::eL;
+  case XK_M: return keys::eM;
+  case XK_N: return keys::eN;
+  case XK_O: return keys::eO;
+  case XK_P: return keys::eP;
+  case XK_Q: return keys::eQ;
+  case XK_R: return keys::eR;
+  case XK_S: return keys::eS;
+  case XK_T: return keys::eT;
+  case XK_U: return keys::eU;
+  case XK_V: return keys::eV;
+  case XK_W: return keys::eW;
+  case XK_X: return keys::eX;
+  case XK_Y: return keys::eY;
+  case XK_Z: return keys::eZ;
+  case XK_bracketleft: return keys::eLeftBracket;
+  case XK_backslash: return keys::eBackslash;
+  case XK_bracketright: return keys::eRightBracket;
+  case XK_grave: return keys::eGraveAccent;
+  }
+  return keys::eUnknown;
+} // translate_keysym
+
+} // namespace wsi
+
+#endif // VKST_WSI_KEYSYM_H
@@ -1,9 +1,12 @@
 #ifndef VKST_WSI_WINDOW_H
 #define VKST_WSI_WINDOW_H
 
+#include <plat/event_loop.h>
 #include <turf/c/core.h>
+#include "wsi/wsi_config.h"
 #include <gsl.h>
 #include <wsi/input.h>
+#include <chrono>
 #include <functional>
 
 namespace wsi {
@@ -49,12 +52,31 @@ public:
   buttonset const& buttons() const noexcept { return _buttons; }
   int scroll() const noexcept { return _scroll; }
 
+  // Key, button and scroll events in the order they arrived, timestamped.
+  // The window pushes them as it handles events and an input pops them.
+  // Null until the window is created.
+  input_event_queue* input_events() noexcept { return _input_events.get(); }
+
+  // Events lost because the input event queue was full.
+  uint64_t dropped_input_events() const noexcept { return _dropped_input; }
+
   offset2d cursor_pos() const noexcept {
     return static_cast<D const*>(this)->do_cursor_pos();
   }
 
   void poll_events() noexcept { static_cast<D*>(this)->do_poll_events(); }
 
+  // Sleep until the window has events, a source added to events() is ready
+  // or timeout passes, then run the ready sources' callbacks and handle the
+  // window events as poll_events does. A timeout of zero does not sleep.
+  void wait_events(std::chrono::nanoseconds timeout) noexcept {
+    static_cast<D*>(this)->do_wait_events(timeout);
+  }
+
+  // The event loop wait_events sleeps in. Add file descriptors or timers
+  // to it to wake the window's thread for them too.
+  plat::event_loop& events() noexcept { return _events; }
+
   using resize_delegate = std::function<void(D*, extent2d const&)>;
   void on_resize(resize_delegate delegate) noexcept {
     _on_resize = std::move(delegate);
@@ -75,11 +97,18 @@ public:
   : _topleft_size{std::move(topleft_size)} {}
 
 protected:
+  void push_input(input_event const& ev) noexcept {
+    if (!_input_events->push(ev)) _dropped_input += 1;
+  }
+
   rect2d _topleft_size{};
   bool _closed{false};
   keyset _keys{};
   buttonset _buttons{};
   int _scroll{0};
+  plat::event_loop _events{};
+  gsl::unique_ptr<input_event_queue> _input_events{};
+  uint64_t _dropped_input{0};
 
   resize_delegate _on_resize{[](auto, auto) {}};
   reposition_delegate _on_reposition{[](auto, auto) {}};
@@ -103,6 +132,8 @@ inline constexpr auto operator&(window_options a, window_options b) noexcept {
 // clang-format off
 #if TURF_TARGET_WIN32
 #  include <wsi/window_win32.h>
+#elif TURF_KERNEL_LINUX && WSI_XCB
+#  include <wsi/window_xcb.h>
 #elif TURF_KERNEL_LINUX
 #  include <wsi/window_xlib.h>
 #else
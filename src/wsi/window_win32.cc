@@ -3,6 +3,7 @@
 #if TURF_TARGET_WIN32
 #include <algorithm>
 #include <shellapi.h>
+#include <windowsx.h>
 #include <type_traits>
 
 namespace {
@@ -198,6 +199,8 @@ wsi::window wsi::window::create(rect2d topleft_size, gsl::czstring title,
     SetWindowLong(w._handle, GWL_STYLE, 0);
   }
 
+  w._input_events = gsl::make_unique<input_event_queue>();
+
   w.retitle(title);
   return w;
 } // wsi::window::create
@@ -286,27 +289,62 @@ void wsi::window::do_poll_events() noexcept {
   }
 } // wsi::window::do_poll_events()
 
+void wsi::window::do_wait_events(std::chrono::nanoseconds timeout) noexcept {
+  // The loop's wait also ends when a message arrives for this thread
+  _events.wait(timeout);
+  do_poll_events();
+} // wsi::window::do_wait_events()
+
 LRESULT wsi::window::wnd_proc(UINT uMsg, WPARAM wParam,
                               LPARAM lParam) noexcept {
+  using types = input_event::types;
+
+  input_event ev;
+  auto const push = [&](types type) {
+    ev.type = type;
+    ev.time = static_cast<uint32_t>(GetMessageTime());
+    ev.received = std::chrono::steady_clock::now();
+    push_input(ev);
+  };
+
+  auto const key = [&](types type) {
+    ev.key = _key_lut[wParam];
+    if (type == types::key_press) _keys.set(ev.key);
+    else _keys.reset(ev.key);
+    push(type);
+  };
+
+  auto const button = [&](types type, buttons b) {
+    ev.button = b;
+    ev.pos = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
+    if (type == types::button_press) _buttons.set(b);
+    else _buttons.reset(b);
+    push(type);
+  };
+
+  auto const xbutton = [wParam]() {
+    return (GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? buttons::e4
+                                                    : buttons::e5;
+  };
+
   switch (uMsg) {
-  case WM_KEYDOWN: _keys.set(_key_lut[wParam]); return 0;
-  case WM_KEYUP: _keys.reset(_key_lut[wParam]); return 0;
-  case WM_LBUTTONDOWN: _buttons.set(buttons::e1); return 0;
-  case WM_MBUTTONDOWN: _buttons.set(buttons::e2); return 0;
-  case WM_RBUTTONDOWN: _buttons.set(buttons::e3); return 0;
-  case WM_XBUTTONDOWN:
-    _buttons.set((GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? buttons::e4
-                                                          : buttons::e5);
-    return 0;
-  case WM_LBUTTONUP: _buttons.reset(buttons::e1); return 0;
-  case WM_MBUTTONUP: _buttons.reset(buttons::e2); return 0;
-  case WM_RBUTTONUP: _buttons.reset(buttons::e3); return 0;
-  case WM_XBUTTONUP:
-    _buttons.reset((GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? buttons::e4
-                                                            : buttons::e5);
+  case WM_KEYDOWN:
+    // Bit 30 is set on auto-repeat, which is not a new press
+    if ((lParam & (1 << 30)) == 0) key(types::key_press);
     return 0;
+  case WM_KEYUP: key(types::key_release); return 0;
+  case WM_LBUTTONDOWN: button(types::button_press, buttons::e1); return 0;
+  case WM_MBUTTONDOWN: button(types::button_press, buttons::e2); return 0;
+  case WM_RBUTTONDOWN: button(types::button_press, buttons::e3); return 0;
+  case WM_XBUTTONDOWN: button(types::button_press, xbutton()); return 0;
+  case WM_LBUTTONUP: button(types::button_release, buttons::e1); return 0;
+  case WM_MBUTTONUP: button(types::button_release, buttons::e2); return 0;
+  case WM_RBUTTONUP: button(types::button_release, buttons::e3); return 0;
+  case WM_XBUTTONUP: button(types::button_release, xbutton()); return 0;
   case WM_MOUSEWHEEL:
-    _scroll += GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+    ev.scroll = GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+    _scroll += ev.scroll;
+    push(types::scroll);
     return 0;
   case WM_SIZE:
     _topleft_size.extent = {LOWORD(lParam), HIWORD(lParam)};
@@ -49,6 +49,7 @@ private:
   offset2d do_cursor_pos() const noexcept;
 
   void do_poll_events() noexcept;
+  void do_wait_events(std::chrono::nanoseconds timeout) noexcept;
 
   LRESULT wnd_proc(UINT uMsg, WPARAM wParam, LPARAM lParam) noexcept;
   static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam,
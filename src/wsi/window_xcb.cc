@@ -0,0 +1,443 @@
+#include "window.h"
+#include <plat/core.h>
+
+#if TURF_KERNEL_LINUX && WSI_XCB
+#include <wsi/keysym.h>
+#include <cstring>
+
+namespace {
+
+// ICCCM values that Xlib's Xutil.h would provide
+constexpr uint32_t STATE_HINT = (1 << 1); // WM_HINTS flags
+constexpr uint32_t NORMAL_STATE = 1;
+constexpr uint32_t P_MIN_SIZE = (1 << 4); // WM_NORMAL_HINTS flags
+constexpr uint32_t P_MAX_SIZE = (1 << 5);
+constexpr uint32_t P_WIN_GRAVITY = (1 << 9);
+
+uint8_t event_type(xcb_generic_event_t const* ev) noexcept {
+  // The top bit is set on events sent with SendEvent
+  return ev->response_type & 0x7F;
+} // event_type
+
+} // namespace
+
+wsi::window wsi::window::create(rect2d topleft_size, gsl::czstring title,
+                                window_options opts, int screen_number,
+                                std::error_code& ec) noexcept {
+  window w{std::move(topleft_size)};
+
+  int default_screen = 0;
+  w._connection = xcb_connect(nullptr, &default_screen);
+  if (xcb_connection_has_error(w._connection)) {
+    ec.assign(ECONNREFUSED, std::generic_category());
+    return w;
+  }
+
+  xcb_setup_t const* setup = xcb_get_setup(w._connection);
+  auto screens = xcb_setup_roots_iterator(setup);
+  if (screen_number < 0) screen_number = default_screen;
+  for (int i = 0; i < screen_number && screens.rem > 0; ++i) {
+    xcb_screen_next(&screens);
+  }
+  if (screens.rem == 0) {
+    ec.assign(EINVAL, std::generic_category());
+    return w;
+  }
+
+  xcb_screen_t const* screen = screens.data;
+  w._visual = screen->root_visual;
+
+  // Send every request with a reply before waiting for any of them, so
+  // startup costs one round trip to the server rather than one per request.
+  std::array<xcb_intern_atom_cookie_t, NUM_ATOMS> atom_cookies;
+  for (int i = 0; i < NUM_ATOMS; ++i) {
+    gsl::czstring name = atom_to_string(static_cast<Atoms>(i));
+    atom_cookies[i] = xcb_intern_atom(
+      w._connection, 0, static_cast<uint16_t>(std::strlen(name)), name);
+  }
+
+  xcb_keycode_t const min_keycode = setup->min_keycode;
+  xcb_keycode_t const max_keycode = setup->max_keycode;
+  auto const mapping_cookie = xcb_get_keyboard_mapping(
+    w._connection, min_keycode,
+    static_cast<uint8_t>(max_keycode - min_keycode + 1));
+
+  // The values are in the order of their bits in the mask
+  std::array<uint32_t, 3> const values{{
+    0, // border pixel
+    XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_KEY_PRESS |
+      XCB_EVENT_MASK_KEY_RELEASE | XCB_EVENT_MASK_BUTTON_PRESS |
+      XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION |
+      XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_EXPOSURE |
+      XCB_EVENT_MASK_VISIBILITY_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE,
+    screen->default_colormap,
+  }};
+
+  w._handle = xcb_generate_id(w._connection);
+  auto const create_cookie = xcb_create_window_checked(
+    w._connection, screen->root_depth, w._handle, screen->root,
+    static_cast<int16_t>(w._topleft_size.offset.x),
+    static_cast<int16_t>(w._topleft_size.offset.y),
+    static_cast<uint16_t>(w._topleft_size.extent.width),
+    static_cast<uint16_t>(w._topleft_size.extent.height), 0,
+    XCB_WINDOW_CLASS_INPUT_OUTPUT, w._visual,
+    XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_COLORMAP, values.data());
+
+  // Motion and enter events keep the cursor position current after this
+  auto const pointer_cookie = xcb_query_pointer(w._connection, w._handle);
+
+  for (int i = 0; i < NUM_ATOMS; ++i) {
+    reply<xcb_intern_atom_reply_t> atom{
+      xcb_intern_atom_reply(w._connection, atom_cookies[i], nullptr)};
+    w._atoms[i] = atom ? atom->atom : xcb_atom_t{XCB_ATOM_NONE};
+  }
+
+  reply<xcb_get_keyboard_mapping_reply_t> mapping{
+    xcb_get_keyboard_mapping_reply(w._connection, mapping_cookie, nullptr)};
+  if (mapping) {
+    xcb_keysym_t const* syms = xcb_get_keyboard_mapping_keysyms(mapping.get());
+    auto const per_keycode = mapping->keysyms_per_keycode;
+    for (int k = min_keycode; k <= max_keycode; ++k) {
+      w._key_lut[k] = translate_keysym(syms[(k - min_keycode) * per_keycode]);
+    }
+  }
+
+  reply<xcb_query_pointer_reply_t> pointer{
+    xcb_query_pointer_reply(w._connection, pointer_cookie, nullptr)};
+  if (pointer) w._cursor_pos = {pointer->win_x, pointer->win_y};
+
+  if (reply<xcb_generic_error_t> error{
+        xcb_request_check(w._connection, create_cookie)}) {
+    w._handle = 0;
+    ec.assign(EINVAL, std::generic_category());
+    return w;
+  }
+
+  xcb_change_property(w._connection, XCB_PROP_MODE_REPLACE, w._handle,
+                      w._atoms[WM_PROTOCOLS], XCB_ATOM_ATOM, 32, 1,
+                      &w._atoms[WM_DELETE_WINDOW]);
+
+  if ((opts & window_options::decorated) != window_options::decorated) {
+    // flags, functions, decorations, input mode, status: no decorations
+    std::array<uint32_t, 5> const hints{{2, 0, 0, 0, 0}};
+    xcb_change_property(w._connection, XCB_PROP_MODE_REPLACE, w._handle,
+                        w._atoms[_MOTIF_WM_HINTS], w._atoms[_MOTIF_WM_HINTS],
+                        32, hints.size(), hints.data());
+  }
+
+  // flags, input, initial_state, then icon and group fields left unset
+  std::array<uint32_t, 9> const wm_hints{{STATE_HINT, 0, NORMAL_STATE}};
+  xcb_change_property(w._connection, XCB_PROP_MODE_REPLACE, w._handle,
+                      XCB_ATOM_WM_HINTS, XCB_ATOM_WM_HINTS, 32,
+                      wm_hints.size(), wm_hints.data());
+
+  // flags, x, y, width, height, min and max size, increments, aspects, base
+  // size, gravity
+  std::array<uint32_t, 18> size_hints{};
+  size_hints[0] = P_WIN_GRAVITY;
+  size_hints[17] = XCB_GRAVITY_STATIC;
+  if ((opts & window_options::sizeable) != window_options::sizeable) {
+    size_hints[0] |= P_MIN_SIZE | P_MAX_SIZE;
+    size_hints[5] = size_hints[7] =
+      static_cast<uint32_t>(w._topleft_size.extent.width);
+    size_hints[6] = size_hints[8] =
+      static_cast<uint32_t>(w._topleft_size.extent.height);
+  }
+  xcb_change_property(w._connection, XCB_PROP_MODE_REPLACE, w._handle,
+                      XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_SIZE_HINTS, 32,
+                      size_hints.size(), size_hints.data());
+
+  w.retitle(title);
+
+  w._input_events = gsl::make_unique<input_event_queue>();
+
+  // The callback is empty: wait_events handles whatever arrives
+  w._events.add(xcb_get_file_descriptor(w._connection), {}, ec);
+  return w;
+} // wsi::window::create
+
+wsi::window::window(window&& other) noexcept
+: impl::window<window>{std::move(other)}
+, _connection{other._connection}
+, _visual{other._visual}
+, _handle{other._handle}
+, _cursor_pos{other._cursor_pos}
+, _next_event{std::move(other._next_event)}
+, _key_lut{other._key_lut}
+, _atoms{other._atoms} {
+  other._connection = nullptr;
+  other._handle = 0;
+} // wsi::window::window(
+
+wsi::window& wsi::window::operator=(window&& rhs) noexcept {
+  if (this == &rhs) return *this;
+
+  if (_connection) {
+    if (_handle) xcb_destroy_window(_connection, _handle);
+    xcb_disconnect(_connection);
+  }
+
+  impl::window<window>::operator=(std::move(rhs));
+  _connection = rhs._connection;
+  _visual = rhs._visual;
+  _handle = rhs._handle;
+  _cursor_pos = rhs._cursor_pos;
+  _next_event = std::move(rhs._next_event);
+  _key_lut = rhs._key_lut;
+  _atoms = rhs._atoms;
+
+  rhs._connection = nullptr;
+  rhs._handle = 0;
+  return *this;
+} // wsi::window::operator=(
+
+wsi::window::~window() noexcept {
+  if (!_connection) return;
+  _next_event.reset();
+  if (_handle) xcb_destroy_window(_connection, _handle);
+  xcb_disconnect(_connection);
+} // wsi::window::~window()
+
+void wsi::window::do_retitle(gsl::czstring title) noexcept {
+  auto const len = static_cast<uint32_t>(std::strlen(title));
+  xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _handle,
+                      XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, len, title);
+  xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _handle,
+                      XCB_ATOM_WM_ICON_NAME, XCB_ATOM_STRING, 8, len, title);
+  xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _handle,
+                      _atoms[NET_WM_NAME], _atoms[UTF8_STRING], 8, len,
+                      title);
+  xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _handle,
+                      _atoms[NET_WM_ICON_NAME], _atoms[UTF8_STRING], 8, len,
+                      title);
+  xcb_flush(_connection);
+} // wsi::window::do_retitle(
+
+std::string wsi::window::do_title() const noexcept {
+  // The only round trip after create, and only when asked for
+  auto const cookie =
+    xcb_get_property(_connection, 0, _handle, _atoms[NET_WM_NAME],
+                     _atoms[UTF8_STRING], 0, 65536 / 4);
+  reply<xcb_get_property_reply_t> title{
+    xcb_get_property_reply(_connection, cookie, nullptr)};
+  if (!title) return {};
+
+  return std::string(static_cast<char const*>(
+                       xcb_get_property_value(title.get())),
+                     xcb_get_property_value_length(title.get()));
+} // wsi::window::do_title()
+
+void wsi::window::do_resize(extent2d const& size) noexcept {
+  std::array<uint32_t, 2> const values{{static_cast<uint32_t>(size.width),
+                                        static_cast<uint32_t>(size.height)}};
+  xcb_configure_window(_connection, _handle,
+                       XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+                       values.data());
+  xcb_flush(_connection);
+} // wsi::window::do_resize(
+
+void wsi::window::do_reposition(offset2d const& position) noexcept {
+  std::array<uint32_t, 2> const values{{static_cast<uint32_t>(position.x),
+                                        static_cast<uint32_t>(position.y)}};
+  xcb_configure_window(_connection, _handle,
+                       XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
+                       values.data());
+  xcb_flush(_connection);
+  _topleft_size.offset = position;
+} // wsi::window::do_reposition(
+
+void wsi::window::do_show() noexcept {
+  xcb_map_window(_connection, _handle);
+  xcb_flush(_connection);
+} // wsi::window::do_show()
+
+void wsi::window::do_hide() noexcept {
+  xcb_unmap_window(_connection, _handle);
+  xcb_flush(_connection);
+} // wsi::window::do_hide()
+
+void wsi::window::do_close() noexcept {
+  xcb_client_message_event_t ev = {};
+  ev.response_type = XCB_CLIENT_MESSAGE;
+  ev.format = 32;
+  ev.window = _handle;
+  ev.type = _atoms[WM_PROTOCOLS];
+  ev.data.data32[0] = _atoms[WM_DELETE_WINDOW];
+
+  xcb_send_event(_connection, 0, _handle, XCB_EVENT_MASK_NO_EVENT,
+                 reinterpret_cast<char const*>(&ev));
+  xcb_flush(_connection);
+} // wsi::window::do_close()
+
+wsi::window::event_ptr wsi::window::next_event() noexcept {
+  if (_next_event) return std::move(_next_event);
+  return event_ptr{xcb_poll_for_event(_connection)};
+} // wsi::window::next_event()
+
+void wsi::window::do_poll_events() noexcept {
+  while (auto ev = next_event()) handle_event(ev.get());
+} // wsi::window::do_poll_events()
+
+void wsi::window::do_wait_events(std::chrono::nanoseconds timeout) noexcept {
+  // Events XCB has already read from the connection do not wake the loop
+  xcb_flush(_connection);
+  if (!_next_event) {
+    _next_event.reset(xcb_poll_for_queued_event(_connection));
+  }
+  if (!_next_event) _events.wait(timeout);
+  do_poll_events();
+} // wsi::window::do_wait_events()
+
+void wsi::window::handle_event(xcb_generic_event_t const* ev) noexcept {
+  using types = input_event::types;
+
+  input_event input;
+  input.received = std::chrono::steady_clock::now();
+
+  switch (event_type(ev)) {
+  case XCB_KEY_PRESS: {
+    auto const key = reinterpret_cast<xcb_key_press_event_t const*>(ev);
+    if (key->event != _handle) break;
+    input.type = types::key_press;
+    input.key = _key_lut[key->detail];
+    input.pos = _cursor_pos = {key->event_x, key->event_y};
+    input.time = key->time;
+    _keys.set(input.key);
+    push_input(input);
+  } break;
+
+  case XCB_KEY_RELEASE: {
+    auto const key = reinterpret_cast<xcb_key_release_event_t const*>(ev);
+    if (key->event != _handle) break;
+
+    // Auto-repeat sends a KeyRelease and a KeyPress with identical window,
+    // time and keycode; the key wasn't physically released, so drop both
+    if (!_next_event) _next_event.reset(xcb_poll_for_event(_connection));
+    if (_next_event && event_type(_next_event.get()) == XCB_KEY_PRESS) {
+      auto const next =
+        reinterpret_cast<xcb_key_press_event_t const*>(_next_event.get());
+      if (next->event == _handle && next->time == key->time &&
+          next->detail == key->detail) {
+        _next_event.reset();
+        break;
+      }
+    }
+
+    input.type = types::key_release;
+    input.key = _key_lut[key->detail];
+    input.pos = _cursor_pos = {key->event_x, key->event_y};
+    input.time = key->time;
+    _keys.reset(input.key);
+    push_input(input);
+  } break;
+
+  case XCB_BUTTON_PRESS: {
+    auto const button = reinterpret_cast<xcb_button_press_event_t const*>(ev);
+    if (button->event != _handle) break;
+    input.type = types::button_press;
+    switch (button->detail) {
+    case XCB_BUTTON_INDEX_1: input.button = buttons::e1; break;
+    case XCB_BUTTON_INDEX_2: input.button = buttons::e2; break;
+    case XCB_BUTTON_INDEX_3: input.button = buttons::e3; break;
+    case XCB_BUTTON_INDEX_4:
+      _scroll = -1;
+      input.type = types::scroll;
+      input.scroll = -1;
+      break;
+    case XCB_BUTTON_INDEX_5:
+      _scroll = 1;
+      input.type = types::scroll;
+      input.scroll = 1;
+      break;
+    default:
+      input.button = static_cast<enum buttons>(button->detail - 4);
+      break;
+    }
+    if (input.type == types::button_press) _buttons.set(input.button);
+    input.pos = _cursor_pos = {button->event_x, button->event_y};
+    input.time = button->time;
+    push_input(input);
+  } break;
+
+  case XCB_BUTTON_RELEASE: {
+    auto const button =
+      reinterpret_cast<xcb_button_release_event_t const*>(ev);
+    if (button->event != _handle) break;
+    switch (button->detail) {
+    case XCB_BUTTON_INDEX_1: input.button = buttons::e1; break;
+    case XCB_BUTTON_INDEX_2: input.button = buttons::e2; break;
+    case XCB_BUTTON_INDEX_3: input.button = buttons::e3; break;
+    case XCB_BUTTON_INDEX_4:
+    case XCB_BUTTON_INDEX_5:
+      // A wheel step is a press and release; the press is the scroll event
+      _scroll = 0;
+      return;
+    default:
+      input.button = static_cast<enum buttons>(button->detail - 4);
+      break;
+    }
+    _buttons.reset(input.button);
+    input.type = types::button_release;
+    input.pos = _cursor_pos = {button->event_x, button->event_y};
+    input.time = button->time;
+    push_input(input);
+  } break;
+
+  case XCB_MOTION_NOTIFY: {
+    auto const motion = reinterpret_cast<xcb_motion_notify_event_t const*>(ev);
+    if (motion->event != _handle) break;
+    _cursor_pos = {motion->event_x, motion->event_y};
+  } break;
+
+  case XCB_ENTER_NOTIFY: {
+    auto const enter = reinterpret_cast<xcb_enter_notify_event_t const*>(ev);
+    if (enter->event != _handle) break;
+    _cursor_pos = {enter->event_x, enter->event_y};
+  } break;
+
+  case XCB_CLIENT_MESSAGE: {
+    auto const message =
+      reinterpret_cast<xcb_client_message_event_t const*>(ev);
+    if (message->type != _atoms[WM_PROTOCOLS]) break;
+    if (message->data.data32[0] == XCB_ATOM_NONE) break;
+
+    _closed = (message->data.data32[0] == _atoms[WM_DELETE_WINDOW]);
+    if (_closed) _on_close(this);
+  } break;
+
+  case XCB_CONFIGURE_NOTIFY: {
+    auto const configure =
+      reinterpret_cast<xcb_configure_notify_event_t const*>(ev);
+    if (configure->window != _handle) break;
+    if (_topleft_size.extent.width == configure->width &&
+        _topleft_size.extent.height == configure->height) {
+      if (_topleft_size.offset.x == configure->x &&
+          _topleft_size.offset.y == configure->y)
+        break;
+      _topleft_size.offset = {configure->x, configure->y};
+      _on_reposition(this, _topleft_size.offset);
+    } else {
+      _topleft_size.extent = {configure->width, configure->height};
+      _on_resize(this, _topleft_size.extent);
+    }
+  } break;
+
+  default: break;
+  }
+} // wsi::window::handle_event(
+
+gsl::czstring wsi::window::atom_to_string(Atoms atom) noexcept {
+  switch (atom) {
+  case WM_PROTOCOLS: return "WM_PROTOCOLS";
+  case WM_DELETE_WINDOW: return "WM_DELETE_WINDOW";
+  case NET_WM_NAME: return "_NET_WM_NAME";
+  case NET_WM_ICON_NAME: return "_NET_WM_ICON_NAME";
+  case UTF8_STRING: return "UTF8_STRING";
+  case _MOTIF_WM_HINTS: return "_MOTIF_WM_HINTS";
+  case NUM_ATOMS:
+  default: PLAT_MARK_UNREACHABLE;
+  }
+  PLAT_MARK_UNREACHABLE;
+}
+
+#endif // TURF_KERNEL_LINUX && WSI_XCB
@@ -0,0 +1,113 @@
+#ifndef VKST_WSI_WINDOW_XCB_H
+#define VKST_WSI_WINDOW_XCB_H
+
+#ifndef VKST_WSI_WINDOW_H
+#error "Include window.h only"
+#endif
+
+#include "window.h"
+#include <xcb/xcb.h>
+#include <array>
+#include <cstdlib>
+#include <memory>
+#include <tuple>
+
+namespace wsi {
+
+// A window on an X server through XCB. Unlike Xlib, XCB returns a cookie for
+// each request and only blocks when its reply is asked for, so create sends
+// every request it needs a reply to before waiting on any of them, and
+// event handling never waits on the server.
+class window final : public impl::window<window> {
+public:
+  // Open a window on screen_number of the X server named by DISPLAY, or on
+  // its default screen if screen_number is negative.
+  static window create(rect2d topleft_size, gsl::czstring title,
+                       window_options opts, int screen_number,
+                       std::error_code& ec) noexcept;
+  static window create(rect2d topleft_size, gsl::czstring title,
+                       window_options opts, std::error_code& ec) noexcept {
+    return create(std::move(topleft_size), title, opts, -1, ec);
+  }
+
+  constexpr window() noexcept {}
+  window(window const&) = delete;
+  window(window&& other) noexcept;
+  window& operator=(window const&) = delete;
+  window& operator=(window&& rhs) noexcept;
+  ~window() noexcept;
+
+  // The X connection's descriptor. It is readable when events arrive, so the
+  // window can be waited on with poll or epoll along with other descriptors.
+  int descriptor() const noexcept {
+    return xcb_get_file_descriptor(_connection);
+  }
+
+  using native_handle_t =
+    std::tuple<xcb_connection_t*, xcb_visualid_t, xcb_window_t>;
+  native_handle_t native_handle() const noexcept {
+    return std::make_tuple(_connection, _visual, _handle);
+  }
+
+private:
+  constexpr window(rect2d topleft_size) noexcept
+  : impl::window<window>{std::move(topleft_size)} {}
+
+  enum Atoms {
+    WM_PROTOCOLS,
+    WM_DELETE_WINDOW,
+    NET_WM_NAME,
+    NET_WM_ICON_NAME,
+    UTF8_STRING,
+    _MOTIF_WM_HINTS,
+    NUM_ATOMS,
+  }; // enum Atoms
+
+  // XCB allocates events and replies with malloc
+  struct free_deleter {
+    void operator()(void* p) const noexcept { std::free(p); }
+  }; // struct free_deleter
+  template <class T>
+  using reply = std::unique_ptr<T, free_deleter>;
+  using event_ptr = reply<xcb_generic_event_t>;
+
+  xcb_connection_t* _connection{nullptr};
+  xcb_visualid_t _visual{0};
+  xcb_window_t _handle{0};
+  offset2d _cursor_pos{}; // from the last pointer event, see do_cursor_pos
+  event_ptr _next_event{}; // read ahead of a KeyRelease, handled next
+  std::array<wsi::keys, 256> _key_lut{};
+  std::array<xcb_atom_t, NUM_ATOMS> _atoms{};
+
+  void do_retitle(gsl::czstring title) noexcept;
+  std::string do_title() const noexcept;
+
+  void do_resize(extent2d const& size) noexcept;
+  void do_reposition(offset2d const& position) noexcept;
+
+  void do_show() noexcept;
+  void do_hide() noexcept;
+
+  void do_close() noexcept;
+
+  // The pointer position in the window as of the last event handled. While
+  // the pointer is outside the window no motion is reported, unless a button
+  // is held down, so the position is where it left.
+  offset2d do_cursor_pos() const noexcept { return _cursor_pos; }
+
+  void do_poll_events() noexcept;
+  void do_wait_events(std::chrono::nanoseconds timeout) noexcept;
+
+  // Take the next event without blocking: the one read ahead if there is
+  // one, otherwise one from the connection.
+  event_ptr next_event() noexcept;
+  void handle_event(xcb_generic_event_t const* ev) noexcept;
+
+  static gsl::czstring atom_to_string(Atoms atom) noexcept;
+
+  friend class impl::window<window>;
+}; // class window
+
+} // namespace wsi
+
+#endif // VKST_WSI_WINDOW_XCB_H
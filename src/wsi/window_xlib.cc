@@ -1,141 +1,15 @@
 #include "window.h"
 #include <plat/core.h>
 
-#if TURF_KERNEL_LINUX
+#if TURF_KERNEL_LINUX && !WSI_XCB
+#include <wsi/keysym.h>
 #include <cstring>
 #include <X11/XKBlib.h>
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
-#include <X11/keysym.h>
 
 namespace {
 
-wsi::keys translate_keysym(KeySym keysym) {
-  using namespace wsi;
-  switch (keysym) {
-  case XK_BackSpace: return keys::eBackspace;
-  case XK_Tab: return keys::eTab;
-  case XK_Return: return keys::eEnter;
-  case XK_Pause: return keys::ePause;
-  case XK_Scroll_Lock: return keys::eScrollLock;
-  case XK_Escape: return keys::eEscape;
-  case XK_Delete: return keys::eDelete;
-
-  case XK_Home: return keys::eHome;
-  case XK_Left: return keys::eLeft;
-  case XK_Up: return keys::eUp;
-  case XK_Down: return keys::eDown;
-  case XK_Page_Up: return keys::ePageUp;
-  case XK_Page_Down: return keys::ePageDown;
-  case XK_End: return keys::eEnd;
-
-  case XK_Insert: return keys::eInsert;
-  case XK_Num_Lock: return keys::eNumLock;
-
-  case XK_KP_Enter: return keys::eKeypadEnter;
-  case XK_KP_Home: return keys::eKeypad7;
-  case XK_KP_Left: return keys::eKeypad4;
-  case XK_KP_Up: return keys::eKeypad8;
-  case XK_KP_Right: return keys::eKeypad6;
-  case XK_KP_Down: return keys::eKeypad2;
-  case XK_KP_Page_Up: return keys::eKeypad9;
-  case XK_KP_Page_Down: return keys::eKeypad3;
-  case XK_KP_End: return keys::eKeypad1;
-  case XK_KP_Insert: return keys::eKeypad0;
-  case XK_KP_Delete: return keys::eKeypadDecimal;
-  case XK_KP_Multiply: return keys::eKeypadMultiply;
-  case XK_KP_Add: return keys::eKeypadAdd;
-  case XK_KP_Subtract: return keys::eKeypadSubtract;
-  case XK_KP_Divide: return keys::eKeypadDivide;
-
-  case XK_F1: return keys::eF1;
-  case XK_F2: return keys::eF2;
-  case XK_F3: return keys::eF3;
-  case XK_F4: return keys::eF4;
-  case XK_F5: return keys::eF5;
-  case XK_F6: return keys::eF6;
-  case XK_F7: return keys::eF7;
-  case XK_F8: return keys::eF8;
-  case XK_F9: return keys::eF9;
-  case XK_F10: return keys::eF10;
-  case XK_F11: return keys::eF11;
-  case XK_F12: return keys::eF12;
-  case XK_F13: return keys::eF13;
-  case XK_F14: return keys::eF14;
-  case XK_F15: return keys::eF15;
-  case XK_F16: return keys::eF16;
-  case XK_F17: return keys::eF17;
-  case XK_F18: return keys::eF18;
-  case XK_F19: return keys::eF19;
-  case XK_F20: return keys::eF20;
-  case XK_F21: return keys::eF21;
-  case XK_F22: return keys::eF22;
-  case XK_F23: return keys::eF23;
-  case XK_F24: return keys::eF24;
-  case XK_F25: return keys::eF25;
-
-  case XK_Shift_L: return keys::eLeftShift;
-  case XK_Shift_R: return keys::eRightShift;
-  case XK_Control_L: return keys::eLeftControl;
-  case XK_Control_R: return keys::eRightControl;
-  case XK_Caps_Lock: return keys::eCapsLock;
-  case XK_Meta_L: return keys::eLeftAlt;
-  case XK_Meta_R: return keys::eRightAlt;
-  case XK_Super_L: return keys::eLeftSuper;
-  case XK_Super_R: return keys::eRightSuper;
-
-  case XK_space: return keys::eSpace;
-  case XK_apostrophe: return keys::eApostrophe;
-  case XK_comma: return keys::eComma;
-  case XK_minus: return keys::eMinus;
-  case XK_period: return keys::ePeriod;
-  case XK_slash: return keys::eSlash;
-  case XK_0: return keys::e0;
-  case XK_1: return keys::e1;
-  case XK_2: return keys::e2;
-  case XK_3: return keys::e3;
-  case XK_4: return keys::e4;
-  case XK_5: return keys::e5;
-  case XK_6: return keys::e6;
-  case XK_7: return keys::e7;
-  case XK_8: return keys::e8;
-  case XK_9: return keys::e9;
-  case XK_semicolon: return keys::eSemicolon;
-  case XK_equal: return keys::eEqual;
-  case XK_A: return keys::eA;
-  case XK_B: return keys::eB;
-  case XK_C: return keys::eC;
-  case XK_D: return keys::eD;
-  case XK_E: return keys::eE;
-  case XK_F: return keys::eF;
-  case XK_G: return keys::eG;
-  case XK_H: return keys::eH;
-  case XK_I: return keys::eI;
-  case XK_J: return keys::eJ;
-  case XK_K: return keys::eK;
-  case XK_L: return keys::eL;
-  case XK_M: return keys::eM;
-  case XK_N: return keys::eN;
-  case XK_O: return keys::eO;
-  case XK_P: return keys::eP;
-  case XK_Q: return keys::eQ;
-  case XK_R: return keys::eR;
-  case XK_S: return keys::eS;
-  case XK_T: return keys::eT;
-  case XK_U: return keys::eU;
-  case XK_V: return keys::eV;
-  case XK_W: return keys::eW;
-  case XK_X: return keys::eX;
-  case XK_Y: return keys::eY;
-  case XK_Z: return keys::eZ;
-  case XK_bracketleft: return keys::eLeftBracket;
-  case XK_backslash: return keys::eBackslash;
-  case XK_bracketright: return keys::eRightBracket;
-  case XK_grave: return keys::eGraveAccent;
-  }
-  return keys::eUnknown;
-} // translate_keysym
-
 namespace error {
 
 uint8_t s_code{0};
@@ -189,8 +63,9 @@ wsi::window wsi::window::create(rect2d topleft_size, gsl::czstring title,
   attrs.border_pixel = 0;
   attrs.colormap = DefaultColormap(w._display, screen);
   attrs.event_mask = StructureNotifyMask | KeyPressMask | KeyReleaseMask |
-                     ButtonPressMask | ButtonReleaseMask | ExposureMask |
-                     VisibilityChangeMask | PropertyChangeMask;
+                     ButtonPressMask | ButtonReleaseMask | PointerMotionMask |
+                     EnterWindowMask | ExposureMask | VisibilityChangeMask |
+                     PropertyChangeMask;
 
   error::grab(w._display);
   w._handle = XCreateWindow(
@@ -254,6 +129,20 @@ wsi::window wsi::window::create(rect2d topleft_size, gsl::czstring title,
   XFree(size_hints);
 
   w.retitle(title);
+
+  // Motion and enter events keep the cursor position current after this
+  {
+    Window root, child;
+    int root_x, root_y;
+    unsigned int mask;
+    XQueryPointer(w._display, w._handle, &root, &child, &root_x, &root_y,
+                  &w._cursor_pos.x, &w._cursor_pos.y, &mask);
+  }
+
+  w._input_events = gsl::make_unique<input_event_queue>();
+
+  // The callback is empty: wait_events handles whatever arrives
+  w._events.add(ConnectionNumber(w._display), {}, ec);
   return w;
 } // wsi::window::create
 
@@ -261,7 +150,8 @@ wsi::window::window(window&& other) noexcept
 : impl::window<window>{std::move(other)}
 , _display{other._display}
 , _visual{other._visual}
-, _handle{other._handle} {
+, _handle{other._handle}
+, _cursor_pos{other._cursor_pos} {
   std::memcpy(_key_lut.data(), other._key_lut.data(),
               _key_lut.size() * sizeof(decltype(_key_lut)::value_type));
   std::memcpy(_atoms.data(), other._atoms.data(),
@@ -277,6 +167,7 @@ wsi::window& wsi::window::operator=(window&& rhs) noexcept {
   _display = rhs._display;
   _visual = rhs._visual;
   _handle = rhs._handle;
+  _cursor_pos = rhs._cursor_pos;
   std::memcpy(_key_lut.data(), rhs._key_lut.data(),
               _key_lut.size() * sizeof(decltype(_key_lut)::value_type));
   std::memcpy(_atoms.data(), rhs._atoms.data(),
@@ -349,23 +240,28 @@ void wsi::window::do_close() noexcept {
 } // wsi::window::do_close()
 
 wsi::offset2d wsi::window::do_cursor_pos() const noexcept {
-  Window root, child;
-  wsi::offset2d root_pos, child_pos;
-  unsigned int mask;
-  XQueryPointer(_display, _handle, &root, &child, &root_pos.x, &root_pos.y,
-                &child_pos.x, &child_pos.y, &mask);
-  return child_pos;
+  return _cursor_pos;
 } // wsi::window::do_cursor_pos()
 
 void wsi::window::do_poll_events() noexcept {
+  using types = input_event::types;
+
   while (XPending(_display) > 0) {
     XEvent ev;
     XNextEvent(_display, &ev);
 
+    input_event input;
+    input.received = std::chrono::steady_clock::now();
+
     switch (ev.type) {
     case KeyPress:
       if (ev.xkey.window != _handle) break;
       _keys.set(_key_lut[ev.xkey.keycode]);
+      input.type = types::key_press;
+      input.key = _key_lut[ev.xkey.keycode];
+      input.pos = _cursor_pos = {ev.xkey.x, ev.xkey.y};
+      input.time = static_cast<uint32_t>(ev.xkey.time);
+      push_input(input);
       break;
 
     case KeyRelease:
@@ -385,36 +281,71 @@ void wsi::window::do_poll_events() noexcept {
       }
 
       _keys.reset(_key_lut[ev.xkey.keycode]);
+      input.type = types::key_release;
+      input.key = _key_lut[ev.xkey.keycode];
+      input.pos = _cursor_pos = {ev.xkey.x, ev.xkey.y};
+      input.time = static_cast<uint32_t>(ev.xkey.time);
+      push_input(input);
       break;
 
     case ButtonPress:
       if (ev.xbutton.window != _handle) break;
+      input.type = types::button_press;
       switch (ev.xbutton.button) {
-      case Button1: _buttons.set(buttons::e1); break;
-      case Button2: _buttons.set(buttons::e2); break;
-      case Button3: _buttons.set(buttons::e3); break;
-      case Button4: _scroll = -1; break;
-      case Button5: _scroll = 1; break;
+      case Button1: input.button = buttons::e1; break;
+      case Button2: input.button = buttons::e2; break;
+      case Button3: input.button = buttons::e3; break;
+      case Button4:
+        _scroll = -1;
+        input.type = types::scroll;
+        input.scroll = -1;
+        break;
+      case Button5:
+        _scroll = 1;
+        input.type = types::scroll;
+        input.scroll = 1;
+        break;
       default:
-        _buttons.set(
-          static_cast<enum buttons>(ev.xbutton.button - Button1 - 4));
+        input.button =
+          static_cast<enum buttons>(ev.xbutton.button - Button1 - 4);
         break;
       }
+      if (input.type == types::button_press) _buttons.set(input.button);
+      input.pos = _cursor_pos = {ev.xbutton.x, ev.xbutton.y};
+      input.time = static_cast<uint32_t>(ev.xbutton.time);
+      push_input(input);
       break;
 
     case ButtonRelease:
       if (ev.xbutton.window != _handle) break;
       switch (ev.xbutton.button) {
-      case Button1: _buttons.reset(buttons::e1); break;
-      case Button2: _buttons.reset(buttons::e2); break;
-      case Button3: _buttons.reset(buttons::e3); break;
+      case Button1: input.button = buttons::e1; break;
+      case Button2: input.button = buttons::e2; break;
+      case Button3: input.button = buttons::e3; break;
       case Button4: _scroll = 0; break;
       case Button5: _scroll = 0; break;
       default:
-        _buttons.reset(
-          static_cast<enum buttons>(ev.xbutton.button - Button1 - 4));
+        input.button =
+          static_cast<enum buttons>(ev.xbutton.button - Button1 - 4);
         break;
       }
+      // A wheel step is a press and release; the press is the scroll event
+      if (ev.xbutton.button == Button4 || ev.xbutton.button == Button5) break;
+      _buttons.reset(input.button);
+      input.type = types::button_release;
+      input.pos = _cursor_pos = {ev.xbutton.x, ev.xbutton.y};
+      input.time = static_cast<uint32_t>(ev.xbutton.time);
+      push_input(input);
+      break;
+
+    case MotionNotify:
+      if (ev.xmotion.window != _handle) break;
+      _cursor_pos = {ev.xmotion.x, ev.xmotion.y};
+      break;
+
+    case EnterNotify:
+      if (ev.xcrossing.window != _handle) break;
+      _cursor_pos = {ev.xcrossing.x, ev.xcrossing.y};
       break;
 
     case ClientMessage:
@@ -447,6 +378,12 @@ void wsi::window::do_poll_events() noexcept {
   }
 } // wsi::window::do_poll_events()
 
+void wsi::window::do_wait_events(std::chrono::nanoseconds timeout) noexcept {
+  // Events Xlib has already read from the connection do not wake the loop
+  if (!events_pending()) _events.wait(timeout);
+  do_poll_events();
+} // wsi::window::do_wait_events()
+
 gsl::czstring wsi::window::atom_to_string(Atoms atom) noexcept {
   switch (atom) {
 #define STR(r)                                                                 \
@@ -463,4 +400,4 @@ gsl::czstring wsi::window::atom_to_string(Atoms atom) noexcept {
   PLAT_MARK_UNREACHABLE;
 }
 
-#endif // TURF_KERNEL_LINUX
+#endif // TURF_KERNEL_LINUX && !WSI_XCB
@@ -24,6 +24,17 @@ public:
   window& operator=(window&& rhs) noexcept;
   ~window() noexcept;
 
+  // The X connection's descriptor. It is readable when events arrive, so the
+  // window can be waited on with poll or epoll along with other descriptors.
+  int descriptor() const noexcept { return ConnectionNumber(_display); }
+
+  // Flush any requests and return true if Xlib already holds events. Those
+  // have been read from the connection, so waiting on descriptor() misses
+  // them.
+  bool events_pending() const noexcept {
+    return XEventsQueued(_display, QueuedAfterFlush) > 0;
+  }
+
   using native_handle_t = std::tuple<Display*, Visual*, Window>;
   native_handle_t native_handle() const noexcept {
     return std::make_tuple(_display, _visual, _handle);
@@ -45,6 +56,7 @@ private:
   Display* _display{nullptr};
   Visual* _visual{nullptr};
   Window _handle{0};
+  offset2d _cursor_pos{}; // from the last pointer event, see do_cursor_pos
   std::array<wsi::keys, 256> _key_lut{};
   std::array<Atom, NUM_ATOMS> _atoms{};
 
@@ -59,9 +71,14 @@ private:
 
   void do_close() noexcept;
 
+  // The pointer position in the window as of the last event handled, which
+  // avoids a round trip to the X server. While the pointer is outside the
+  // window no motion is reported, unless a button is held down, so the
+  // position is where it left.
   offset2d do_cursor_pos() const noexcept;
 
   void do_poll_events() noexcept;
+  void do_wait_events(std::chrono::nanoseconds timeout) noexcept;
 
   static gsl::czstring atom_to_string(Atoms atom) noexcept;
 